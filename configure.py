@@ -96,6 +96,11 @@ add_tristate(
     name = 'task-backtrace',
     dest = 'task_backtrace',
     help = 'Collect backtrace at deferring points')
+add_tristate(
+    arg_parser,
+    name = 'request-context',
+    dest = 'request_context',
+    help = 'Record the request context in every task, so that continuations inherit it')
 add_tristate(
     arg_parser,
     name = 'unused-result-error',
@@ -193,6 +198,7 @@ def configure_mode(mode):
         tr(args.hwloc, 'HWLOC', value_when_none='yes'),
         tr(args.alloc_failure_injection, 'ALLOC_FAILURE_INJECTION', value_when_none='DEFAULT'),
         tr(args.task_backtrace, 'TASK_BACKTRACE'),
+        tr(args.request_context, 'REQUEST_CONTEXT'),
         tr(args.alloc_page_size, 'ALLOC_PAGE_SIZE'),
         tr(args.split_dwarf, 'SPLIT_DWARF'),
         tr(args.heap_profiling, 'HEAP_PROFILING'),
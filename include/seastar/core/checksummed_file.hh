@@ -0,0 +1,81 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#pragma once
+
+#include <seastar/core/file.hh>
+#include <stdexcept>
+
+namespace seastar {
+
+/// \addtogroup fileio-module
+/// @{
+
+/// Thrown when data read from a checksummed file does not match the
+/// checksum recorded when it was written.
+class checksum_mismatch_error : public std::runtime_error {
+    uint64_t _offset;
+public:
+    explicit checksum_mismatch_error(uint64_t offset);
+
+    /// Offset of the first block that failed verification.
+    uint64_t offset() const noexcept {
+        return _offset;
+    }
+};
+
+/// Options for \ref make_checksummed_file().
+struct checksummed_file_options {
+    /// Size of a checksummed block. Must be a power of two and a multiple
+    /// of the data file's disk write alignment.
+    uint32_t block_size = 4096;
+};
+
+/// Wraps a file so that its contents are protected by CRC32C checksums.
+///
+/// The data file keeps its layout: offsets in the returned file are offsets
+/// in \c data. A checksum is kept for every \ref checksummed_file_options::block_size
+/// block in the sidecar file \c checksums, as an array of little-endian 32-bit
+/// values indexed by block number.
+///
+/// Writes and discard() must be block aligned; the checksums of the written
+/// blocks are stored once the data write completes. truncate() may cut a block,
+/// as output streams do to drop the padding of their last write: the checksum
+/// of a partial last block covers it padded with zeroes to a whole block.
+/// Reads may have any alignment. They fetch the checksums concurrently with the
+/// data and verify every block they touch, failing with \ref checksum_mismatch_error
+/// on mismatch. Blocks that were never written (holes) read back as zeroes and
+/// pass verification.
+///
+/// Data and checksums are not updated atomically: a read that races with a
+/// write to the same block, or a crash before both reach the disk, can observe
+/// a mismatch.
+///
+/// \param data the file holding the data
+/// \param checksums the sidecar file holding the checksums; the returned file
+///                  takes ownership of it and closes it on close()
+/// \param options layout options; must be the same each time a file is opened
+file make_checksummed_file(file data, file checksums, checksummed_file_options options = {});
+
+/// @}
+
+}
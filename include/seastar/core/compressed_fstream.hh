@@ -0,0 +1,76 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#pragma once
+
+// Block-compressed file streams
+//
+// The stream is cut into fixed-size chunks of uncompressed data, each
+// compressed independently, followed by an index of the chunks' offsets
+// and a fixed-size trailer. This lets a reader start anywhere in the
+// uncompressed data by decompressing only the chunks it needs.
+
+#include <seastar/core/fstream.hh>
+
+namespace seastar {
+
+/// Options for \ref make_compressed_file_output_stream().
+struct compressed_file_output_stream_options {
+    /// Uncompressed size of each independently compressed chunk. Larger
+    /// chunks compress better; smaller ones make random access cheaper.
+    size_t chunk_size = 65536;
+    /// Options of the stream writing the compressed data to the file.
+    /// Compression of a chunk overlaps with the writing of up to
+    /// \c write_behind previous ones.
+    file_output_stream_options file_options;
+};
+
+/// Options for \ref make_compressed_file_input_stream().
+struct compressed_file_input_stream_options {
+    unsigned read_ahead = 1; ///< Number of chunks read and decompressed ahead of the consumer
+    ::seastar::io_priority_class io_priority_class = default_priority_class();
+};
+
+/// Creates an output_stream writing a block-compressed (lz4) file.
+///
+/// The file is written from offset zero. The chunk index is written when
+/// the stream is closed, so the file is not readable until then; flush()
+/// writes only complete chunks.
+///
+/// Closes the file if the stream creation fails.
+future<output_stream<char>> make_compressed_file_output_stream(file file,
+        compressed_file_output_stream_options options = {}) noexcept;
+
+/// Creates an input_stream reading a file written by
+/// \ref make_compressed_file_output_stream().
+///
+/// \param file File to read; multiple streams for the same file may coexist
+/// \param offset Offset in the uncompressed data to start from. Only the
+///               chunks from the one containing \c offset on are read.
+/// \param options A set of options controlling the stream.
+///
+/// Reads fail with std::runtime_error if the file is not a valid
+/// compressed file.
+input_stream<char> make_compressed_file_input_stream(file file, uint64_t offset = 0,
+        compressed_file_input_stream_options options = {});
+
+}
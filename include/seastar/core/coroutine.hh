@@ -31,6 +31,21 @@
 
 namespace seastar {
 
+namespace coroutine {
+
+/// \brief Fails a coroutine without throwing.
+///
+/// `co_return coroutine::exception(eptr);` resolves the coroutine's future
+/// with \c eptr, without the cost of throwing and catching it. Only
+/// coroutines returning a value can \c co_return it; use
+/// \ref return_exception() in the others.
+struct exception {
+    std::exception_ptr eptr;
+    explicit exception(std::exception_ptr eptr) noexcept : eptr(std::move(eptr)) {}
+};
+
+}
+
 namespace internal {
 
 template <typename T = void>
@@ -53,6 +68,14 @@ class coroutine_traits_base {
             fut.forward_to(std::move(_promise));
         }
 
+        void return_value(coroutine::exception&& ce) noexcept {
+            _promise.set_exception(std::move(ce.eptr));
+        }
+
+        void set_exception(std::exception_ptr&& eptr) noexcept {
+            _promise.set_exception(std::move(eptr));
+        }
+
         void unhandled_exception() noexcept {
             _promise.set_exception(std::current_exception());
         }
@@ -87,6 +110,10 @@ class coroutine_traits_base<> {
             _promise.set_value();
         }
 
+        void set_exception(std::exception_ptr&& eptr) noexcept {
+            _promise.set_exception(std::move(eptr));
+        }
+
         void unhandled_exception() noexcept {
             _promise.set_exception(std::current_exception());
         }
@@ -182,8 +209,70 @@ struct awaiter<> {
     void await_resume() { _future.get(); }
 };
 
+template <typename Future>
+class as_future_awaiter {
+    Future _future;
+public:
+    explicit as_future_awaiter(Future&& f) noexcept : _future(std::move(f)) { }
+
+    as_future_awaiter(const as_future_awaiter&) = delete;
+    as_future_awaiter(as_future_awaiter&&) = delete;
+
+    bool await_ready() const noexcept {
+        return _future.available() && !need_preempt();
+    }
+
+    template<typename U>
+    void await_suspend(SEASTAR_INTERNAL_COROUTINE_NAMESPACE::coroutine_handle<U> hndl) noexcept {
+        if (!_future.available()) {
+            _future.set_coroutine(hndl.promise());
+        } else {
+            schedule(&hndl.promise());
+        }
+    }
+
+    Future await_resume() noexcept { return std::move(_future); }
+};
+
+struct return_exception_awaiter {
+    std::exception_ptr _eptr;
+
+    bool await_ready() const noexcept { return false; }
+
+    template<typename U>
+    void await_suspend(SEASTAR_INTERNAL_COROUTINE_NAMESPACE::coroutine_handle<U> hndl) noexcept {
+        hndl.promise().set_exception(std::move(_eptr));
+        hndl.destroy();
+    }
+
+    void await_resume() noexcept { }
+};
+
 } // seastar::internal
 
+namespace coroutine {
+
+/// \brief Waits for a future without rethrowing its exception.
+///
+/// `co_await coroutine::as_future(f)` resolves into the future itself, ready
+/// and possibly failed, so that a failure can be inspected (e.g. with
+/// \ref try_catch()) or passed on without a throw.
+template<typename... T>
+auto as_future(future<T...>&& f) noexcept {
+    return internal::as_future_awaiter<future<T...>>(std::move(f));
+}
+
+/// \brief Fails a coroutine without throwing.
+///
+/// `co_await coroutine::return_exception(eptr);` resolves the coroutine's
+/// future with \c eptr and ends the coroutine; nothing after it runs.
+/// Works in coroutines returning \c future<> too.
+inline internal::return_exception_awaiter return_exception(std::exception_ptr eptr) noexcept {
+    return internal::return_exception_awaiter{std::move(eptr)};
+}
+
+}
+
 template<typename... T>
 auto operator co_await(future<T...> f) noexcept {
     return internal::awaiter<T...>(std::move(f));
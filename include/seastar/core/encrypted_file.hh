@@ -0,0 +1,66 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#pragma once
+
+#include <seastar/core/file.hh>
+#include <vector>
+
+namespace seastar {
+
+/// \addtogroup fileio-module
+/// @{
+
+/// Options for \ref make_encrypted_file().
+struct encrypted_file_options {
+    /// Size of an encryption unit. Each block is encrypted independently,
+    /// with its block number as the XTS tweak. Must be a power of two and
+    /// a multiple of the underlying file's disk write alignment.
+    uint32_t block_size = 4096;
+};
+
+/// Wraps a file so that its contents are encrypted at rest with AES-XTS.
+///
+/// The returned file has the same size and layout as the underlying one,
+/// but all I/O must be aligned to \ref encrypted_file_options::block_size,
+/// except dma_read_bulk() which aligns internally. Data is decrypted in place
+/// in the read buffers; writes encrypt into a bounce buffer, since the
+/// caller's buffer cannot be modified. The AES implementation is GnuTLS's,
+/// which uses AES-NI (or the equivalent on other architectures) when available.
+///
+/// A partial trailing block, which can only appear if the file was written
+/// without going through this layer, is not returned by reads. Blocks that
+/// are all zeroes on disk, such as holes, discarded ranges and allocated but
+/// unwritten space, read back as zeroes rather than being decrypted.
+///
+/// \param underlying the file holding the encrypted data
+/// \param key the per-file key: 32 bytes for AES-128-XTS or 64 bytes for
+///            AES-256-XTS. The two halves must differ. It is wiped from
+///            memory before the function returns.
+/// \param options layout options; must be the same each time a file is opened
+///
+/// \throws std::invalid_argument if the key or block size is invalid
+file make_encrypted_file(file underlying, std::vector<uint8_t> key, encrypted_file_options options = {});
+
+/// @}
+
+}
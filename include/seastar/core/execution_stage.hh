@@ -222,6 +222,7 @@ class concrete_execution_stage final : public execution_stage {
     struct work_item {
         input_type _in;
         promise_type _ready;
+        request_context _ctx = current_request_context();
 
         work_item(typename internal::wrap_for_es<Args>::type... args) : _in(std::move(args)...) { }
 
@@ -240,10 +241,14 @@ class concrete_execution_stage final : public execution_stage {
     }
 
     virtual void do_flush() noexcept override {
+        // Each call runs under the request context of its caller
+        auto& current_ctx = *internal::current_request_context_ptr();
+        auto prev_ctx = current_ctx;
         while (!_queue.empty()) {
             auto& wi = _queue.front();
             auto wi_in = std::move(wi._in);
             auto wi_ready = std::move(wi._ready);
+            current_ctx = wi._ctx;
             _queue.pop_front();
             futurize<ReturnType>::apply(_function, unwrap(std::move(wi_in))).forward_to(std::move(wi_ready));
             _stats.function_calls_executed++;
@@ -253,6 +258,7 @@ class concrete_execution_stage final : public execution_stage {
                 break;
             }
         }
+        current_ctx = prev_ctx;
         _empty = _queue.empty();
     }
 public:
@@ -389,6 +389,11 @@ class file {
     ///
     /// The discard operation tells the file system that a range of offsets
     /// (which be aligned) is no longer needed and can be reused.
+    ///
+    /// Discards go through the I/O scheduler under \ref discard_priority_class().
+    /// Discards of adjacent ranges of the same file that are queued at the same
+    /// time are merged, and resolve together when the merged range is done.
+    /// Their rate can be capped with the \c discard_bandwidth disk property.
     future<> discard(uint64_t offset, uint64_t length) noexcept;
 
     /// Gets the file size.
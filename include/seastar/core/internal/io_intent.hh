@@ -125,6 +125,23 @@ class intent_reference : public bi::list_base_hook<bi::link_mode<bi::auto_unlink
     io_intent* retrieve() const;
 };
 
+/*
+ * A request that has left the IO queue and was handed over to the
+ * reactor (the sink or the kernel) while still being attached to an
+ * intent. Cancelling the intent calls cancel_inflight() on it, which
+ * tries to withdraw the request. The request may still complete
+ * normally if it's too late for that, e.g. if the kernel doesn't
+ * support cancelling it.
+ */
+class cancellable_inflight : public bi::list_base_hook<bi::link_mode<bi::auto_unlink>> {
+    friend class seastar::io_intent;
+    using container_type = bi::list<cancellable_inflight, bi::constant_time_size<false>>;
+
+public:
+    virtual ~cancellable_inflight() = default;
+    virtual void cancel_inflight() noexcept = 0;
+};
+
 } // namespace internal
 
 } // namespace seastar
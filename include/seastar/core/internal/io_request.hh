@@ -32,7 +32,7 @@ namespace internal {
 
 class io_request {
 public:
-    enum class operation { read, readv, write, writev, fdatasync, recv, recvmsg, send, sendmsg, accept, connect, poll_add, poll_remove, cancel };
+    enum class operation { read, readv, write, writev, fdatasync, recv, recvmsg, send, sendmsg, accept, connect, poll_add, poll_remove, cancel, discard, blkdiscard };
 private:
     operation _op;
     int _fd;
@@ -157,6 +157,12 @@ class io_request {
         }
     }
 
+    // Discards have no kernel aio counterpart and are executed
+    // in the syscall thread once dispatched from the io_queue
+    bool is_discard() const {
+        return _op == operation::discard || _op == operation::blkdiscard;
+    }
+
     sstring opname() const;
 
     operation opcode() const {
@@ -247,6 +253,16 @@ class io_request {
         return io_request(operation::writev, fd, pos, iov.data(), iov.size(), nowait_works);
     }
 
+    // Punches a hole in a regular file (fallocate(FALLOC_FL_PUNCH_HOLE))
+    static io_request make_discard(int fd, uint64_t pos, size_t size) {
+        return io_request(operation::discard, fd, pos, nullptr, size);
+    }
+
+    // Discards a range of a block device (ioctl(BLKDISCARD))
+    static io_request make_blkdiscard(int fd, uint64_t pos, size_t size) {
+        return io_request(operation::blkdiscard, fd, pos, nullptr, size);
+    }
+
     static io_request make_fdatasync(int fd) {
         return io_request(operation::fdatasync, fd);
     }
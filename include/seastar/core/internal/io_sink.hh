@@ -48,6 +48,8 @@ class io_sink {
     circular_buffer<pending_io_request> _pending_io;
 public:
     void submit(io_completion* desc, internal::io_request req) noexcept;
+    // Removes the not yet drained request, returns false if it's not here
+    bool cancel(io_completion* desc) noexcept;
 
     template <typename Fn>
     // Fn should return whether the request was consumed and
@@ -68,7 +68,7 @@ class pollable_fd_state {
     bool no_more_send = false; // For udp, there is no shutdown indication from the kernel
     int events_requested = 0; // wanted by pollin/pollout promises
     int events_epoll = 0;     // installed in epoll
-    int events_known = 0;     // returned from epoll
+    int events_known = 0;     // returned from epoll, or speculated
 
     friend class reactor;
     friend class pollable_fd;
@@ -39,6 +39,13 @@ namespace seastar {
 /// to the intent and is only processed as long as the intent object
 /// is alive and the **cancel()** method is not called.
 ///
+/// Requests that were already dispatched when the intent is cancelled
+/// (or destroyed) are withdrawn from the reactor if they haven't been
+/// submitted to the kernel yet, and the kernel is asked to cancel them
+/// otherwise. Since the kernel may refuse, such requests are not
+/// guaranteed to fail, and their futures resolve only after the kernel
+/// is done with the buffers.
+///
 /// If no intent is provided, then the request is processed till its
 /// completion be it success or error
 class io_intent {
@@ -70,6 +77,21 @@ class io_intent {
         }
     };
 
+    struct inflight {
+        internal::cancellable_inflight::container_type list;
+
+        inflight(inflight&& o) noexcept : list(std::move(o.list)) {}
+        inflight() noexcept : list() {}
+        ~inflight() { clear(); }
+
+        void clear() noexcept {
+            list.clear_and_dispose([] (internal::cancellable_inflight* r) { r->cancel_inflight(); });
+        }
+    };
+
+    // Declared before _intents so that queued requests are dropped
+    // before the in-flight ones are cancelled on destruction
+    inflight _inflight;
     boost::container::small_vector<intents_for_queue, 1> _intents;
     references _refs;
     friend internal::intent_reference::intent_reference(io_intent*) noexcept;
@@ -81,7 +103,7 @@ class io_intent {
     io_intent(const io_intent&) = delete;
     io_intent& operator=(const io_intent&) = delete;
     io_intent& operator=(io_intent&&) = delete;
-    io_intent(io_intent&& o) noexcept : _intents(std::move(o._intents)), _refs(std::move(o._refs)) {
+    io_intent(io_intent&& o) noexcept : _inflight(std::move(o._inflight)), _intents(std::move(o._intents)), _refs(std::move(o._refs)) {
         for (auto&& r : _refs.list) {
             r._intent = this;
         }
@@ -89,10 +111,12 @@ class io_intent {
 
     /// Explicitly cancels all the requests attached to this intent
     /// so far. The respective futures are resolved into the \ref
-    /// cancelled_error "cancelled_error"
+    /// cancelled_error "cancelled_error", except for the in-flight
+    /// requests the kernel failed to cancel, which complete normally
     void cancel() noexcept {
         _refs.clear();
         _intents.clear();
+        _inflight.clear();
     }
 
     /// @private
@@ -106,6 +130,11 @@ class io_intent {
         _intents.emplace_back(dev, qid);
         return _intents.back().cq;
     }
+
+    /// @private
+    void bind_inflight(internal::cancellable_inflight& r) noexcept {
+        _inflight.list.push_back(r);
+    }
 };
 
 } // namespace seastar
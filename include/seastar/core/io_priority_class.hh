@@ -39,6 +39,12 @@ class io_priority_class {
 
     bool rename_registered(sstring name);
 
+    // Like register_one(), but if \c name is already registered, returns
+    // that class whatever its shares are
+    static io_priority_class register_or_reuse(sstring name, uint32_t shares);
+    static io_priority_class do_register(sstring name, uint32_t shares, bool check_shares);
+    friend const io_priority_class& discard_priority_class();
+
 public:
     io_priority_class_id id() const noexcept {
         return _id;
@@ -82,4 +88,7 @@ class io_priority_class {
 
 const io_priority_class& default_priority_class();
 
+/// The class \ref file::discard() requests are queued under
+const io_priority_class& discard_priority_class();
+
 } // namespace seastar
@@ -61,10 +61,13 @@ class priority_class_data;
 
 class io_queue {
 private:
+    class discard_queue;
+
     std::vector<std::unique_ptr<priority_class_data>> _priority_classes;
     io_group_ptr _group;
     fair_queue _fq;
     internal::io_sink& _sink;
+    std::unique_ptr<discard_queue> _discards;
 
     priority_class_data& find_or_create_class(const io_priority_class& pc);
 
@@ -98,6 +101,8 @@ class io_queue {
         float disk_us_per_byte = 0;
         size_t disk_read_saturation_length = std::numeric_limits<size_t>::max();
         size_t disk_write_saturation_length = std::numeric_limits<size_t>::max();
+        uint64_t discard_bytes_rate = std::numeric_limits<uint64_t>::max();
+        size_t discard_max_request_size = 32 << 20;
         sstring mountpoint = "undefined";
     };
 
@@ -108,9 +113,15 @@ class io_queue {
 
     future<size_t>
     queue_request(const io_priority_class& pc, size_t len, internal::io_request req, io_intent* intent) noexcept;
+    // Discards are coalesced with adjacent queued ones and fed into the fair
+    // queue in chunks of at most discard_max_request_size bytes, paced to
+    // discard_bytes_rate. The future resolves when the whole coalesced range
+    // has been discarded.
+    future<> queue_discard(const io_priority_class& pc, internal::io_request req) noexcept;
     void submit_request(io_desc_read_write* desc, internal::io_request req) noexcept;
     void cancel_request(queued_io_request& req) noexcept;
     void complete_cancelled_request(queued_io_request& req) noexcept;
+    void cancel_inflight_request(io_desc_read_write* desc) noexcept;
 
     [[deprecated("modern I/O queues should use a property file")]] size_t capacity() const;
 
@@ -130,9 +141,7 @@ class io_queue {
     // Dispatch requests that are pending in the I/O queue
     void poll_io_queue();
 
-    std::chrono::steady_clock::time_point next_pending_aio() const noexcept {
-        return _fq.next_pending_aio();
-    }
+    std::chrono::steady_clock::time_point next_pending_aio() const noexcept;
 
     sstring mountpoint() const;
     dev_t dev_id() const noexcept;
@@ -39,6 +39,8 @@
 #include <seastar/core/temporary_buffer.hh>
 #include <seastar/core/scattered_message.hh>
 #include <seastar/util/std-compat.hh>
+#include <chrono>
+#include <optional>
 
 namespace seastar {
 
@@ -50,6 +52,11 @@ class data_source_impl {
     virtual future<temporary_buffer<char>> get() = 0;
     virtual future<temporary_buffer<char>> skip(uint64_t n);
     virtual future<> close() { return make_ready_future<>(); }
+    // When the data last returned by get() arrived, for sources that
+    // timestamp what they receive
+    virtual std::optional<std::chrono::system_clock::time_point> receive_timestamp() const noexcept {
+        return std::nullopt;
+    }
 };
 
 class data_source {
@@ -85,6 +92,9 @@ class data_source {
             return current_exception_as_future<>();
         }
     }
+    std::optional<std::chrono::system_clock::time_point> receive_timestamp() const noexcept {
+        return _dsi ? _dsi->receive_timestamp() : std::nullopt;
+    }
 };
 
 class data_sink_impl {
@@ -310,6 +320,14 @@ class input_stream final {
     /// Ignores n next bytes from the stream.
     future<> skip(uint64_t n) noexcept;
 
+    /// When the data most recently read from the underlying source arrived,
+    /// if the source timestamps it (see
+    /// \ref connected_socket_input_stream_config::receive_timestamps).
+    /// Data the stream still buffers may have arrived earlier.
+    std::optional<std::chrono::system_clock::time_point> receive_timestamp() const noexcept {
+        return _fd.receive_timestamp();
+    }
+
     /// Detaches the underlying \c data_source from the \c input_stream.
     ///
     /// The intended usage is custom \c data_source_impl implementations
@@ -23,12 +23,16 @@
 
 #include <seastar/core/resource.hh>
 #include <seastar/core/bitops.hh>
+#include <array>
 #include <new>
 #include <functional>
+#include <limits>
 #include <vector>
 
 namespace seastar {
 
+class scheduling_group;
+
 /// \defgroup memory-module Memory management
 ///
 /// Functions and classes for managing memory.
@@ -136,6 +140,12 @@ static constexpr size_t huge_page_size =
 void configure(std::vector<resource::memory> m, bool mbind,
         std::optional<std::string> hugetlbfs_path = {});
 
+// Faults in all of the calling shard's memory and returns its size in bytes.
+// Must run on the shard's own thread after configure(), so that pages are
+// allocated on the NUMA node the shard's memory was bound to. If memory is
+// locked with mlockall(MCL_FUTURE | MCL_ONFAULT), this also locks it.
+size_t prefault();
+
 void enable_abort_on_allocation_failure();
 
 class disable_abort_on_alloc_failure_temporarily {
@@ -218,6 +228,11 @@ bool drain_cross_cpu_freelist();
 void set_reclaim_hook(
         std::function<void (std::function<void ()>)> hook);
 
+// Clears the soft limit and statistics of a destroyed scheduling group on
+// this shard, and moves the memory still charged to it to the default group,
+// so that its id can be reused right away. Walks the page array.
+void release_scheduling_group_memory(scheduling_group sg) noexcept;
+
 /// \endcond
 
 class statistics;
@@ -291,6 +306,84 @@ size_t min_free_memory();
 /// Sets the value of free memory low water mark in memory::page_size units.
 void set_min_free_pages(size_t pages);
 
+/// Memory usage of a scheduling group on this shard.
+struct scheduling_group_memory_stats {
+    /// Memory (in bytes) charged to the group.
+    size_t allocated_memory = 0;
+    /// The group's soft limit (in bytes), see set_scheduling_group_memory_soft_limit().
+    size_t soft_limit = std::numeric_limits<size_t>::max();
+    /// Number of times the group went over its soft limit.
+    uint64_t soft_limit_exceeded = 0;
+    /// Whether the group is currently over its soft limit.
+    bool over_soft_limit = false;
+};
+
+/// Returns the memory usage of a scheduling group on this shard.
+///
+/// The allocator charges memory to the scheduling group that is current when
+/// it takes pages from the free page pool: the pages of a large allocation,
+/// or a span of pages that refills a small-object pool. Accounting is exact
+/// for large allocations and approximate (by span) for small ones, which
+/// keeps it off the small-allocation fast path.
+///
+/// Not supported with the default allocator, which reports nothing.
+scheduling_group_memory_stats scheduling_group_memory(scheduling_group sg) noexcept;
+
+/// Sets a soft limit on the memory charged to a scheduling group on this shard.
+///
+/// Allocations never fail because of a soft limit. Instead, when the group
+/// goes over it, \c on_exceeded is run from a task (outside the allocator)
+/// so that the group can shed memory, e.g. by evicting cached data, and
+/// scheduling_group_memory() reports the group as over its limit, which
+/// admission control can use to throttle the group's new work. \c on_exceeded
+/// runs again the next time the group crosses the limit after dropping below it.
+/// A group that is already over the new limit is treated as having just
+/// crossed it.
+///
+/// \param sg the group to limit
+/// \param limit the limit in bytes; \c std::numeric_limits<size_t>::max() for none
+/// \param on_exceeded called when the group goes over the limit; may be empty
+void set_scheduling_group_memory_soft_limit(scheduling_group sg, size_t limit, std::function<void ()> on_exceeded = {});
+
+/// Fragmentation of the free memory of this shard.
+struct fragmentation_stats {
+    /// Number of free spans of each size: \c free_spans[i] counts the
+    /// free spans of 2^i pages.
+    std::array<size_t, 32> free_spans = {};
+    /// Size (in bytes) of the largest free span, i.e. of the largest
+    /// allocation that can be satisfied without reclaiming memory.
+    size_t largest_free_span = 0;
+    /// 1 - largest_free_span / free memory: 0 when all free memory is
+    /// contiguous, approaching 1 as it is scattered in small spans.
+    double fragmentation = 0;
+    /// Number of live remapped allocations, see set_remapped_allocation_threshold().
+    uint64_t remapped_allocations = 0;
+    /// Memory (in bytes) used by live remapped allocations, including their headers.
+    size_t remapped_memory = 0;
+};
+
+/// Returns the fragmentation of the free memory of this shard.
+///
+/// Not supported with the default allocator, which reports nothing.
+fragmentation_stats fragmentation() noexcept;
+
+/// Sets the size above which allocations may be remapped.
+///
+/// An allocation of at least \c threshold bytes that finds no contiguous free
+/// span is assembled from scattered free spans, whose pages are moved with
+/// mremap() into a separate virtual address window, instead of reclaiming
+/// memory until a contiguous span frees up. Each such allocation costs an
+/// extra page and a few system calls, so the threshold should be large.
+///
+/// Remapping is only available for anonymous memory, not for memory
+/// backed by hugetlbfs, and is not supported with the default allocator.
+///
+/// Thresholds below the largest span used by the small object pools
+/// (128KB with 4KB pages) are raised to just above it.
+///
+/// \param threshold size in bytes; \c std::numeric_limits<size_t>::max() disables remapping
+void set_remapped_allocation_threshold(size_t threshold);
+
 /// Enable the large allocation warning threshold.
 ///
 /// Warn when allocation above a given threshold are performed.
@@ -20,6 +20,8 @@
  */
 
 #pragma once
+#include <array>
+#include <cstdint>
 #include <vector>
 
 namespace seastar {
@@ -78,6 +80,56 @@ struct histogram {
 
 };
 
+/*!
+ * \brief Exponential histogram implementation
+ *
+ * Counts samples into \c NrBuckets buckets whose upper bounds start at
+ * \c first_bound and double from one bucket to the next; the last bucket
+ * also takes everything above its bound. Adding a sample does not allocate.
+ */
+template <unsigned NrBuckets>
+class exponential_histogram {
+    static_assert(NrBuckets > 0);
+    double _first_bound;
+    std::array<uint64_t, NrBuckets> _counts = {};
+    uint64_t _samples = 0;
+    double _sum = 0;
+public:
+    explicit constexpr exponential_histogram(double first_bound) noexcept : _first_bound(first_bound) {}
+
+    void add(double v) noexcept {
+        _samples++;
+        _sum += v;
+        auto bound = _first_bound;
+        unsigned bucket = 0;
+        while (bucket + 1 < NrBuckets && v > bound) {
+            bound *= 2;
+            bucket++;
+        }
+        _counts[bucket]++;
+    }
+
+    uint64_t samples() const noexcept {
+        return _samples;
+    }
+
+    histogram get() const {
+        histogram h;
+        h.sample_count = _samples;
+        h.sample_sum = _sum;
+        h.buckets.resize(NrBuckets);
+        uint64_t cumulative = 0;
+        auto bound = _first_bound;
+        for (unsigned i = 0; i < NrBuckets; i++) {
+            cumulative += _counts[i];
+            h.buckets[i].count = cumulative;
+            h.buckets[i].upper_bound = bound;
+            bound *= 2;
+        }
+        return h;
+    }
+};
+
 }
 
 }
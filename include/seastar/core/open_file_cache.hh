@@ -0,0 +1,146 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#pragma once
+
+#include <seastar/core/file.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/shared_future.hh>
+#include <seastar/core/shared_ptr.hh>
+#include <seastar/core/sstring.hh>
+#include <boost/intrusive/list.hpp>
+#include <unordered_map>
+
+namespace seastar {
+
+/// \addtogroup fileio-module
+/// @{
+
+/// Configuration of an \ref open_file_cache.
+struct open_file_cache_config {
+    /// Number of open file descriptors above which idle ones are closed,
+    /// least recently used first. Files in use are never closed, so the
+    /// budget can be exceeded while all cached files are in use.
+    size_t max_open_files = 1024;
+};
+
+/// A per-shard cache of open files.
+///
+/// open() hands out \ref file objects sharing one file descriptor per path
+/// and open flags. Closing such a file (or destroying it) only releases it;
+/// the descriptor stays open, for reuse by later open() calls, until it is
+/// evicted under the \ref open_file_cache_config::max_open_files budget.
+///
+/// Entries must be invalidated when the path they were opened with is
+/// renamed or unlinked, either explicitly with invalidate() or the
+/// remove_file()/rename_file() helpers, or by watching the directory with
+/// watch_directory(). Files already handed out keep referring to the old
+/// inode. Paths are compared as strings, so the same spelling must be used
+/// for opening and invalidating.
+class open_file_cache {
+public:
+    struct stats {
+        uint64_t hits = 0;      ///< open() calls served from the cache
+        uint64_t misses = 0;    ///< open() calls that opened a new descriptor
+        uint64_t evictions = 0; ///< idle descriptors closed to stay under the budget
+        uint64_t bypasses = 0;  ///< open() calls with create, truncate or exclusive, which are not cached
+        size_t open_files = 0;  ///< file descriptors currently open
+    };
+private:
+    struct entry : public enable_lw_shared_from_this<entry> {
+        sstring name;
+        open_flags flags;
+        file f;
+        shared_future<> opened;
+        unsigned users = 0;
+        // Still reachable through _entries
+        bool mapped = true;
+        boost::intrusive::list_member_hook<> _lru_link;
+
+        entry(sstring name, open_flags flags) : name(std::move(name)), flags(flags) {}
+    };
+    class cached_file_impl;
+    class watcher;
+    using lru_list = boost::intrusive::list<entry,
+            boost::intrusive::member_hook<entry, boost::intrusive::list_member_hook<>, &entry::_lru_link>,
+            boost::intrusive::constant_time_size<false>>;
+
+    open_file_cache_config _cfg;
+    std::unordered_multimap<sstring, lw_shared_ptr<entry>> _entries;
+    // Entries not in use, least recently used first
+    lru_list _lru;
+    stats _stats;
+    gate _gate;
+    std::unique_ptr<watcher> _watcher;
+    bool _closing = false;
+
+    void acquire(entry& e);
+    void release(lw_shared_ptr<entry> e) noexcept;
+    void close_entry(lw_shared_ptr<entry> e) noexcept;
+    void evict() noexcept;
+    void unmap(entry& e) noexcept;
+    future<file> wait_opened(lw_shared_ptr<entry> e) noexcept;
+public:
+    explicit open_file_cache(open_file_cache_config cfg = {});
+    open_file_cache(const open_file_cache&) = delete;
+    ~open_file_cache();
+
+    /// Returns a file for \c name opened with \c flags, opening it if
+    /// it is not cached. \c options are only used when opening.
+    ///
+    /// Opens with open_flags::create, open_flags::truncate or
+    /// open_flags::exclusive have effects a cached descriptor would skip,
+    /// so they bypass the cache and return an ordinary, uncached file.
+    ///
+    /// The returned file must be closed (or destroyed) to release it;
+    /// dup() is not supported.
+    future<file> open(sstring name, open_flags flags, file_open_options options = {}) noexcept;
+
+    /// Forgets all cached descriptors of \c name. Idle ones are closed,
+    /// those in use are closed when released.
+    void invalidate(const sstring& name) noexcept;
+
+    /// Invalidates \c name and removes the file.
+    future<> remove_file(sstring name) noexcept;
+
+    /// Invalidates both names and renames the file.
+    future<> rename_file(sstring old_name, sstring new_name) noexcept;
+
+    /// Invalidates cached files of \c directory whenever an entry of it is
+    /// removed or renamed, as reported by inotify.
+    ///
+    /// Changes done by other processes are seen with a delay; use the
+    /// explicit helpers for changes made by this shard.
+    future<> watch_directory(sstring directory);
+
+    /// Closes all descriptors and stops watching directories. Waits for
+    /// all the files handed out to be released.
+    future<> close() noexcept;
+
+    const stats& get_stats() const noexcept {
+        return _stats;
+    }
+};
+
+/// @}
+
+}
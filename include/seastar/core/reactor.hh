@@ -45,6 +45,7 @@
 #include <system_error>
 #include <chrono>
 #include <ratio>
+#include <array>
 #include <atomic>
 #include <stack>
 #include <seastar/util/std-compat.hh>
@@ -77,6 +78,7 @@
 #include <seastar/core/lowres_clock.hh>
 #include <seastar/core/manual_clock.hh>
 #include <seastar/core/metrics_registration.hh>
+#include <seastar/core/metrics_types.hh>
 #include <seastar/core/scheduling.hh>
 #include <seastar/core/scheduling_specific.hh>
 #include <seastar/core/smp.hh>
@@ -142,6 +144,10 @@ class reactor_backend_selector;
 
 class reactor_backend;
 
+namespace net {
+class egress_scheduler;
+}
+
 namespace internal {
 
 class reactor_stall_sampler;
@@ -216,6 +222,7 @@ class reactor {
     friend class reactor_backend_aio;
     friend class reactor_backend_selector;
     friend class aio_storage_context;
+    friend class scheduling_deadline;
 public:
     using poller = internal::poller;
     using idle_cpu_handler_result = seastar::idle_cpu_handler_result;
@@ -228,6 +235,7 @@ class reactor {
         uint64_t aio_writes = 0;
         uint64_t aio_write_bytes = 0;
         uint64_t aio_errors = 0;
+        uint64_t aio_cancels = 0;
         uint64_t fstream_reads = 0;
         uint64_t fstream_read_bytes = 0;
         uint64_t fstream_reads_blocked = 0;
@@ -298,6 +306,7 @@ class reactor {
     timer_set<timer<manual_clock>, &timer<manual_clock>::_link>::timer_list_t _expired_manual_timers;
     io_stats _io_stats;
     uint64_t _fsyncs = 0;
+    uint64_t _epoll_ctls = 0;
     uint64_t _cxx_exceptions = 0;
     uint64_t _abandoned_failed_futures = 0;
     struct task_queue {
@@ -319,8 +328,17 @@ class reactor {
         void set_shares(float shares) noexcept;
         struct indirect_compare;
         sched_clock::duration _time_spent_on_task_quota_violations = {};
+        // Zero means the reactor-wide --task-quota-ms
+        sched_clock::duration _task_quota = {};
+        // Runtime, in microseconds, of slices that ended with the queue preempted
+        metrics::exponential_histogram<10> _preemption_latency{25};
+        // Registered scheduling_deadline:s; the earliest one is the queue's deadline
+        scheduling_deadline::container_type _deadlines;
+        uint64_t _deadlines_completed = 0;
+        uint64_t _deadline_misses = 0;
         seastar::metrics::metric_groups _metrics;
         void rename(sstring new_name);
+        void account_preemption(sched_clock::duration runtime) noexcept;
     private:
         void register_stats();
     };
@@ -332,6 +350,10 @@ class reactor {
     task_queue_list _activating_task_queues;
     task_queue* _at_destroy_tasks;
     sched_clock::duration _task_quota;
+    // The period the task quota timer currently ticks at, zero while it is stopped
+    sched_clock::duration _armed_task_quota = {};
+    // Number of task queues with at least one registered deadline
+    unsigned _task_queues_with_deadlines = 0;
     task* _current_task = nullptr;
     /// Handler that will be called when there is no task to execute on cpu.
     /// It represents a low priority work.
@@ -343,6 +365,7 @@ class reactor {
     /// otherwise. This function should be used by a handler to return early if a task appears.
     idle_cpu_handler _idle_cpu_handler{ [] (work_waiting_on_reactor) {return idle_cpu_handler_result::no_more_work;} };
     std::unique_ptr<network_stack> _network_stack;
+    std::unique_ptr<net::egress_scheduler> _egress_scheduler;
     // _lowres_clock_impl will only be created on cpu 0
     std::unique_ptr<lowres_clock_impl> _lowres_clock_impl;
     lowres_clock::time_point _lowres_next_timeout;
@@ -355,7 +378,9 @@ class reactor {
     sched_clock::duration _total_sleep;
     sched_clock::time_point _start_time = sched_clock::now();
     std::chrono::nanoseconds _max_poll_time = calculate_poll_time();
-    circular_buffer<output_stream<char>* > _flush_batching;
+    // Streams waiting for the flush poller, with the scheduling group that
+    // requested the flush, which the poller runs it under
+    circular_buffer<std::pair<output_stream<char>*, scheduling_group>> _flush_batching;
     std::atomic<bool> _sleeping alignas(seastar::cache_line_size){0};
     pthread_t _thread_id alignas(seastar::cache_line_size) = pthread_self();
     bool _strict_o_direct = true;
@@ -363,6 +388,7 @@ class reactor {
     bool _bypass_fsync = false;
     bool _have_aio_fsync = false;
     bool _kernel_page_cache = false;
+    bool _epoll_edge_triggered = false;
     std::atomic<bool> _dying{false};
 private:
     static std::chrono::nanoseconds calculate_poll_time();
@@ -430,8 +456,13 @@ class reactor {
     void activate(task_queue& tq);
     void insert_active_task_queue(task_queue* tq);
     task_queue* pop_active_task_queue(sched_clock::time_point now);
+    size_t most_urgent_active_task_queue() noexcept;
     void insert_activating_task_queues();
     void account_runtime(task_queue& tq, sched_clock::duration runtime);
+    sched_clock::duration task_quota_for(const task_queue& tq) const noexcept {
+        return tq._task_quota.count() ? tq._task_quota : _task_quota;
+    }
+    void arm_task_quota_timer(sched_clock::duration quota);
     void account_idle(sched_clock::duration idletime);
     void allocate_scheduling_group_specific_data(scheduling_group sg, scheduling_group_key key);
     future<> init_scheduling_group(scheduling_group sg, sstring name, float shares);
@@ -515,6 +546,9 @@ class reactor {
     future<> touch_directory(std::string_view name, file_permissions permissions = file_permissions::default_dir_permissions) noexcept;
     future<std::optional<directory_entry_type>>  file_type(std::string_view name, follow_symlink = follow_symlink::yes) noexcept;
     future<stat_data> file_stat(std::string_view pathname, follow_symlink) noexcept;
+    // Stats all the given paths in a single syscall thread round-trip. Paths
+    // that do not exist (ENOENT/ENOTDIR) yield a disengaged optional.
+    future<std::vector<std::optional<stat_data>>> file_stat_batch(std::vector<sstring> pathnames, follow_symlink) noexcept;
     future<uint64_t> file_size(std::string_view pathname) noexcept;
     future<bool> file_accessible(std::string_view pathname, access_flags flags) noexcept;
     future<bool> file_exists(std::string_view pathname) noexcept {
@@ -607,6 +641,9 @@ class reactor {
     void add_high_priority_task(task*) noexcept;
 
     network_stack& net() { return *_network_stack; }
+    /// Returns this shard's egress scheduler, or nullptr when connected
+    /// socket writes are not paced (see --network-egress-bandwidth)
+    net::egress_scheduler* network_egress_scheduler() noexcept { return _egress_scheduler.get(); }
 
     [[deprecated("Use this_shard_id")]]
     shard_id cpu_id() const;
@@ -625,6 +662,8 @@ class reactor {
     /// \return An object containing a snapshot of the statistics at this point in time.
     sched_stats get_sched_stats() const;
     uint64_t abandoned_failed_futures() const { return _abandoned_failed_futures; }
+    /// Returns the number of epoll_ctl() calls made by the epoll backend on this shard.
+    uint64_t epoll_ctl_calls() const { return _epoll_ctls; }
 #ifdef HAVE_OSV
     void timer_thread_func();
     void set_timer(sched::timer &tmr, s64 t);
@@ -664,6 +703,7 @@ class reactor {
     friend struct pollable_fd_state_deleter;
     friend class posix_file_impl;
     friend class blockdev_file_impl;
+    friend class io_queue;
     friend class readable_eventfd;
     friend class timer<>;
     friend class timer<lowres_clock>;
@@ -672,6 +712,7 @@ class reactor {
     friend class smp_message_queue;
     friend class internal::poller;
     friend class scheduling_group;
+    friend class net::egress_scheduler;
     friend void add_to_flush_poller(output_stream<char>* os);
     friend void seastar::log_exception_trace() noexcept;
     friend void report_failed_future(const std::exception_ptr& eptr) noexcept;
@@ -699,6 +740,8 @@ class reactor {
 
     future<struct stat> fstat(int fd) noexcept;
     future<struct statfs> fstatfs(int fd) noexcept;
+    // Asks the backend to cancel a request already submitted to the kernel
+    void cancel_io(io_completion* desc) noexcept;
     friend future<shared_ptr<file_impl>> make_file_impl(int fd, file_open_options options, int flags) noexcept;
 public:
     future<> readable(pollable_fd_state& fd);
@@ -0,0 +1,87 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace seastar {
+
+/// \addtogroup future-util
+/// @{
+
+/// Identifies the request a task works on, for tracing.
+///
+/// Every task records the request context that was current when it was
+/// created, and the reactor makes it current again while the task runs.
+/// Continuations therefore inherit the context of the code that attached
+/// them, work submitted with \ref smp::submit_to() runs under the
+/// submitter's context on the remote shard, and RPC clients that negotiate
+/// it send the context along with each request.
+///
+/// Recording the context in every task costs 16 bytes per task, so it is
+/// only done when Seastar is built with SEASTAR_REQUEST_CONTEXT
+/// (configure.py --enable-request-context). Without it, the context is only
+/// current while the function passed to \ref with_request_context() runs
+/// synchronously, which is still enough for RPC and execution stages to
+/// pick it up, but not for continuations or \ref smp::submit_to().
+///
+/// A default-constructed context (with a zero \c trace_id) means the work
+/// is not traced. Use \ref with_request_context() to install a context and
+/// \ref with_span() to record a span of a traced request.
+struct request_context {
+    /// Identifies the request across shards and nodes; zero if untraced.
+    uint64_t trace_id = 0;
+    /// Identifies the span within the request that the work belongs to.
+    uint64_t span_id = 0;
+
+    explicit operator bool() const noexcept { return trace_id != 0; }
+    bool operator==(const request_context& x) const noexcept {
+        return trace_id == x.trace_id && span_id == x.span_id;
+    }
+    bool operator!=(const request_context& x) const noexcept { return !(*this == x); }
+};
+
+/// @}
+
+/// \cond internal
+namespace internal {
+
+inline
+request_context*
+current_request_context_ptr() noexcept {
+    static thread_local request_context ctx;
+    return &ctx;
+}
+
+}
+/// \endcond
+
+/// Returns the request context of the running task.
+inline
+request_context
+current_request_context() noexcept {
+    return *internal::current_request_context_ptr();
+}
+
+}
@@ -0,0 +1,269 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#pragma once
+
+#include <seastar/core/future.hh>
+#include <seastar/util/std-compat.hh>
+#include <seastar/util/exceptions.hh>
+#include <exception>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace seastar {
+
+/// \addtogroup future-util
+/// @{
+
+/// \brief Wraps an error value to construct a failed \ref result.
+///
+/// Plays the role of \c std::unexpected: it disambiguates the error from
+/// the value when both could be constructed from the same argument.
+template <typename E>
+class failure {
+    E _error;
+public:
+    explicit failure(E error) noexcept(std::is_nothrow_move_constructible<E>::value)
+        : _error(std::move(error)) {}
+
+    E& error() & noexcept { return _error; }
+    const E& error() const & noexcept { return _error; }
+    E&& error() && noexcept { return std::move(_error); }
+};
+
+/// Creates a \ref failure holding \c error.
+template <typename E>
+failure<std::decay_t<E>> make_failure(E&& error) {
+    return failure<std::decay_t<E>>(std::forward<E>(error));
+}
+
+/// \brief Converts the error of a \ref result into an exception.
+///
+/// Used only when a failed result has to leave the value-based error
+/// path, i.e. by \ref result::value() and \ref to_future(). Specialize it
+/// for error types that are not exceptions themselves.
+template <typename E>
+struct result_error_traits {
+    static std::exception_ptr to_exception(const E& error) noexcept {
+        return std::make_exception_ptr(error);
+    }
+};
+
+template <>
+struct result_error_traits<std::error_code> {
+    static std::exception_ptr to_exception(const std::error_code& error) noexcept {
+        return std::make_exception_ptr(std::system_error(error));
+    }
+};
+
+template <>
+struct result_error_traits<std::exception_ptr> {
+    static std::exception_ptr to_exception(const std::exception_ptr& error) noexcept {
+        return error;
+    }
+};
+
+/// \brief Holds either a value or an error, without using exceptions.
+///
+/// Failing a future costs an \c exception_ptr allocation, and inspecting
+/// the failure often costs a rethrow. That's fine for real errors, but not
+/// for expected ones -- timeouts, "not found", requests shed under
+/// overload -- which are frequent exactly when the CPU is scarce. Such
+/// errors can instead be returned as a value, in a \c future<result<T, E>>;
+/// the future itself then only fails for unexpected errors.
+///
+/// \code
+/// future<result<item, std::error_code>> lookup(key k) {
+///     if (overloaded()) {
+///         return make_ready_future<result<item, std::error_code>>(make_failure(make_error_code(std::errc::resource_unavailable_try_again)));
+///     }
+///     ...
+/// }
+///
+/// lookup(k).then([] (result<item, std::error_code> r) {
+///     if (!r) {
+///         // handle r.error() without any exception involved
+///     }
+///     use(*r);
+/// });
+/// \endcode
+///
+/// \tparam T the value type, may be \c void
+/// \tparam E the error type. To be converted into an exception by
+///           \ref result_error_traits, which by default throws E itself.
+template <typename T, typename E>
+class [[nodiscard]] result {
+    static_assert(!std::is_reference<T>::value, "result of a reference is not supported");
+    std::variant<T, failure<E>> _v;
+public:
+    using value_type = T;
+    using error_type = E;
+
+    template <typename U = T, typename = std::enable_if_t<std::is_constructible<T, U&&>::value
+            && !std::is_same<std::decay_t<U>, result>::value
+            && !std::is_same<std::decay_t<U>, failure<E>>::value>>
+    result(U&& value) : _v(std::in_place_index<0>, std::forward<U>(value)) {}
+    result(failure<E> f) noexcept(std::is_nothrow_move_constructible<E>::value)
+        : _v(std::in_place_index<1>, std::move(f)) {}
+    template <typename... A>
+    explicit result(std::in_place_t, A&&... a) : _v(std::in_place_index<0>, std::forward<A>(a)...) {}
+
+    bool has_value() const noexcept { return _v.index() == 0; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    /// Returns the value, or throws the error converted by \ref result_error_traits.
+    T& value() & {
+        check();
+        return *std::get_if<0>(&_v);
+    }
+    const T& value() const & {
+        check();
+        return *std::get_if<0>(&_v);
+    }
+    T&& value() && {
+        check();
+        return std::move(*std::get_if<0>(&_v));
+    }
+
+    /// Accesses the value; undefined if the result holds an error.
+    T& operator*() & noexcept { return *std::get_if<0>(&_v); }
+    const T& operator*() const & noexcept { return *std::get_if<0>(&_v); }
+    T&& operator*() && noexcept { return std::move(*std::get_if<0>(&_v)); }
+    T* operator->() noexcept { return std::get_if<0>(&_v); }
+    const T* operator->() const noexcept { return std::get_if<0>(&_v); }
+
+    /// Accesses the error; undefined if the result holds a value.
+    E& error() & noexcept { return std::get_if<1>(&_v)->error(); }
+    const E& error() const & noexcept { return std::get_if<1>(&_v)->error(); }
+    E&& error() && noexcept { return std::move(*std::get_if<1>(&_v)).error(); }
+
+    /// Converts the error into an exception; undefined if the result holds a value.
+    std::exception_ptr error_as_exception() const noexcept {
+        return result_error_traits<E>::to_exception(error());
+    }
+
+private:
+    void check() const {
+        if (!has_value()) {
+            std::rethrow_exception(error_as_exception());
+        }
+    }
+};
+
+/// \brief A \ref result that carries no value on success.
+template <typename E>
+class [[nodiscard]] result<void, E> {
+    std::optional<failure<E>> _error;
+public:
+    using value_type = void;
+    using error_type = E;
+
+    result() noexcept = default;
+    result(failure<E> f) noexcept(std::is_nothrow_move_constructible<E>::value)
+        : _error(std::move(f)) {}
+
+    bool has_value() const noexcept { return !_error; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    /// Throws the error converted by \ref result_error_traits, if any.
+    void value() const {
+        if (_error) {
+            std::rethrow_exception(error_as_exception());
+        }
+    }
+
+    E& error() & noexcept { return _error->error(); }
+    const E& error() const & noexcept { return _error->error(); }
+    E&& error() && noexcept { return std::move(*_error).error(); }
+
+    std::exception_ptr error_as_exception() const noexcept {
+        return result_error_traits<E>::to_exception(error());
+    }
+};
+
+/// \brief Leaves the value-based error path.
+///
+/// Converts a \ref result into a ready future, failed with the error
+/// converted by \ref result_error_traits if the result holds one. Meant for
+/// the boundary with code that expects exceptions, so the conversion cost
+/// is paid once rather than at every layer.
+template <typename T, typename E>
+future<T> to_future(result<T, E>&& r) noexcept {
+    if (!r) {
+        return make_exception_future<T>(r.error_as_exception());
+    }
+    return make_ready_future<T>(std::move(*r));
+}
+
+template <typename E>
+future<> to_future(result<void, E>&& r) noexcept {
+    if (!r) {
+        return make_exception_future<>(r.error_as_exception());
+    }
+    return make_ready_future<>();
+}
+
+/// \brief Enters the value-based error path.
+///
+/// Resolves into a \ref result holding either the value of \c f or, if \c f
+/// failed with an exception of type \c Ex (or derived from it), that error as
+/// converted by \c convert. Other exceptions still fail the returned future.
+/// The type check does not rethrow the exception, see \ref try_catch().
+///
+/// \param f the future to wait for
+/// \param convert a callable taking \c Ex& and returning an \c E
+template <typename Ex, typename E, typename T, typename Convert>
+future<result<T, E>> catch_as_result(future<T>&& f, Convert&& convert) noexcept {
+    return f.then_wrapped([convert = std::forward<Convert>(convert)] (future<T> f) mutable -> future<result<T, E>> {
+        if (!f.failed()) {
+            return make_ready_future<result<T, E>>(result<T, E>(std::in_place, f.get0()));
+        }
+        auto ex = f.get_exception();
+        if (auto* p = try_catch<Ex>(ex)) {
+            return make_ready_future<result<T, E>>(make_failure(E(convert(*p))));
+        }
+        return make_exception_future<result<T, E>>(std::move(ex));
+    });
+}
+
+/// \copydoc catch_as_result()
+template <typename Ex, typename E, typename Convert>
+future<result<void, E>> catch_as_result(future<>&& f, Convert&& convert) noexcept {
+    return f.then_wrapped([convert = std::forward<Convert>(convert)] (future<> f) mutable -> future<result<void, E>> {
+        if (!f.failed()) {
+            return make_ready_future<result<void, E>>();
+        }
+        auto ex = f.get_exception();
+        if (auto* p = try_catch<Ex>(ex)) {
+            return make_ready_future<result<void, E>>(make_failure(E(convert(*p))));
+        }
+        return make_exception_future<result<void, E>>(std::move(ex));
+    });
+}
+
+/// @}
+
+} // namespace seastar
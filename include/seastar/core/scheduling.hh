@@ -21,7 +21,10 @@
 
 #pragma once
 
+#include <chrono>
+#include <set>
 #include <typeindex>
+#include <utility>
 #include <seastar/core/sstring.hh>
 #include <seastar/core/function_traits.hh>
 #include <seastar/util/concepts.hh>
@@ -283,6 +286,21 @@ class scheduling_group {
     /// \param shares number of shares allotted to the group. Use numbers
     ///               in the 1-1000 range.
     void set_shares(float shares) noexcept;
+    /// Sets the task quota of the group.
+    ///
+    /// The task quota is how long the reactor lets tasks run before it
+    /// preempts them to poll for I/O and events, and defaults to
+    /// `--task-quota-ms`. The reactor switches to the quota of the group it
+    /// is about to run, so a latency-sensitive group can be given a short
+    /// quota (for fine-grained preemption) and a batch group a long one
+    /// (for fewer switches). A short quota affects everything running
+    /// while the group is scheduled, including polling frequency. The
+    /// setting is local to the shard.
+    ///
+    /// \param quota the new quota, or zero to use the reactor-wide one again
+    void set_task_quota(std::chrono::nanoseconds quota) noexcept;
+    /// Returns the task quota in effect for the group on this shard.
+    std::chrono::nanoseconds task_quota() const noexcept;
     friend future<scheduling_group> create_scheduling_group(sstring name, float shares) noexcept;
     friend future<> destroy_scheduling_group(scheduling_group sg) noexcept;
     friend future<> rename_scheduling_group(scheduling_group sg, sstring new_name) noexcept;
@@ -307,6 +325,65 @@ class scheduling_group {
 
 };
 
+/// Registers a deadline with a scheduling group.
+///
+/// While at least one deadline is registered with a group, the reactor
+/// schedules it earliest-deadline-first: among the groups that have
+/// runnable tasks, the one with the most urgent deadline runs next,
+/// regardless of shares. Groups without deadlines are still ordered by
+/// their shares, and only run once no group with a deadline is runnable.
+/// The group's runtime is accounted as usual, so a group that used
+/// deadlines to jump ahead yields to the others once it no longer has any.
+///
+/// Since everything a task schedules inherits its scheduling group, a
+/// deadline registered for the duration of a request covers all the
+/// continuations it spawns; see \ref with_deadline().
+///
+/// The registration is local to the shard: it must be destroyed on the
+/// shard that created it, and before the group is destroyed.
+class scheduling_deadline {
+public:
+    using clock_type = std::chrono::steady_clock;
+    using time_point = clock_type::time_point;
+    /// \cond internal
+    using container_type = std::multiset<time_point>;
+    /// \endcond
+private:
+    scheduling_group _sg;
+    container_type::iterator _it;
+    bool _engaged = false;
+private:
+    void unregister() noexcept;
+public:
+    /// Registers \c deadline with the group \c sg.
+    scheduling_deadline(scheduling_group sg, time_point deadline);
+    /// Takes over the registration of \c x, which is left registering nothing.
+    scheduling_deadline(scheduling_deadline&& x) noexcept
+            : _sg(x._sg), _it(x._it), _engaged(std::exchange(x._engaged, false)) {}
+    /// Unregisters this deadline, then takes over the registration of \c x,
+    /// which is left registering nothing.
+    scheduling_deadline& operator=(scheduling_deadline&& x) noexcept {
+        if (this != &x) {
+            unregister();
+            _sg = x._sg;
+            _it = x._it;
+            _engaged = std::exchange(x._engaged, false);
+        }
+        return *this;
+    }
+    /// Unregisters the deadline, counting it as missed if it has passed.
+    ~scheduling_deadline() {
+        unregister();
+    }
+    /// Whether a deadline is registered; false once moved from.
+    explicit operator bool() const noexcept { return _engaged; }
+    /// The scheduling group the deadline is registered with.
+    scheduling_group group() const noexcept { return _sg; }
+    /// The registered deadline, or \c time_point::max() if none is
+    /// registered because this object was moved from.
+    time_point deadline() const noexcept { return _engaged ? *_it : time_point::max(); }
+};
+
 /// \cond internal
 namespace internal {
 
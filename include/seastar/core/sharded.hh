@@ -797,6 +797,14 @@ inline bool sharded<Service>::local_is_initialized() const noexcept {
 /// sends a message to the original core so that the wrapped object
 /// can be safely destroyed.
 ///
+/// Destruction is batched: the wrapped objects of all \c foreign_ptr<>
+/// objects destroyed on one core are sent to their owner core in a single
+/// message per poll of the cross-core queues, so dropping a large container
+/// of \c foreign_ptr<> does not flood them. As a result, wrapped objects
+/// released by one core are destroyed on their owner core in the order
+/// they were released, but possibly after work submitted later with
+/// \ref smp::submit_to() from the same core.
+///
 /// \c foreign_ptr<> is a move-only object; it cannot be copied.
 ///
 template <typename PtrType>
@@ -807,13 +815,10 @@ class foreign_ptr {
 private:
     void destroy(PtrType p, unsigned cpu) noexcept {
         if (p && this_shard_id() != cpu) {
-            // `destroy()` is called from the destructor and other
-            // synchronous methods (like `reset()`), that have no way to
-            // wait for this future.
-            (void)smp::submit_to(cpu, [v = std::move(p)] () mutable {
+            smp::destroy_on(cpu, [v = std::move(p)] () mutable {
                 // Destroy the contained pointer. We do this explicitly
                 // in the current shard, because the lambda is destroyed
-                // in the shard that submitted the task.
+                // in the shard that queued it.
                 v = {};
             });
         }
@@ -27,12 +27,20 @@
 #include <seastar/core/metrics.hh>
 #include <seastar/core/posix.hh>
 #include <seastar/core/reactor_config.hh>
+#include <seastar/util/noncopyable_function.hh>
 #include <boost/lockfree/spsc_queue.hpp>
 #include <boost/thread/barrier.hpp>
 #include <boost/range/irange.hpp>
 #include <boost/program_options.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
+#include <vector>
 
 /// \file
 
@@ -146,6 +154,14 @@ using smp_service_group_semaphore_units = semaphore_units<named_semaphore_except
 
 static constexpr smp_timeout_clock::time_point smp_no_timeout = smp_timeout_clock::time_point::max();
 
+/// Priority of a cross-shard message, see \ref smp_submit_to_options.
+enum class smp_message_priority {
+    /// The default, for bulk work.
+    normal,
+    /// For small, latency-critical messages.
+    high,
+};
+
 /// Options controlling the behaviour of \ref smp::submit_to().
 struct smp_submit_to_options {
     /// Controls resource allocation.
@@ -154,10 +170,19 @@ struct smp_submit_to_options {
     /// processed by the remote shard, and *not* to the time it takes to be
     /// executed there.
     smp_timeout_clock::time_point timeout = smp_no_timeout;
-
-    smp_submit_to_options(smp_service_group service_group = default_smp_service_group(), smp_timeout_clock::time_point timeout = smp_no_timeout) noexcept
+    /// Selects the lane the message travels in. Each pair of shards has one
+    /// lane per priority: high-priority messages are sent without waiting to
+    /// fill a batch and are not queued behind normal ones, and the receiving
+    /// shard takes a batch from the high-priority lane before each batch from
+    /// the normal lane. Unlike \c service_group, this affects ordering, not
+    /// concurrency.
+    smp_message_priority priority = smp_message_priority::normal;
+
+    smp_submit_to_options(smp_service_group service_group = default_smp_service_group(), smp_timeout_clock::time_point timeout = smp_no_timeout,
+            smp_message_priority priority = smp_message_priority::normal) noexcept
         : service_group(service_group)
-        , timeout(timeout) {
+        , timeout(timeout)
+        , priority(priority) {
     }
 };
 
@@ -169,6 +194,7 @@ class smp_message_queue {
     static constexpr size_t queue_length = 128;
     static constexpr size_t batch_size = 16;
     static constexpr size_t prefetch_cnt = 2;
+    static constexpr unsigned nr_lanes = 2; // one per smp_message_priority
     struct work_item;
     struct lf_queue_remote {
         reactor* remote;
@@ -182,6 +208,7 @@ class smp_message_queue {
         ~lf_queue();
     };
     lf_queue _pending;
+    lf_queue _pending_high;
     lf_queue _completed;
     struct alignas(seastar::cache_line_size) {
         size_t _sent = 0;
@@ -194,17 +221,30 @@ class smp_message_queue {
     // this makes sure that they have at least one cache line
     // between them, so hw prefetcher will not accidentally prefetch
     // cache line used by another cpu.
+    // Round-trip latency of messages, from submission until completion,
+    // in power-of-two buckets starting at 10us. Only measured with
+    // --smp-message-latency, so that the clock isn't read per message
+    // otherwise.
+    struct lane_stats {
+        metrics::exponential_histogram<14> latency{10}; // microseconds
+    };
+    std::array<lane_stats, nr_lanes> _lane_stats;
+    const bool _measure_latency;
     metrics::metric_groups _metrics;
     struct alignas(seastar::cache_line_size) {
         size_t _received = 0;
         size_t _last_rcv_batch = 0;
     };
     struct work_item : public task {
-        explicit work_item(smp_service_group ssg) : task(current_scheduling_group()), ssg(ssg) {}
+        work_item(smp_service_group ssg, smp_message_priority priority)
+            : task(current_scheduling_group()), ssg(ssg), lane(static_cast<unsigned>(priority)) {}
         smp_service_group ssg;
+        unsigned lane;
+        std::chrono::steady_clock::time_point submitted;
         virtual ~work_item() {}
         virtual void fail_with(std::exception_ptr) = 0;
         void process();
+        void process_urgent();
         virtual void complete() = 0;
     };
     template <typename Func>
@@ -217,7 +257,8 @@ class smp_message_queue {
         std::optional<value_type> _result;
         std::exception_ptr _ex; // if !_result
         typename futurator::promise_type _promise; // used on local side
-        async_work_item(smp_message_queue& queue, smp_service_group ssg, Func&& func) : work_item(ssg), _queue(queue), _func(std::move(func)) {}
+        async_work_item(smp_message_queue& queue, smp_submit_to_options options, Func&& func)
+            : work_item(options.service_group, options.priority), _queue(queue), _func(std::move(func)) {}
         virtual void fail_with(std::exception_ptr ex) override {
             _promise.set_exception(std::move(ex));
         }
@@ -254,21 +295,23 @@ class smp_message_queue {
         ~tx_side() {}
         void init() { new (&a) aa; }
         struct aa {
-            std::deque<work_item*> pending_fifo;
+            std::array<std::deque<work_item*>, nr_lanes> pending_fifo;
+            std::vector<noncopyable_function<void ()>> destroy_batch;
         } a;
     } _tx;
     std::vector<work_item*> _completed_fifo;
 public:
-    smp_message_queue(reactor* from, reactor* to);
+    smp_message_queue(reactor* from, reactor* to, bool measure_latency);
     ~smp_message_queue();
     template <typename Func>
     futurize_t<std::result_of_t<Func()>> submit(shard_id t, smp_submit_to_options options, Func&& func) noexcept {
         memory::scoped_critical_alloc_section _;
-        auto wi = std::make_unique<async_work_item<Func>>(*this, options.service_group, std::forward<Func>(func));
+        auto wi = std::make_unique<async_work_item<Func>>(*this, options, std::forward<Func>(func));
         auto fut = wi->get_future();
         submit_item(t, options.timeout, std::move(wi));
         return fut;
     }
+    void queue_destroy(shard_id t, noncopyable_function<void ()> destroy) noexcept;
     void start(unsigned cpuid);
     template<size_t PrefetchCnt, typename Func>
     size_t process_queue(lf_queue& q, Func process);
@@ -279,8 +322,10 @@ class smp_message_queue {
     void work();
     void submit_item(shard_id t, smp_timeout_clock::time_point timeout, std::unique_ptr<work_item> wi);
     void respond(work_item* wi);
-    void move_pending();
+    lf_queue& pending_lane(unsigned lane) noexcept { return lane ? _pending_high : _pending; }
+    void move_pending(unsigned lane);
     void flush_request_batch();
+    void flush_destroy_batch(shard_id t);
     void flush_response_batch();
     bool has_unflushed_responses() const;
     bool pure_poll_rx() const;
@@ -373,6 +418,15 @@ class smp : public std::enable_shared_from_this<smp> {
     static futurize_t<std::result_of_t<Func()>> submit_to(unsigned t, Func&& func) noexcept {
         return submit_to(t, default_smp_service_group(), std::forward<Func>(func));
     }
+    /// \cond internal
+    // Runs \c destroy on shard \c t, which must not be the current shard.
+    // Calls queued on this shard for shard \c t are sent as a single message
+    // the next time the queues are polled, and run in the order they were
+    // queued. Used by \ref foreign_ptr to destroy objects on their owner shard.
+    static void destroy_on(unsigned t, noncopyable_function<void ()> destroy) noexcept {
+        _qs[t][this_shard_id()].queue_destroy(t, std::move(destroy));
+    }
+    /// \endcond
     static bool poll_queues();
     static bool pure_poll_queues();
     static boost::integer_range<unsigned> all_cpus() noexcept {
@@ -440,6 +494,41 @@ class smp : public std::enable_shared_from_this<smp> {
     static future<> invoke_on_others(unsigned cpu_id, Func func) noexcept {
         return invoke_on_others(cpu_id, smp_submit_to_options{}, std::move(func));
     }
+    /// Runs CPU-bound work on a range, with help from other shards.
+    ///
+    /// Splits [\c begin, \c end) into chunks of \c chunk_size and calls
+    /// \c mapper(chunk_begin, chunk_end) on each. The calling shard works
+    /// through the chunks and asks every other shard to help: each helper
+    /// takes chunks from a shared, lock-free counter when it gets to run,
+    /// so idle shards take many chunks and busy ones few or none. Helpers
+    /// run in the caller's scheduling group and yield when preempted, so
+    /// the work competes with the helpers' own work according to that
+    /// group's shares.
+    ///
+    /// The results are combined on the calling shard, in chunk order, as
+    /// \c initial = \c reduce(std::move(initial), result).
+    ///
+    /// This is opt-in, and only suited for work that runs no continuations
+    /// and does not touch shard-local state: \c mapper is called concurrently
+    /// on several shards, and its results may be allocated on any of them.
+    ///
+    /// \param begin start of the range
+    /// \param end end of the range (exclusive)
+    /// \param chunk_size number of elements per call to \c mapper; large
+    ///        enough to amortize a cross-shard handoff, small enough that
+    ///        a chunk runs well within the task quota
+    /// \param mapper called as \c mapper(chunk_begin, chunk_end) on any shard
+    /// \param initial the initial value of the result
+    /// \param reduce called as \c reduce(Initial, mapper result) on the calling shard
+    /// \returns the reduced result; if \c mapper threw, the first exception,
+    ///          after all chunks in progress have finished
+    template <typename Mapper, typename Initial, typename Reducer>
+    static future<Initial> parallel_compute(size_t begin, size_t end, size_t chunk_size, Mapper mapper, Initial initial, Reducer reduce) noexcept;
+    /// Runs CPU-bound work on a range, with help from other shards.
+    ///
+    /// Like the map-reduce version, but for a \c func that returns nothing.
+    template <typename Func>
+    static future<> parallel_compute(size_t begin, size_t end, size_t chunk_size, Func func) noexcept;
 private:
     void start_all_queues();
     void pin(unsigned cpu_id);
@@ -449,4 +538,125 @@ class smp : public std::enable_shared_from_this<smp> {
     static unsigned count;
 };
 
+namespace internal {
+
+template <typename Mapper>
+struct parallel_compute_state {
+    using result_type = std::invoke_result_t<const Mapper&, size_t, size_t>;
+
+    const size_t begin;
+    const size_t end;
+    const size_t chunk_size;
+    const size_t nr_chunks;
+    const Mapper mapper;
+    const shard_id origin;
+    // The lock-free work queue: chunks are taken in order by bumping next
+    std::atomic<size_t> next = { 0 };
+    std::atomic<size_t> completed = { 0 };
+    std::atomic<bool> failed = { false };
+    std::mutex ex_mutex;
+    std::exception_ptr ex;
+    std::vector<std::optional<result_type>> results;
+    // Lives on origin until the last chunk completes
+    promise<>* done = nullptr;
+
+    parallel_compute_state(size_t begin, size_t end, size_t chunk_size, Mapper mapper)
+        : begin(begin)
+        , end(end)
+        , chunk_size(chunk_size)
+        , nr_chunks((end - begin + chunk_size - 1) / chunk_size)
+        , mapper(std::move(mapper))
+        , origin(this_shard_id())
+        , results(nr_chunks) {
+    }
+
+    void run_chunk(size_t i) noexcept {
+        if (!failed.load(std::memory_order_relaxed)) {
+            auto chunk_begin = begin + i * chunk_size;
+            auto chunk_end = std::min(end, chunk_begin + chunk_size);
+            try {
+                results[i].emplace(mapper(chunk_begin, chunk_end));
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(ex_mutex);
+                if (!ex) {
+                    ex = std::current_exception();
+                }
+            }
+        }
+    }
+
+    // Takes and runs chunks until none are left
+    static future<> work(std::shared_ptr<parallel_compute_state> s) noexcept {
+        return repeat([s] {
+            auto i = s->next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= s->nr_chunks) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            s->run_chunk(i);
+            // acq_rel so that whoever completes the last chunk sees all results
+            if (s->completed.fetch_add(1, std::memory_order_acq_rel) + 1 == s->nr_chunks) {
+                if (this_shard_id() == s->origin) {
+                    s->done->set_value();
+                } else {
+                    (void)smp::submit_to(s->origin, [s] {
+                        s->done->set_value();
+                    });
+                }
+            }
+            return make_ready_future<stop_iteration>(stop_iteration::no);
+        });
+    }
+};
+
+}
+
+template <typename Mapper, typename Initial, typename Reducer>
+future<Initial> smp::parallel_compute(size_t begin, size_t end, size_t chunk_size, Mapper mapper, Initial initial, Reducer reduce) noexcept {
+    using state_type = internal::parallel_compute_state<Mapper>;
+    if (begin >= end) {
+        return make_ready_future<Initial>(std::move(initial));
+    }
+    try {
+        auto s = std::make_shared<state_type>(begin, end, std::max<size_t>(chunk_size, 1), std::move(mapper));
+        auto done = std::make_unique<promise<>>();
+        s->done = done.get();
+        auto all_done = done->get_future();
+        auto helpers = std::min<size_t>(count - 1, s->nr_chunks - 1);
+        for (unsigned i = 1; i <= helpers; i++) {
+            // Helpers that arrive after the last chunk was taken return at once
+            (void)submit_to((s->origin + i) % count, [s] {
+                return state_type::work(s);
+            });
+        }
+        return state_type::work(s).then([all_done = std::move(all_done)] () mutable {
+            return std::move(all_done);
+        }).finally([done = std::move(done)] {
+            // Keep the promise alive until the last chunk completes
+        }).then([s, initial = std::move(initial), reduce = std::move(reduce)] () mutable {
+            // Destroy the results here, helpers may hold on to s for longer
+            auto results = std::exchange(s->results, {});
+            if (s->ex) {
+                return make_exception_future<Initial>(s->ex);
+            }
+            for (auto& r : results) {
+                initial = reduce(std::move(initial), std::move(*r));
+            }
+            return make_ready_future<Initial>(std::move(initial));
+        });
+    } catch (...) {
+        return current_exception_as_future<Initial>();
+    }
+}
+
+template <typename Func>
+future<> smp::parallel_compute(size_t begin, size_t end, size_t chunk_size, Func func) noexcept {
+    return parallel_compute(begin, end, chunk_size, [func = std::move(func)] (size_t chunk_begin, size_t chunk_end) {
+        func(chunk_begin, chunk_end);
+        return true;
+    }, true, [] (bool, bool) {
+        return true;
+    }).discard_result();
+}
+
 }
@@ -23,12 +23,16 @@
 
 #include <memory>
 #include <seastar/core/scheduling.hh>
+#include <seastar/core/request_context.hh>
 #include <seastar/util/backtrace.hh>
 
 namespace seastar {
 
 class task {
     scheduling_group _sg;
+#ifdef SEASTAR_REQUEST_CONTEXT
+    request_context _ctx;
+#endif
 #ifdef SEASTAR_TASK_BACKTRACE
     shared_backtrace _bt;
 #endif
@@ -39,11 +43,23 @@ class task {
     // information via inheritance.
     ~task() = default;
 public:
+#ifdef SEASTAR_REQUEST_CONTEXT
+    explicit task(scheduling_group sg = current_scheduling_group(), request_context ctx = current_request_context()) noexcept
+            : _sg(sg), _ctx(ctx) {}
+#else
     explicit task(scheduling_group sg = current_scheduling_group()) noexcept : _sg(sg) {}
+#endif
     virtual void run_and_dispose() noexcept = 0;
     /// Returns the next task which is waiting for this task to complete execution, or nullptr.
     virtual task* waiting_task() noexcept = 0;
     scheduling_group group() const { return _sg; }
+    /// Returns the request context the task was created under; always
+    /// untraced unless built with SEASTAR_REQUEST_CONTEXT.
+#ifdef SEASTAR_REQUEST_CONTEXT
+    request_context context() const noexcept { return _ctx; }
+#else
+    request_context context() const noexcept { return {}; }
+#endif
     shared_backtrace get_backtrace() const;
 #ifdef SEASTAR_TASK_BACKTRACE
     void make_backtrace() noexcept;
@@ -52,6 +68,17 @@ class task {
 #endif
 };
 
+// Every continuation is a task, so growing it costs memory and cache
+// footprint everywhere; optional fields must stay behind their build options
+static_assert(sizeof(task) == 2 * sizeof(void*)
+#ifdef SEASTAR_REQUEST_CONTEXT
+        + sizeof(request_context)
+#endif
+#ifdef SEASTAR_TASK_BACKTRACE
+        + sizeof(shared_backtrace)
+#endif
+        , "task grew");
+
 inline
 shared_backtrace task::get_backtrace() const {
 #ifdef SEASTAR_TASK_BACKTRACE
@@ -0,0 +1,123 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#pragma once
+
+#include <seastar/core/future.hh>
+#include <seastar/core/request_context.hh>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace seastar {
+
+/// \addtogroup future-util
+/// @{
+
+/// A completed span of a traced request, as recorded by \ref with_span().
+struct span_record {
+    uint64_t trace_id;
+    uint64_t span_id;
+    /// The span that was current when this one started; zero for a root span.
+    uint64_t parent_span_id;
+    /// The name passed to \ref with_span().
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    /// The shard the span ran on.
+    unsigned shard;
+};
+
+/// Creates the context of a new traced request.
+///
+/// The context gets a random trace id and no span; spans started under it
+/// with \ref with_span() are the roots of the trace.
+request_context new_request_context() noexcept;
+
+/// Returns the spans recorded on this shard since the last call, oldest first.
+std::vector<span_record> drain_spans();
+
+/// Sets how many spans this shard buffers until \ref drain_spans() is called.
+///
+/// When the buffer is full, the oldest span is dropped to make room.
+void set_span_buffer_capacity(size_t capacity) noexcept;
+
+/// Returns the number of spans this shard dropped because its buffer was full.
+uint64_t dropped_spans() noexcept;
+
+/// \cond internal
+namespace internal {
+
+uint64_t new_span_id() noexcept;
+void record_span(span_record span) noexcept;
+
+}
+/// \endcond
+
+/// \brief run a callable under a request context
+///
+/// Makes \c ctx the current request context while \c func runs. When
+/// Seastar is built with SEASTAR_REQUEST_CONTEXT, all the continuations and
+/// tasks \c func creates inherit it too.
+///
+/// \param ctx the request context to run under
+/// \param func function to run; its result is returned as a future
+template <typename Func>
+inline
+auto
+with_request_context(request_context ctx, Func&& func) noexcept {
+    auto& current = *internal::current_request_context_ptr();
+    auto prev = std::exchange(current, ctx);
+    auto f = futurize_invoke(std::forward<Func>(func));
+    current = prev;
+    return f;
+}
+
+/// \brief run a callable as a span of the current request
+///
+/// If the current request context is traced, runs \c func under a new span
+/// whose parent is the current span, and records it in this shard's span
+/// buffer once the future returned by \c func resolves. Otherwise just runs
+/// \c func.
+///
+/// \param name name of the span; must outlive the span buffer, so usually
+///             a string literal
+/// \param func function to run; its result is returned as a future
+template <typename Func>
+inline
+auto
+with_span(const char* name, Func&& func) noexcept {
+    auto parent = current_request_context();
+    if (!parent) {
+        return futurize_invoke(std::forward<Func>(func));
+    }
+    span_record span{parent.trace_id, internal::new_span_id(), parent.span_id, name,
+            std::chrono::steady_clock::now(), {}, 0};
+    return with_request_context(request_context{span.trace_id, span.span_id}, std::forward<Func>(func)).finally([span] {
+        internal::record_span(span);
+    });
+}
+
+/// @}
+
+}
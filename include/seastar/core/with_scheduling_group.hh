@@ -72,6 +72,35 @@ with_scheduling_group(scheduling_group sg, Func func, Args&&... args) noexcept {
     }
 }
 
+/// \brief run a callable in a scheduling group, ahead of a deadline
+///
+/// Like \ref with_scheduling_group(), but also registers \c deadline with
+/// the group (see \ref scheduling_deadline) until the future returned by the
+/// function resolves. Continuations of the function inherit the group, so
+/// the group is scheduled earliest-deadline-first for as long as the call
+/// is in progress.
+///
+/// \param sg  scheduling group that controls execution time for the function
+/// \param deadline  when the call should complete
+/// \param func function to run; must be movable or copyable
+/// \param args arguments to the function; may be copied or moved, so use \c std::ref()
+///             to force passing references
+template <typename Func, typename... Args>
+SEASTAR_CONCEPT( requires std::is_nothrow_move_constructible_v<Func> )
+inline
+auto
+with_deadline(scheduling_group sg, scheduling_deadline::time_point deadline, Func func, Args&&... args) noexcept {
+    static_assert(std::is_nothrow_move_constructible_v<Func>);
+    using return_type = decltype(func(std::forward<Args>(args)...));
+    using futurator = futurize<return_type>;
+    try {
+        scheduling_deadline d(sg, deadline);
+        return with_scheduling_group(sg, std::move(func), std::forward<Args>(args)...).finally([d = std::move(d)] {});
+    } catch (...) {
+        return futurator::make_exception_future(std::current_exception());
+    }
+}
+
 /// @}
 
 } // namespace seastar
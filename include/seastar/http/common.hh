@@ -69,6 +69,13 @@ enum operation_type {
  */
 operation_type str2type(const sstring& type);
 
+/**
+ * Translate the operation type to its string command
+ * @param type the operation type
+ * @return the command, e.g. "GET"
+ */
+sstring type2str(operation_type type);
+
 }
 
 }
@@ -23,6 +23,10 @@
 
 #include <seastar/http/handlers.hh>
 #include <seastar/core/iostream.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 namespace seastar {
 
@@ -59,6 +63,12 @@ class file_transformer {
  * with regards to file handling.
  * they both needs to read a file from the disk, optionally transform it,
  * and return the result or page not found on error
+ *
+ * Untransformed files are served with ETag and Last-Modified validators,
+ * which are derived from the file's stat data and cached for a short while.
+ * Conditional requests (If-None-Match, If-Modified-Since) that match are
+ * answered with 304 Not Modified without touching the file, and Range
+ * requests (including If-Range) are answered with 206 Partial Content.
  */
 class file_interaction_handler : public handler_base {
 public:
@@ -94,6 +104,32 @@ class file_interaction_handler : public handler_base {
      */
     static sstring get_extension(const sstring& file);
 
+    /**
+     * A byte range of a file, both ends inclusive.
+     */
+    struct byte_range {
+        uint64_t first;
+        uint64_t last;
+    };
+
+    /**
+     * Parse the value of a Range header against a file of the given size.
+     * Unsatisfiable ranges are dropped and the rest are clamped to the
+     * file size.
+     * @param value the Range header value, e.g. "bytes=0-99,-500"
+     * @param size the file size
+     * @return std::nullopt if the header is malformed, uses a unit other
+     * than bytes or lists too many ranges (the header should then be
+     * ignored), otherwise the satisfiable ranges, possibly none
+     */
+    static std::optional<std::vector<byte_range>> parse_range(const sstring& value, uint64_t size);
+
+    /**
+     * Number of ranges above which a Range header is ignored and the whole
+     * file is returned.
+     */
+    static constexpr size_t max_ranges = 16;
+
 protected:
 
     /**
@@ -108,6 +144,26 @@ class file_interaction_handler : public handler_base {
 
     output_stream<char> get_stream(std::unique_ptr<request> req,
             const sstring& extension, output_stream<char>&& s);
+
+private:
+    struct validators {
+        uint64_t size;
+        std::chrono::system_clock::time_point modified;
+        sstring etag;
+        sstring last_modified;
+        lowres_clock::time_point expires;
+    };
+    // Validators are looked up on every request; caching them saves a stat()
+    // per request. A changed file is noticed within validators_ttl.
+    static constexpr lowres_clock::duration validators_ttl = std::chrono::seconds(1);
+    static constexpr size_t max_cached_validators = 1024;
+    std::unordered_map<sstring, validators> _validators;
+
+    future<validators> get_validators(const sstring& file_name);
+    void read_file(const sstring& file_name, const sstring& extension,
+            std::unique_ptr<request> req, reply& rep);
+    void read_ranges(const sstring& file_name, const sstring& extension,
+            std::vector<byte_range> ranges, uint64_t size, reply& rep);
 };
 
 /**
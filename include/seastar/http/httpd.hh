@@ -39,10 +39,13 @@
 #include <bitset>
 #include <limits>
 #include <cctype>
+#include <ctime>
 #include <vector>
 #include <boost/intrusive/list.hpp>
 #include <seastar/http/routes.hh>
 #include <seastar/net/tls.hh>
+#include <seastar/net/tcp_info_sampler.hh>
+#include <seastar/net/arrival_latency.hh>
 #include <seastar/core/shared_ptr.hh>
 
 namespace seastar {
@@ -64,6 +67,7 @@ class http_stats {
 class connection : public boost::intrusive::list_base_hook<> {
     http_server& _server;
     connected_socket _fd;
+    net::tcp_info_sampler::registration _tcp_info;
     input_stream<char> _read_buf;
     output_stream<char> _write_buf;
     static constexpr size_t limit = 4096;
@@ -77,12 +81,13 @@ class connection : public boost::intrusive::list_base_hook<> {
 public:
     connection(http_server& server, connected_socket&& fd,
             socket_address addr)
-            : _server(server), _fd(std::move(fd)), _read_buf(_fd.input()), _write_buf(
+            : _server(server), _fd(std::move(fd)), _read_buf(_fd.input(input_config(server))), _write_buf(
                     _fd.output()) {
         on_new_connection();
     }
     ~connection();
     void on_new_connection();
+    static connected_socket_input_stream_config input_config(const http_server& server) noexcept;
 
     future<> process();
     void shutdown();
@@ -133,6 +138,7 @@ class http_server_tester;
 class http_server {
     std::vector<server_socket> _listeners;
     http_stats _stats;
+    net::tcp_info_sampler _tcp_info_sampler;
     uint64_t _total_connections = 0;
     uint64_t _current_connections = 0;
     uint64_t _requests_served = 0;
@@ -143,11 +149,14 @@ class http_server {
     timer<> _date_format_timer { [this] {_date = http_date();} };
     size_t _content_length_limit = std::numeric_limits<size_t>::max();
     bool _content_streaming = false;
+    bool _receive_timestamps = false;
+    net::arrival_latency_histogram _arrival_latency;
     gate _task_gate;
 public:
     routes _routes;
     using connection = seastar::httpd::connection;
-    explicit http_server(const sstring& name) : _stats(*this, name) {
+    explicit http_server(const sstring& name) : _stats(*this, name), _tcp_info_sampler(name) {
+        _routes.enable_metrics(name);
         _date_format_timer.arm_periodic(1s);
     }
     /*!
@@ -186,6 +195,15 @@ class http_server {
 
     void set_content_streaming(bool b);
 
+    bool get_receive_timestamps() const;
+
+    /// Makes connections accepted from now on get kernel receive timestamps,
+    /// so that the delay between the arrival of each request and its
+    /// dispatch is exported (as the request_arrival_latency_us histogram)
+    /// and available to handlers as \ref request::arrival_time.
+    /// Only supported by the posix stack.
+    void set_receive_timestamps(bool b);
+
     future<> listen(socket_address addr, listen_options lo);
     future<> listen(socket_address addr);
     future<> stop();
@@ -193,13 +211,23 @@ class http_server {
     future<> do_accepts(int which);
 
     uint64_t total_connections() const;
+    /// Samples the TCP state of the accepted connections; also gives the
+    /// latest sample of each of them, see \ref net::tcp_info_sampler
+    const net::tcp_info_sampler& tcp_info() const {
+        return _tcp_info_sampler;
+    }
     uint64_t current_connections() const;
     uint64_t requests_served() const;
     uint64_t read_errors() const;
     uint64_t reply_errors() const;
+    const net::arrival_latency_histogram& arrival_latency() const {
+        return _arrival_latency;
+    }
     // Write the current date in the specific "preferred format" defined in
     // RFC 7231, Section 7.1.1.1.
     static sstring http_date();
+    // Same as above, for an arbitrary point in time.
+    static sstring http_date(std::time_t t);
 private:
     future<> do_accept_one(int which);
     boost::intrusive::list<connection> _connections;
@@ -46,6 +46,15 @@ class matcher {
      * @return the end of of the matched part, or sstring::npos if not matched
      */
     virtual size_t match(const sstring& url, size_t ind, parameters& param) = 0;
+
+    /**
+     * The part of the url pattern this matcher matches, used to name the
+     * route in metrics
+     * @return e.g. "/file" or "/{path}"
+     */
+    virtual sstring pattern() const {
+        return "/*";
+    }
 };
 
 /**
@@ -78,6 +87,10 @@ class param_matcher : public matcher {
 
     virtual size_t match(const sstring& url, size_t ind, parameters& param)
             override;
+
+    virtual sstring pattern() const override {
+        return "/{" + _name + "}";
+    }
 private:
     sstring _name;
     bool _entire_path;
@@ -101,6 +114,10 @@ class str_matcher : public matcher {
 
     virtual size_t match(const sstring& url, size_t ind, parameters& param)
             override;
+
+    virtual sstring pattern() const override {
+        return _cmp;
+    }
 private:
     sstring _cmp;
     unsigned _len;
@@ -112,6 +112,23 @@ class match_rule {
         return *this;
     }
 
+    /**
+     * The url pattern of the rule, e.g. "/file/{path}"
+     */
+    sstring pattern() const {
+        sstring p;
+        for (auto m : _match_list) {
+            p += m->pattern();
+        }
+        return p;
+    }
+
+    /**
+     * The handler returned when the rule is met
+     */
+    handler_base* handler() const {
+        return _handler;
+    }
 private:
     std::vector<matcher*> _match_list;
     handler_base* _handler;
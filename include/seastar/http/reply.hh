@@ -43,6 +43,7 @@ namespace httpd {
 
 class connection;
 class routes;
+class reply_tester;
 
 /**
  * A reply to be sent to a client.
@@ -60,6 +61,7 @@ struct reply {
         nonauthoritative_information = 203, //!< nonauthoritative_information
         no_content = 204, //!< no_content
         reset_content = 205, //!< reset_content
+        partial_content = 206, //!< partial_content
         multiple_choices = 300, //!< multiple_choices
         moved_permanently = 301, //!< moved_permanently
         moved_temporarily = 302, //!< moved_temporarily
@@ -81,6 +83,7 @@ struct reply {
         payload_too_large = 413, //!< payload_too_large
         uri_too_long = 414, //!< uri_too_long
         unsupported_media_type = 415, //!< unsupported_media_type
+        range_not_satisfiable = 416, //!< range_not_satisfiable
         expectation_failed = 417, //!< expectation_failed
         unprocessable_entity = 422, //!< unprocessable_entity
         upgrade_required = 426, //!< upgrade_required
@@ -195,6 +198,14 @@ struct reply {
     noncopyable_function<future<>(output_stream<char>&&)> _body_writer;
     friend class routes;
     friend class connection;
+    friend class reply_tester;
+};
+
+class reply_tester {
+public:
+    static noncopyable_function<future<>(output_stream<char>&&)>& body_writer(reply& rep) {
+        return rep._body_writer;
+    }
 };
 
 } // namespace httpd
@@ -33,6 +33,8 @@
 #include <seastar/core/iostream.hh>
 #include <seastar/core/sstring.hh>
 #include <string>
+#include <chrono>
+#include <optional>
 #include <vector>
 #include <strings.h>
 #include <seastar/http/common.hh>
@@ -87,6 +89,10 @@ struct request {
     std::unordered_map<sstring, sstring> trailing_headers;
     std::unordered_map<sstring, sstring> chunk_extensions;
     sstring protocol_name = "http";
+    /// When the kernel received (the end of) the request headers, if the
+    /// server timestamps receives (see http_server::set_receive_timestamps()).
+    /// Lets handlers shed requests that already waited too long.
+    std::optional<std::chrono::system_clock::time_point> arrival_time;
 
     /**
      * Search for the first header of a given name
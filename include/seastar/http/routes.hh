@@ -25,8 +25,15 @@
 #include <seastar/http/handlers.hh>
 #include <seastar/http/common.hh>
 #include <seastar/http/reply.hh>
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/core/metrics_types.hh>
 
 #include <boost/program_options/variables_map.hpp>
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 
 namespace seastar {
@@ -67,6 +74,45 @@ class url {
 
 struct path_description;
 
+/**
+ * Statistics of the requests served by one route: histograms of latency,
+ * request size and response size, and counts of replies per status class.
+ * Accounting does not allocate; the labels are rendered once, when the
+ * route is registered. Routes that render the same method and pattern
+ * share one instance.
+ */
+class route_stats {
+    metrics::exponential_histogram<20> _latency{10}; // microseconds
+    metrics::exponential_histogram<20> _request_size{64};
+    metrics::exponential_histogram<20> _response_size{64};
+    std::array<uint64_t, 5> _replies{}; // per status class, 1xx to 5xx
+    metrics::metric_groups _metrics;
+public:
+    /**
+     * Registers the route's metrics
+     * @param service the name of the server
+     * @param method the operation the route handles
+     * @param route the url pattern of the route
+     */
+    route_stats(const sstring& service, const sstring& method, const sstring& route);
+
+    /**
+     * Accounts a served request
+     * @param latency the time it took to produce the reply
+     * @param request_size the request's content length
+     * @param rep the reply
+     */
+    void account(std::chrono::steady_clock::duration latency, size_t request_size, const reply& rep) noexcept;
+
+    /**
+     * @return the number of requests accounted so far
+     */
+    uint64_t requests() const noexcept {
+        return _latency.samples();
+    }
+};
+
+
 /**
  * routes object do the request dispatching according to the url.
  * It uses two decision mechanism exact match, if a url matches exactly
@@ -106,7 +152,7 @@ class routes {
      * @return it self
      */
     routes& add(match_rule* rule, operation_type type = GET) {
-        _rules[type][_rover++] = rule;
+        add_cookie(rule, type);
         return *this;
     }
 
@@ -170,6 +216,11 @@ class routes {
      */
     sstring normalize_url(const sstring& url);
 
+    handler_base* find_handler(operation_type type, const sstring& url,
+            parameters& params, route_stats*& stats);
+    route_stats* acquire_route_stats(const sstring& method, const sstring& route);
+    void release_route_stats(const sstring& method, const sstring& route);
+
     std::unordered_map<sstring, handler_base*> _map[NUM_OPERATION];
 public:
     using rule_cookie = uint64_t;
@@ -178,6 +229,19 @@ class routes {
     std::map<rule_cookie, match_rule*> _rules[NUM_OPERATION];
     //default Handler -- for any HTTP Method and Path (/*)
     handler_base* _default_handler = nullptr;
+
+    // Route statistics, keyed by method and route label. Routes that render
+    // the same label share an entry, which is dropped with the last of them.
+    struct route_stats_entry {
+        std::unique_ptr<route_stats> stats;
+        unsigned refs = 0;
+    };
+    std::optional<sstring> _metrics_service;
+    std::map<std::pair<sstring, sstring>, route_stats_entry> _route_stats;
+    // The entry each registered route accounts to
+    std::unordered_map<sstring, route_stats*> _map_stats[NUM_OPERATION];
+    std::map<rule_cookie, route_stats*> _rule_stats[NUM_OPERATION];
+    route_stats* _default_stats = nullptr;
 public:
     using exception_handler_fun = std::function<std::unique_ptr<reply>(std::exception_ptr eptr)>;
     using exception_handler_id = size_t;
@@ -222,11 +286,23 @@ class routes {
      * @param type the operation type
      * @return a cookie using which the rule can be removed
      */
-    rule_cookie add_cookie(match_rule* rule, operation_type type) {
-        auto pos = _rover++;
-        _rules[type][pos] = rule;
-        return pos;
-    }
+    rule_cookie add_cookie(match_rule* rule, operation_type type);
+
+    /**
+     * Export per-route metrics (see \ref route_stats), in the "httpd"
+     * group, for the routes registered so far and from now on.
+     * Has no effect if metrics are already enabled.
+     * @param service the value of the "service" label, the server's name
+     */
+    void enable_metrics(const sstring& service);
+
+    /**
+     * Search the statistics of a route
+     * @param method the method label, e.g. "GET", or "any" for the default handler
+     * @param route the route label, the exact url or the rule's pattern
+     * @return the statistics, or nullptr if there are none
+     */
+    const route_stats* get_route_stats(const sstring& method, const sstring& route) const;
 
     /**
      * Del a rule by cookie
@@ -21,7 +21,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <cstring>
 #include <seastar/core/future.hh>
@@ -73,6 +75,21 @@ struct sctp_keepalive_params {
 
 using keepalive_params = std::variant<tcp_keepalive_params, sctp_keepalive_params>;
 
+/// A sample of the state of a TCP connection, as kept by the kernel (see
+/// TCP_INFO in linux tcp(7)) or by the native stack.
+struct tcp_info_sample {
+    std::chrono::microseconds rtt{0}; ///< smoothed round-trip time
+    std::chrono::microseconds rtt_var{0}; ///< round-trip time variation
+    std::chrono::microseconds rto{0}; ///< retransmission timeout
+    uint32_t snd_cwnd = 0; ///< congestion window, in segments
+    uint32_t snd_ssthresh = 0; ///< slow start threshold, in segments
+    uint32_t snd_mss = 0; ///< sender maximum segment size, in bytes
+    uint32_t rcv_space = 0; ///< advertised receive space, in bytes
+    uint32_t unacked = 0; ///< segments sent and not yet acknowledged
+    uint32_t lost = 0; ///< segments currently considered lost
+    uint32_t total_retransmits = 0; ///< segments retransmitted over the connection's lifetime
+};
+
 /// \cond internal
 class connected_socket_impl;
 class socket_impl;
@@ -155,6 +172,10 @@ struct connected_socket_input_stream_config final {
     /// buffer sizes if it sees a tendency towards large requests, but will not go
     /// above this buffer size.
     unsigned max_buffer_size = 128 * 1024;
+    /// Asks the kernel to timestamp the data it receives, and makes the time
+    /// the data last read arrived available from
+    /// \ref input_stream::receive_timestamp(). Only supported by the posix stack.
+    bool receive_timestamps = false;
 };
 
 /// A TCP (or other stream-based protocol) connection.
@@ -210,6 +231,11 @@ class connected_socket {
     /// Linux users should refer to protocol-specific manuals
     /// to see available options, e.g. tcp(7), ip(7), etc.
     int get_sockopt(int level, int optname, void* data, size_t len) const;
+    /// Samples the TCP state of the connection (RTT, congestion window,
+    /// retransmits, ...), e.g. to tell why a connection is slow
+    ///
+    /// \return the sample, or std::nullopt if this is not a TCP connection
+    std::optional<net::tcp_info_sample> get_tcp_info() const;
 
     /// Disables output to the socket.
     ///
@@ -0,0 +1,60 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#pragma once
+
+#include <seastar/core/metrics_types.hh>
+#include <chrono>
+
+namespace seastar {
+
+namespace net {
+
+/// \addtogroup networking-module
+/// @{
+
+/// Accumulates how long received data waited between its arrival in the
+/// kernel (see \ref input_stream::receive_timestamp()) and its dispatch by
+/// the application, i.e. the queueing delay in socket buffers and in the
+/// reactor, into exponential buckets starting at 10us.
+class arrival_latency_histogram {
+    metrics::exponential_histogram<16> _histogram{10};
+public:
+    /// Accounts data that arrived at \c arrival and is dispatched now
+    void add(std::chrono::system_clock::time_point arrival) noexcept {
+        // The realtime clock may step; count such samples as no delay
+        auto delay = std::max(std::chrono::system_clock::now() - arrival, std::chrono::system_clock::duration(0));
+        _histogram.add(std::chrono::duration_cast<std::chrono::microseconds>(delay).count());
+    }
+
+    /// The accumulated delays, in microseconds
+    metrics::histogram get() const {
+        return _histogram.get();
+    }
+};
+
+/// @}
+
+}
+
+}
@@ -27,6 +27,10 @@
 #include <seastar/core/polymorphic_temporary_buffer.hh>
 #include <seastar/core/internal/buffer_allocator.hh>
 #include <boost/program_options.hpp>
+#include <sys/socket.h>
+#include <chrono>
+#include <ctime>
+#include <optional>
 
 namespace seastar {
 
@@ -108,15 +112,26 @@ class posix_data_source_impl final : public data_source_impl, private internal::
     std::pmr::polymorphic_allocator<char>* _buffer_allocator;
     pollable_fd _fd;
     connected_socket_input_stream_config _config;
+    // State of a recvmsg() that also receives the kernel timestamp
+    struct timestamped_read {
+        ::msghdr msg;
+        ::iovec iov;
+        alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(::timespec))];
+    };
+    std::unique_ptr<timestamped_read> _timestamped;
+    std::optional<std::chrono::system_clock::time_point> _receive_timestamp;
 private:
     virtual temporary_buffer<char> allocate_buffer() override;
+    future<temporary_buffer<char>> get_timestamped();
+    void adjust_buffer_size(size_t last_read) noexcept;
 public:
     explicit posix_data_source_impl(pollable_fd fd, connected_socket_input_stream_config config,
-            std::pmr::polymorphic_allocator<char>* allocator=memory::malloc_allocator)
-            : _buffer_allocator(allocator), _fd(std::move(fd)), _config(config) {
-    }
+            std::pmr::polymorphic_allocator<char>* allocator=memory::malloc_allocator);
     future<temporary_buffer<char>> get() override;
     future<> close() override;
+    std::optional<std::chrono::system_clock::time_point> receive_timestamp() const noexcept override {
+        return _receive_timestamp;
+    }
 };
 
 class posix_data_sink_impl : public data_sink_impl {
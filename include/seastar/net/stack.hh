@@ -46,6 +46,9 @@ class connected_socket_impl {
     virtual keepalive_params get_keepalive_parameters() const = 0;
     virtual void set_sockopt(int level, int optname, const void* data, size_t len) = 0;
     virtual int get_sockopt(int level, int optname, void* data, size_t len) const = 0;
+    virtual std::optional<tcp_info_sample> get_tcp_info() const {
+        return std::nullopt;
+    }
 };
 
 class socket_impl {
@@ -26,6 +26,7 @@
 #include <seastar/core/semaphore.hh>
 #include <seastar/core/byteorder.hh>
 #include <seastar/core/metrics.hh>
+#include <seastar/net/api.hh>
 #include <seastar/net/net.hh>
 #include <seastar/net/ip_checksum.hh>
 #include <seastar/net/ip.hh>
@@ -364,6 +365,7 @@ class tcp {
             unsigned fin_retransmit = 0;
             uint32_t limited_transfer = 0;
             uint32_t partial_ack = 0;
+            uint32_t total_retransmits = 0;
             tcp_seq recover;
             bool window_probe = false;
             uint8_t zero_window_probing_out = 0;
@@ -437,6 +439,7 @@ class tcp {
         void connect();
         packet read();
         void close();
+        tcp_info_sample get_tcp_info() const;
         void remove_from_tcbs() {
             auto id = connid{_local_ip, _foreign_ip, _local_port, _foreign_port};
             _tcp._tcbs.erase(id);
@@ -479,6 +482,7 @@ class tcp {
         packet get_transmit_packet();
         void retransmit_one() {
             bool data_retransmit = true;
+            _snd.total_retransmits++;
             output_one(data_retransmit);
         }
         void start_retransmit_timer() {
@@ -701,6 +705,9 @@ class tcp {
         uint16_t foreign_port() {
             return _tcb->_foreign_port;
         }
+        tcp_info_sample get_tcp_info() const {
+            return _tcb->get_tcp_info();
+        }
         void shutdown_connect();
         void close_read();
         void close_write();
@@ -2099,6 +2106,22 @@ void tcp<InetTraits>::connection::close_read() {
     _tcb->abort_reader();
 }
 
+template <typename InetTraits>
+tcp_info_sample tcp<InetTraits>::tcb::get_tcp_info() const {
+    tcp_info_sample s;
+    s.rtt = _snd.srtt;
+    s.rtt_var = _snd.rttvar;
+    s.rto = _rto;
+    auto mss = std::max<uint32_t>(_snd.mss, 1);
+    s.snd_cwnd = _snd.cwnd / mss;
+    s.snd_ssthresh = _snd.ssthresh / mss;
+    s.snd_mss = _snd.mss;
+    s.rcv_space = _rcv.window;
+    s.unacked = _snd.data.size();
+    s.total_retransmits = _snd.total_retransmits;
+    return s;
+}
+
 template <typename InetTraits>
 void tcp<InetTraits>::connection::close_write() {
     _tcb->close();
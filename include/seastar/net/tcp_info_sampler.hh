@@ -0,0 +1,126 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#pragma once
+
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/core/metrics_types.hh>
+#include <seastar/core/sstring.hh>
+#include <seastar/core/timer.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/net/api.hh>
+#include <seastar/util/noncopyable_function.hh>
+#include <boost/intrusive/list.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace seastar {
+
+namespace net {
+
+/// \addtogroup networking-module
+/// @{
+
+/// Configuration of a \ref tcp_info_sampler
+struct tcp_info_sampler_config {
+    /// How often the tracked connections are sampled
+    std::chrono::milliseconds period = std::chrono::seconds(1);
+    /// How many connections are sampled per period, at most. Sampling runs
+    /// in a timer callback, so this bounds the time it holds the reactor;
+    /// with more connections, the sampler goes round-robin over them and
+    /// each is sampled once every few periods.
+    unsigned max_connections_per_period = 256;
+};
+
+/// Periodically samples the TCP state (see \ref connected_socket::get_tcp_info())
+/// of a set of connections, such as those accepted by one listener or
+/// opened by one RPC client, and exports it as metrics in the "tcp" group,
+/// labelled with the sampler's name: histograms of the RTT, congestion
+/// window and retransmits per period of every connection, and totals.
+///
+/// A connection is tracked for as long as the \ref registration returned by
+/// track() is alive; the \c connected_socket must neither move nor be
+/// destroyed before it.
+class tcp_info_sampler {
+    using list_hook = boost::intrusive::list_base_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+    struct entry : public list_hook {
+        const connected_socket& socket;
+        std::optional<tcp_info_sample> last;
+        explicit entry(const connected_socket& s) noexcept : socket(s) {}
+    };
+    using entry_list = boost::intrusive::list<entry, boost::intrusive::constant_time_size<false>>;
+public:
+    /// Keeps a connection tracked by its \ref tcp_info_sampler
+    class registration {
+        std::unique_ptr<entry> _entry;
+        explicit registration(std::unique_ptr<entry> e) noexcept : _entry(std::move(e)) {}
+        friend class tcp_info_sampler;
+    public:
+        registration() noexcept = default;
+        /// The latest sample of the connection, or std::nullopt if it was
+        /// not sampled yet (or is not a TCP connection)
+        std::optional<tcp_info_sample> last_sample() const noexcept {
+            return _entry ? _entry->last : std::nullopt;
+        }
+    };
+private:
+    // Rotated as connections are sampled, so the front is the one that
+    // waited longest for its sample
+    entry_list _entries;
+    const unsigned _max_per_period;
+    timer<lowres_clock> _timer;
+    metrics::exponential_histogram<16> _rtt{64};
+    metrics::exponential_histogram<16> _cwnd{1};
+    // The first bucket, up to 0.5, counts periods without retransmits
+    metrics::exponential_histogram<12> _retransmits{0.5};
+    uint64_t _total_retransmits = 0;
+    uint64_t _errors = 0;
+    metrics::metric_groups _metrics;
+private:
+    void sample() noexcept;
+public:
+    /// \param name the value of the "endpoint" label of the exported metrics
+    explicit tcp_info_sampler(sstring name, tcp_info_sampler_config cfg = {});
+    tcp_info_sampler(const tcp_info_sampler&) = delete;
+    ~tcp_info_sampler();
+
+    /// Starts tracking \c socket
+    registration track(const connected_socket& socket);
+
+    /// Calls \c func with the latest sample of every tracked connection,
+    /// e.g. to dump them when debugging
+    void for_each_sample(noncopyable_function<void (const connected_socket&, const tcp_info_sample&)> func) const;
+
+    /// The number of connections tracked
+    size_t connections() const noexcept {
+        return _entries.size();
+    }
+};
+
+/// @}
+
+}
+
+}
@@ -27,6 +27,9 @@
 #include <seastar/core/future.hh>
 #include <seastar/core/seastar.hh>
 #include <seastar/net/api.hh>
+#include <seastar/net/tcp_info_sampler.hh>
+#include <seastar/net/arrival_latency.hh>
+#include <seastar/core/metrics_registration.hh>
 #include <seastar/core/iostream.hh>
 #include <seastar/core/shared_ptr.hh>
 #include <seastar/core/condition-variable.hh>
@@ -37,6 +40,7 @@
 #include <seastar/core/queue.hh>
 #include <seastar/core/weak_ptr.hh>
 #include <seastar/core/scheduling.hh>
+#include <seastar/core/request_context.hh>
 #include <seastar/util/backtrace.hh>
 #include <seastar/util/log.hh>
 
@@ -105,11 +109,17 @@ struct client_options {
     bool reuseaddr = false;
     compressor::factory* compressor_factory = nullptr;
     bool send_timeout_data = true;
+    /// Sends the request context of each call (see \ref request_context)
+    /// along with it, if the server supports it, so the handler runs under it.
+    bool send_request_context = false;
     connection_id stream_parent = invalid_connection_id;
     /// Configures how this connection is isolated from other connection on the same server.
     ///
     /// \see resource_limits::isolate_connection
     sstring isolation_cookie;
+    /// When set, the TCP state of the connection is periodically sampled
+    /// into this sampler's metrics. It must outlive the client.
+    net::tcp_info_sampler* tcp_info_sampler = nullptr;
 };
 
 /// @}
@@ -150,6 +160,16 @@ struct server_options {
     // Returning false will refuse the incoming connection. 
     // Returning true will allow the mechanism to proceed.
     std::function<bool(const socket_address&)> filter_connection = {};
+    /// Asks the kernel to timestamp the data received on accepted connections
+    /// (posix stack only), and exports the delay between the arrival of each
+    /// request and its dispatch to the handler as the
+    /// rpc_server_request_arrival_latency_us histogram, labelled with
+    /// \ref metrics_domain.
+    bool receive_timestamps = false;
+    /// Value of the "domain" label of this server's metrics; must be unique
+    /// among the servers of a shard that export metrics, constructing a
+    /// second one with the same domain throws.
+    sstring metrics_domain = "default";
 };
 
 /// @}
@@ -171,6 +191,7 @@ enum class protocol_features : uint32_t {
     CONNECTION_ID = 2,
     STREAM_PARENT = 3,
     ISOLATION = 4,
+    REQUEST_CONTEXT = 5,
 };
 
 // internal representation of feature data
@@ -264,6 +285,7 @@ class connection {
     future<> _send_loop_stopped = make_ready_future<>();
     std::unique_ptr<compressor> _compressor;
     bool _timeout_negotiated = false;
+    bool _request_context_negotiated = false;
     // stream related fields
     bool _is_stream = false;
     connection_id _id = invalid_connection_id;
@@ -301,12 +323,13 @@ class connection {
     future<> handle_stream_frame();
 
 public:
-    connection(connected_socket&& fd, const logger& l, void* s, connection_id id = invalid_connection_id) : connection(l, s, id) {
-        set_socket(std::move(fd));
+    connection(connected_socket&& fd, const logger& l, void* s, connection_id id = invalid_connection_id,
+            connected_socket_input_stream_config csisc = {}) : connection(l, s, id) {
+        set_socket(std::move(fd), csisc);
     }
     connection(const logger& l, void* s, connection_id id = invalid_connection_id) : _logger(l), _serializer(s), _id(id) {}
     virtual ~connection() {}
-    void set_socket(connected_socket&& fd);
+    void set_socket(connected_socket&& fd, connected_socket_input_stream_config csisc = {});
     future<> send_negotiation_frame(feature_map features);
     // functions below are public because they are used by external heavily templated functions
     // and I am not smart enough to know how to define them as friends
@@ -338,6 +361,10 @@ class connection {
     xshard_connection_ptr get_stream(connection_id id) const;
     void register_stream(connection_id id, xshard_connection_ptr c);
     virtual socket_address peer_address() const = 0;
+    /// Samples the TCP state of the connection, see \ref connected_socket::get_tcp_info()
+    std::optional<net::tcp_info_sample> get_tcp_info() const {
+        return _connected ? _fd.get_tcp_info() : std::nullopt;
+    }
 
     const logger& get_logger() const {
         return _logger;
@@ -431,6 +458,7 @@ class client : public rpc::connection, public weakly_referencable<client> {
     std::unordered_map<id_type, std::unique_ptr<reply_handler_base>> _outstanding;
     socket_address _server_addr, _local_addr;
     client_options _options;
+    net::tcp_info_sampler::registration _tcp_info;
     std::optional<shared_promise<>> _client_negotiated = shared_promise<>();
     weak_ptr<client> _parent; // for stream clients
 
@@ -532,7 +560,7 @@ class server {
         std::optional<isolation_config> _isolation_config;
     private:
         future<> negotiate_protocol(input_stream<char>& in);
-        future<std::tuple<std::optional<uint64_t>, uint64_t, int64_t, std::optional<rcv_buf>>>
+        future<std::tuple<std::optional<uint64_t>, uint64_t, int64_t, std::optional<rcv_buf>, request_context>>
         read_request_frame_compressed(input_stream<char>& in);
         future<feature_map> negotiate(feature_map requested);
         void send_loop() {
@@ -590,6 +618,8 @@ class server {
     gate _reply_gate;
     server_options _options;
     uint64_t _next_client_id = 1;
+    net::arrival_latency_histogram _arrival_latency;
+    metrics::metric_groups _metrics;
 
 public:
     server(protocol_base* proto, const socket_address& addr, resource_limits memory_limit = resource_limits());
@@ -598,6 +628,11 @@ class server {
     server(protocol_base* proto, server_options opts, server_socket, resource_limits memory_limit = resource_limits());
     void accept();
     future<> stop();
+    /// Delays between the arrival and the dispatch of requests, when
+    /// \ref server_options::receive_timestamps is set
+    const net::arrival_latency_histogram& arrival_latency() const {
+        return _arrival_latency;
+    }
     template<typename Func>
     void foreach_connection(Func&& f) {
         for (auto c : _conns) {
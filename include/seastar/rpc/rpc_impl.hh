@@ -464,12 +464,18 @@ auto send_helper(MsgType xt, signature<Ret (InArgs...)> xsig) {
 
             // send message
             auto msg_id = dst.next_message_id();
-            snd_buf data = marshall(dst.template serializer<Serializer>(), 28, args...);
-            static_assert(snd_buf::chunk_size >= 28, "send buffer chunk size is too small");
-            auto p = data.front().get_write() + 8; // 8 extra bytes for expiration timer
+            snd_buf data = marshall(dst.template serializer<Serializer>(), 44, args...);
+            static_assert(snd_buf::chunk_size >= 44, "send buffer chunk size is too small");
+            // 16 extra bytes for the request context, captured here since
+            // the send loop runs under its own, and 8 for expiration timer
+            auto ctx = current_request_context();
+            auto p = data.front().get_write();
+            write_le<uint64_t>(p, ctx.trace_id);
+            write_le<uint64_t>(p + 8, ctx.span_id);
+            p += 24;
             write_le<uint64_t>(p, uint64_t(t));
             write_le<int64_t>(p + 8, msg_id);
-            write_le<uint32_t>(p + 16, data.size - 28);
+            write_le<uint32_t>(p + 16, data.size - 44);
 
             // prepare reply handler, if return type is now_wait_type this does nothing, since no reply will be sent
             using wait = wait_signature_t<Ret>;
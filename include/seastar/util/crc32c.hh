@@ -0,0 +1,63 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace seastar {
+
+/// Computes the CRC32C (Castagnoli) checksum of a buffer.
+///
+/// Uses the SSE4.2 (x86-64) or CRC32 (aarch64) instructions when the CPU
+/// supports them, and a table-driven implementation otherwise.
+///
+/// \param crc checksum of the preceding data, allowing a checksum to be
+///            computed incrementally over several buffers; 0 for the first one
+/// \param data start of the buffer
+/// \param len length of the buffer in bytes
+/// \return the checksum of the data seen so far
+uint32_t crc32c(uint32_t crc, const void* data, size_t len) noexcept;
+
+/// Computes the CRC32C checksums of consecutive \c block_size blocks.
+///
+/// Equivalent to calling crc32c() on each block, but cheaper for small
+/// blocks since the implementation is selected once for all of them.
+///
+/// \param data start of the buffer; its length is \c nr_blocks * \c block_size
+/// \param block_size length of each block in bytes
+/// \param nr_blocks number of blocks
+/// \param out array of \c nr_blocks checksums to fill
+void crc32c_blocks(const void* data, size_t block_size, size_t nr_blocks, uint32_t* out) noexcept;
+
+/// \cond internal
+namespace internal {
+
+// Same as crc32c(), but always table-driven, so that it can be tested on
+// CPUs where crc32c() uses the CRC instructions
+uint32_t crc32c_portable(uint32_t crc, const void* data, size_t len) noexcept;
+
+}
+/// \endcond
+
+}
@@ -23,6 +23,9 @@
 #pragma once
 
 #include <seastar/util/std-compat.hh>
+#include <exception>
+#include <type_traits>
+#include <typeinfo>
 
 namespace seastar {
 
@@ -42,4 +45,54 @@ std::filesystem::filesystem_error make_filesystem_error(const std::string& what,
 ///
 std::filesystem::filesystem_error make_filesystem_error(const std::string& what, std::filesystem::path path1, std::filesystem::path path2, int error);
 
+/// \cond internal
+namespace internal {
+
+// The portable implementation of try_catch()
+template <typename Ex>
+Ex* try_catch_rethrow(const std::exception_ptr& eptr) noexcept {
+    try {
+        std::rethrow_exception(eptr);
+    } catch (Ex& ex) {
+        return &ex;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+}
+/// \endcond
+
+/// \brief Checks whether an exception_ptr holds an exception of a given type.
+///
+/// Equivalent to rethrowing \c eptr and catching \c Ex&, but doesn't throw,
+/// so it is cheap enough for hot error paths, e.g. telling an expected
+/// timeout from a real failure in a \c then_wrapped() continuation.
+///
+/// \tparam Ex the type to match; matches the thrown type and its public bases
+/// \param eptr the exception to inspect, may be null
+/// \return a pointer to the exception object if it matches, \c nullptr otherwise.
+///         The pointer is valid as long as some exception_ptr refers to the exception.
+template <typename Ex>
+Ex* try_catch(const std::exception_ptr& eptr) noexcept {
+    static_assert(!std::is_pointer<Ex>::value, "try_catch() does not support catching pointers");
+    if (!eptr) {
+        return nullptr;
+    }
+#if defined(__GLIBCXX__) && defined(__cpp_rtti)
+    // Relies on libstdc++ internals: its exception_ptr is a pointer to the
+    // exception object, and type_info::__do_catch() is the runtime's own catch
+    // matching, which does the (possibly virtual-base) upcast without throwing.
+    // Other standard libraries rethrow and catch instead.
+    static_assert(sizeof(std::exception_ptr) == sizeof(void*), "unexpected libstdc++ exception_ptr layout");
+    void* obj = *reinterpret_cast<void* const*>(&eptr);
+    if (typeid(Ex).__do_catch(eptr.__cxa_exception_type(), &obj, 1)) {
+        return static_cast<Ex*>(obj);
+    }
+    return nullptr;
+#else
+    return internal::try_catch_rethrow<Ex>(eptr);
+#endif
+}
+
 } // namespace seastar
@@ -23,6 +23,8 @@
 #pragma once
 
 #include <seastar/core/future.hh>
+#include <seastar/core/file.hh>
+#include <seastar/util/noncopyable_function.hh>
 #include <seastar/util/std-compat.hh>
 
 namespace seastar {
@@ -42,4 +44,48 @@ namespace seastar {
 ///
 future<> recursive_remove_directory(std::filesystem::path path) noexcept;
 
+/// A filesystem object found by \ref scan_directory_tree().
+struct scanned_entry {
+    /// Path of the entry, starting with the root passed to \ref scan_directory_tree().
+    std::filesystem::path path;
+    /// Metadata of the entry itself (symbolic links are not followed).
+    stat_data stat;
+};
+
+/// Configuration for \ref scan_directory_tree().
+struct directory_scan_options {
+    /// Maximum number of directories being listed and stat()ed at the same time.
+    /// Together with the size of the largest directory, this bounds the memory
+    /// used by the scan.
+    unsigned concurrency = 16;
+    /// Number of entries stat()ed in a single round-trip to the syscall thread.
+    size_t stat_batch_size = 128;
+    /// Spread directories across all shards. When false, only the calling
+    /// shard's syscall thread is used.
+    bool use_all_shards = true;
+};
+
+/// Recursively walks a directory tree, reporting each entry with its metadata.
+///
+/// Directories are listed on all shards (see \ref directory_scan_options::use_all_shards),
+/// and the entries of each directory are stat()ed in batches using statx(), so
+/// a large tree is not bottlenecked on a single shard's syscall thread.
+///
+/// \param root path of the directory to scan; it is not reported itself
+/// \param consumer called on the calling shard for every entry found below \c root.
+///        Calls are serialized: the next entry is not reported until the future
+///        returned for the previous one resolves.
+/// \param opts scan configuration
+///
+/// \note
+/// Entries are reported in no particular order, except that a directory is
+/// always reported before its contents.  Symbolic links are reported but not
+/// followed.  Entries removed while the scan is running are silently skipped.
+///
+/// The function bails out on the first error, either from the filesystem or
+/// from the consumer.
+future<> scan_directory_tree(std::filesystem::path root,
+        noncopyable_function<future<> (scanned_entry)> consumer,
+        directory_scan_options opts = {}) noexcept;
+
 } // namespace seastar
@@ -35,6 +35,21 @@ using cpuset = std::set<unsigned>;
 optional<cpuset> cpu_set();
 size_t memory_limit();
 
+// CPU bandwidth available to us, in CPUs (quota / period), if limited
+// by cpu.max (v2) or cpu.cfs_quota_us (v1). On v2, the tightest limit
+// along the path from our cgroup to the root. Reads the cgroup files on
+// every call.
+optional<double> cpu_quota();
+
+// Throttling counters from cpu.stat.
+struct cpu_throttling_stats {
+    uint64_t nr_periods = 0;
+    uint64_t nr_throttled = 0;
+    uint64_t throttled_usec = 0;
+};
+
+optional<cpu_throttling_stats> cpu_throttling();
+
 template <typename T>
 optional<T> read_setting_as(std::string path);
 
@@ -0,0 +1,343 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/core/checksummed_file.hh>
+#include <seastar/core/layered_file.hh>
+#include <seastar/core/align.hh>
+#include <seastar/core/byteorder.hh>
+#include <seastar/core/semaphore.hh>
+#include <seastar/core/when_all.hh>
+#include <seastar/util/crc32c.hh>
+#include <seastar/core/print.hh>
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+namespace seastar {
+
+checksum_mismatch_error::checksum_mismatch_error(uint64_t offset)
+    : std::runtime_error(format("checksum mismatch in block at offset {}", offset))
+    , _offset(offset)
+{}
+
+namespace {
+
+class checksummed_file_impl final : public layered_file_impl {
+    static constexpr size_t checksum_size = sizeof(uint32_t);
+
+    file _checksums;
+    const uint64_t _block_size;
+    // Checksum updates are read-modify-write of the sidecar's blocks, and
+    // neighbouring data blocks share a sidecar block, so serialize them.
+    semaphore _update_sem = { 1 };
+
+    bool block_aligned(uint64_t pos, uint64_t len) const noexcept {
+        return (pos | len) % _block_size == 0;
+    }
+
+    static future<size_t> misaligned() {
+        return make_exception_future<size_t>(std::system_error(EINVAL, std::system_category()));
+    }
+
+    // Missing entries (beyond the end of the sidecar) read as zero
+    future<std::vector<uint32_t>> read_checksums(uint64_t first_block, size_t count, const io_priority_class& pc, io_intent* intent) {
+        return _checksums.dma_read_bulk<char>(first_block * checksum_size, count * checksum_size, pc, intent).then([count] (temporary_buffer<char> buf) {
+            std::vector<uint32_t> ret(count, 0);
+            auto avail = std::min(count, buf.size() / checksum_size);
+            for (size_t i = 0; i < avail; i++) {
+                ret[i] = read_le<uint32_t>(buf.get() + i * checksum_size);
+            }
+            return ret;
+        });
+    }
+
+    future<> write_checksums(uint64_t first_block, std::vector<uint32_t> crcs, const io_priority_class& pc) {
+        if (crcs.empty()) {
+            return make_ready_future<>();
+        }
+        return with_semaphore(_update_sem, 1, [this, first_block, crcs = std::move(crcs), pc] () mutable {
+            uint64_t align = _checksums.disk_write_dma_alignment();
+            uint64_t start = first_block * checksum_size;
+            uint64_t end = start + crcs.size() * checksum_size;
+            uint64_t astart = align_down(start, align);
+            uint64_t aend = align_up(end, align);
+            auto buf = temporary_buffer<char>::aligned(_checksums.memory_dma_alignment(), aend - astart);
+            std::fill_n(buf.get_write(), buf.size(), 0);
+
+            // Fetch the entries sharing the first and last sidecar blocks
+            // with the updated ones. A short read leaves zeroes, which is
+            // what the sidecar holds past its end anyway.
+            auto read_edge = [this, &buf, astart, align, pc] (uint64_t at) {
+                return _checksums.dma_read(at, buf.get_write() + (at - astart), align, pc).discard_result();
+            };
+            auto head = start != astart ? read_edge(astart) : make_ready_future<>();
+            auto tail = end != aend && (aend - align != astart || start == astart) ? read_edge(aend - align) : make_ready_future<>();
+            return when_all_succeed(std::move(head), std::move(tail)).discard_result().then(
+                    [this, buf = std::move(buf), crcs = std::move(crcs), start, astart, pc] () mutable {
+                for (size_t i = 0; i < crcs.size(); i++) {
+                    write_le<uint32_t>(buf.get_write() + (start - astart) + i * checksum_size, crcs[i]);
+                }
+                auto len = buf.size();
+                return _checksums.dma_write(astart, buf.get(), len, pc).then([buf = std::move(buf)] (size_t written) {
+                    if (written != buf.size()) {
+                        throw std::system_error(EIO, std::system_category(), "short write to checksum file");
+                    }
+                });
+            });
+        });
+    }
+
+    // The checksum of the last block of a file that ends inside it covers
+    // the block padded with zeroes, which is what the file holds past its
+    // end should it be extended again.
+    uint32_t padded_block_checksum(const uint8_t* data, size_t len) const {
+        std::vector<uint8_t> block(_block_size, 0);
+        std::copy_n(data, std::min<size_t>(len, _block_size), block.data());
+        uint32_t crc;
+        crc32c_blocks(block.data(), _block_size, 1, &crc);
+        return crc;
+    }
+
+    // Checks the blocks of data read from \c pos against their recorded
+    // checksums; throws checksum_mismatch_error on the first bad block.
+    void verify(uint64_t pos, const uint8_t* data, size_t len, const std::vector<uint32_t>& expected) const {
+        auto nr_full = len / _block_size;
+        auto nr_blocks = std::min<size_t>(nr_full + (len % _block_size != 0), expected.size());
+        std::vector<uint32_t> actual(std::min(nr_full, nr_blocks));
+        crc32c_blocks(data, _block_size, actual.size(), actual.data());
+        if (nr_blocks > nr_full) {
+            actual.push_back(padded_block_checksum(data + nr_full * _block_size, len % _block_size));
+        }
+        for (size_t i = 0; i < nr_blocks; i++) {
+            if (actual[i] == expected[i]) {
+                continue;
+            }
+            auto block = data + i * _block_size;
+            auto block_end = data + std::min<size_t>(len, (i + 1) * _block_size);
+            bool hole = expected[i] == 0 && std::all_of(block, block_end, [] (uint8_t b) { return b == 0; });
+            if (!hole) {
+                throw checksum_mismatch_error(pos + i * _block_size);
+            }
+        }
+    }
+
+    future<temporary_buffer<uint8_t>> read_verified(uint64_t offset, size_t range_size, const io_priority_class& pc, io_intent* intent) {
+        uint64_t astart = align_down(offset, _block_size);
+        uint64_t aend = align_up(offset + range_size, _block_size);
+        return when_all_succeed(
+                _underlying_file.dma_read_bulk<uint8_t>(astart, aend - astart, pc, intent),
+                read_checksums(astart / _block_size, (aend - astart) / _block_size, pc, intent)
+        ).then_unpack([this, offset, range_size, astart] (temporary_buffer<uint8_t> buf, std::vector<uint32_t> crcs) {
+            verify(astart, buf.get(), buf.size(), crcs);
+            buf.trim_front(std::min<size_t>(offset - astart, buf.size()));
+            buf.trim(std::min(range_size, buf.size()));
+            return buf;
+        });
+    }
+
+public:
+    checksummed_file_impl(file data, file checksums, uint64_t block_size)
+        : layered_file_impl(std::move(data))
+        , _checksums(std::move(checksums))
+        , _block_size(block_size)
+    {
+        _disk_write_dma_alignment = _block_size;
+        _disk_overwrite_dma_alignment = _block_size;
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, const io_priority_class& pc) override {
+        return write_dma(pos, buffer, len, pc, nullptr);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) override {
+        if (!block_aligned(pos, len)) {
+            return misaligned();
+        }
+        std::vector<uint32_t> crcs(len / _block_size);
+        crc32c_blocks(buffer, _block_size, crcs.size(), crcs.data());
+        return _underlying_file.dma_write(pos, static_cast<const uint8_t*>(buffer), len, pc, intent).then(
+                [this, pos, crcs = std::move(crcs), pc] (size_t written) mutable {
+            return record_written(pos, written, std::move(crcs), pc);
+        });
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc) override {
+        return write_dma(pos, std::move(iov), pc, nullptr);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) override {
+        std::vector<uint32_t> crcs;
+        uint32_t crc = 0;
+        size_t in_block = 0;
+        for (auto& v : iov) {
+            auto p = static_cast<const uint8_t*>(v.iov_base);
+            auto left = v.iov_len;
+            while (left) {
+                auto chunk = std::min<size_t>(left, _block_size - in_block);
+                crc = crc32c(crc, p, chunk);
+                p += chunk;
+                left -= chunk;
+                in_block += chunk;
+                if (in_block == _block_size) {
+                    crcs.push_back(crc);
+                    crc = 0;
+                    in_block = 0;
+                }
+            }
+        }
+        if (in_block || !block_aligned(pos, 0)) {
+            return misaligned();
+        }
+        return _underlying_file.dma_write(pos, std::move(iov), pc, intent).then(
+                [this, pos, crcs = std::move(crcs), pc] (size_t written) mutable {
+            return record_written(pos, written, std::move(crcs), pc);
+        });
+    }
+
+    // A partially written block keeps its old checksum, so report only the
+    // complete blocks as written; the caller will rewrite the rest.
+    future<size_t> record_written(uint64_t pos, size_t written, std::vector<uint32_t> crcs, const io_priority_class& pc) {
+        auto blocks = written / _block_size;
+        crcs.resize(blocks);
+        return write_checksums(pos / _block_size, std::move(crcs), pc).then([this, blocks] {
+            return size_t(blocks * _block_size);
+        });
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc) override {
+        return read_dma(pos, buffer, len, pc, nullptr);
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) override {
+        if (!block_aligned(pos, len)) {
+            return read_verified(pos, len, pc, intent).then([buffer] (temporary_buffer<uint8_t> buf) {
+                std::copy_n(buf.get(), buf.size(), static_cast<uint8_t*>(buffer));
+                return buf.size();
+            });
+        }
+        return when_all_succeed(
+                _underlying_file.dma_read(pos, static_cast<uint8_t*>(buffer), len, pc, intent),
+                read_checksums(pos / _block_size, len / _block_size, pc, intent)
+        ).then_unpack([this, pos, buffer] (size_t read, std::vector<uint32_t> crcs) {
+            verify(pos, static_cast<const uint8_t*>(buffer), read, crcs);
+            return read;
+        });
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc) override {
+        return read_dma(pos, std::move(iov), pc, nullptr);
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) override {
+        size_t len = 0;
+        for (auto& v : iov) {
+            len += v.iov_len;
+        }
+        return read_verified(pos, len, pc, intent).then([iov = std::move(iov)] (temporary_buffer<uint8_t> buf) {
+            size_t copied = 0;
+            for (auto& v : iov) {
+                auto n = std::min(v.iov_len, buf.size() - copied);
+                std::copy_n(buf.get() + copied, n, static_cast<uint8_t*>(v.iov_base));
+                copied += n;
+            }
+            return copied;
+        });
+    }
+
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc) override {
+        return dma_read_bulk(offset, range_size, pc, nullptr);
+    }
+
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc, io_intent* intent) override {
+        return read_verified(offset, range_size, pc, intent);
+    }
+
+    virtual future<> flush() override {
+        return when_all_succeed(_underlying_file.flush(), _checksums.flush()).discard_result();
+    }
+
+    virtual future<struct stat> stat() override {
+        return _underlying_file.stat();
+    }
+
+    virtual future<> truncate(uint64_t length) override {
+        auto truncate_checksums = [this, length] {
+            return with_semaphore(_update_sem, 1, [this, length] {
+                return _checksums.truncate(align_up(length, _block_size) / _block_size * checksum_size);
+            });
+        };
+        if (block_aligned(length, 0)) {
+            return _underlying_file.truncate(length).then(std::move(truncate_checksums));
+        }
+        // The new last block keeps only its head; re-checksum it as padded
+        // with zeroes (see padded_block_checksum())
+        auto last = align_down(length, _block_size);
+        return read_verified(last, _block_size, default_priority_class(), nullptr).then(
+                [this, length, last, truncate_checksums = std::move(truncate_checksums)] (temporary_buffer<uint8_t> buf) mutable {
+            auto crc = padded_block_checksum(buf.get(), std::min<size_t>(buf.size(), length - last));
+            return _underlying_file.truncate(length).then([this, last, crc] {
+                return write_checksums(last / _block_size, std::vector<uint32_t>{crc}, default_priority_class());
+            }).then(std::move(truncate_checksums));
+        });
+    }
+
+    virtual future<> discard(uint64_t offset, uint64_t length) override {
+        if (!block_aligned(offset, length)) {
+            return make_exception_future<>(std::system_error(EINVAL, std::system_category()));
+        }
+        // Discarded blocks read back as zeroes; clear their checksums so
+        // that they verify as holes.
+        return _underlying_file.discard(offset, length).then([this, offset, length] {
+            return write_checksums(offset / _block_size, std::vector<uint32_t>(length / _block_size, 0), default_priority_class());
+        });
+    }
+
+    virtual future<> allocate(uint64_t position, uint64_t length) override {
+        return _underlying_file.allocate(position, length);
+    }
+
+    virtual future<uint64_t> size() override {
+        return _underlying_file.size();
+    }
+
+    virtual future<> close() override {
+        return _underlying_file.close().finally([this] {
+            return _checksums.close();
+        });
+    }
+
+    virtual subscription<directory_entry> list_directory(std::function<future<> (directory_entry de)> next) override {
+        return _underlying_file.list_directory(std::move(next));
+    }
+};
+
+}
+
+file make_checksummed_file(file data, file checksums, checksummed_file_options options) {
+    auto bs = options.block_size;
+    if (bs == 0 || (bs & (bs - 1)) || bs % data.disk_write_dma_alignment()) {
+        throw std::invalid_argument(format("invalid checksummed file block size {}", bs));
+    }
+    return file(make_shared<checksummed_file_impl>(std::move(data), std::move(checksums), bs));
+}
+
+}
@@ -0,0 +1,315 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/core/compressed_fstream.hh>
+#include <seastar/core/byteorder.hh>
+#include <seastar/core/circular_buffer.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/print.hh>
+#include <seastar/net/packet.hh>
+#include <lz4.h>
+#include <cstring>
+
+namespace seastar {
+
+namespace {
+
+// Trailer layout, all integers little-endian:
+//
+//   0: magic
+//   4: algorithm
+//   8: uncompressed chunk size
+//  12: reserved, zero
+//  16: total uncompressed size
+//  24: offset of the index, an array of the chunks' 64-bit offsets
+//
+// A chunk whose stored size is its uncompressed size is stored as is.
+constexpr char trailer_magic[4] = { 'S', 'C', 'Z', '1' };
+constexpr size_t trailer_size = 32;
+
+enum class chunk_compression : uint8_t {
+    lz4 = 1,
+};
+
+[[noreturn]] void malformed(const char* what) {
+    throw std::runtime_error(format("malformed compressed file: {}", what));
+}
+
+class compressed_file_data_sink_impl final : public data_sink_impl {
+    output_stream<char> _out;
+    const size_t _chunk_size;
+    temporary_buffer<char> _chunk;
+    size_t _chunk_fill = 0;
+    temporary_buffer<char> _compressed;
+    uint64_t _out_pos = 0;
+    uint64_t _size = 0;
+    std::vector<uint64_t> _index;
+
+    // The output stream copies what it is given before returning, so
+    // both buffers can be reused as soon as write() returns.
+    future<> write_chunk() {
+        auto len = _chunk_fill;
+        auto clen = LZ4_compress_default(_chunk.get(), _compressed.get_write(), len, _compressed.size());
+        bool stored = clen <= 0 || size_t(clen) >= len;
+        auto data = stored ? _chunk.get() : _compressed.get();
+        size_t dlen = stored ? len : size_t(clen);
+        _index.push_back(_out_pos);
+        _out_pos += dlen;
+        _size += len;
+        _chunk_fill = 0;
+        return _out.write(data, dlen);
+    }
+
+    future<> append(const char* p, size_t n) {
+        while (n) {
+            auto now = std::min(n, _chunk_size - _chunk_fill);
+            std::copy_n(p, now, _chunk.get_write() + _chunk_fill);
+            _chunk_fill += now;
+            p += now;
+            n -= now;
+            if (_chunk_fill == _chunk_size) {
+                return write_chunk().then([this, p, n] {
+                    return append(p, n);
+                });
+            }
+        }
+        return make_ready_future<>();
+    }
+
+    temporary_buffer<char> make_index_and_trailer() const {
+        temporary_buffer<char> buf(_index.size() * sizeof(uint64_t) + trailer_size);
+        auto p = buf.get_write();
+        for (auto off : _index) {
+            write_le<uint64_t>(p, off);
+            p += sizeof(uint64_t);
+        }
+        std::copy_n(trailer_magic, sizeof(trailer_magic), p);
+        write_le<uint32_t>(p + 4, uint32_t(chunk_compression::lz4));
+        write_le<uint32_t>(p + 8, _chunk_size);
+        write_le<uint32_t>(p + 12, 0);
+        write_le<uint64_t>(p + 16, _size);
+        write_le<uint64_t>(p + 24, _out_pos);
+        return buf;
+    }
+
+public:
+    compressed_file_data_sink_impl(output_stream<char> out, size_t chunk_size)
+        : _out(std::move(out))
+        , _chunk_size(chunk_size)
+        , _chunk(chunk_size)
+        , _compressed(LZ4_compressBound(chunk_size))
+    {}
+
+    virtual future<> put(net::packet data) override {
+        return do_with(std::move(data), [this] (net::packet& p) {
+            auto frags = p.fragments();
+            return do_for_each(frags.begin(), frags.end(), [this] (net::fragment f) {
+                return append(f.base, f.size);
+            });
+        });
+    }
+
+    using data_sink_impl::put;
+
+    virtual future<> put(temporary_buffer<char> buf) override {
+        auto p = buf.get();
+        auto n = buf.size();
+        return append(p, n).finally([buf = std::move(buf)] {});
+    }
+
+    // A partial chunk can only be the last one, so it stays buffered
+    virtual future<> flush() override {
+        return _out.flush();
+    }
+
+    virtual future<> close() override {
+        auto f = _chunk_fill ? write_chunk() : make_ready_future<>();
+        return f.then([this] {
+            auto buf = make_index_and_trailer();
+            return _out.write(buf.get(), buf.size());
+        }).finally([this] {
+            return _out.close();
+        });
+    }
+
+    virtual size_t buffer_size() const noexcept override {
+        return _chunk_size;
+    }
+};
+
+class compressed_file_data_source_impl final : public data_source_impl {
+    struct layout {
+        uint64_t chunk_size;
+        uint64_t size;
+        uint64_t index_offset;
+        std::vector<uint64_t> index;
+    };
+
+    file _file;
+    compressed_file_input_stream_options _options;
+    uint64_t _pos;
+    std::optional<layout> _layout;
+    uint64_t _next_chunk = 0;
+    circular_buffer<future<temporary_buffer<char>>> _read_ahead;
+    future<> _dropped_reads = make_ready_future<>();
+
+    future<> load_layout() {
+        return _file.size().then([this] (uint64_t file_size) {
+            if (file_size < trailer_size) {
+                malformed("too short");
+            }
+            return _file.dma_read_exactly<char>(file_size - trailer_size, trailer_size, _options.io_priority_class).then(
+                    [this, file_size] (temporary_buffer<char> t) {
+                auto p = t.get();
+                if (!std::equal(trailer_magic, trailer_magic + sizeof(trailer_magic), p)) {
+                    malformed("bad magic");
+                }
+                if (read_le<uint32_t>(p + 4) != uint32_t(chunk_compression::lz4)) {
+                    malformed("unknown compression algorithm");
+                }
+                layout l;
+                l.chunk_size = read_le<uint32_t>(p + 8);
+                l.size = read_le<uint64_t>(p + 16);
+                l.index_offset = read_le<uint64_t>(p + 24);
+                if (!l.chunk_size) {
+                    malformed("zero chunk size");
+                }
+                auto nr_chunks = (l.size + l.chunk_size - 1) / l.chunk_size;
+                auto index_size = nr_chunks * sizeof(uint64_t);
+                if (l.index_offset + index_size + trailer_size != file_size) {
+                    malformed("bad index offset");
+                }
+                return _file.dma_read_exactly<char>(l.index_offset, index_size, _options.io_priority_class).then(
+                        [this, l = std::move(l), nr_chunks] (temporary_buffer<char> idx) mutable {
+                    l.index.reserve(nr_chunks);
+                    for (size_t i = 0; i < nr_chunks; i++) {
+                        l.index.push_back(read_le<uint64_t>(idx.get() + i * sizeof(uint64_t)));
+                    }
+                    if (!std::is_sorted(l.index.begin(), l.index.end()) || (nr_chunks && l.index.back() > l.index_offset)) {
+                        malformed("bad index");
+                    }
+                    _pos = std::min(_pos, l.size);
+                    _next_chunk = _pos / l.chunk_size;
+                    _layout = std::move(l);
+                });
+            });
+        });
+    }
+
+    // Does not capture this, so it can be left to complete in the background
+    future<temporary_buffer<char>> read_chunk(uint64_t i) {
+        auto& l = *_layout;
+        auto start = l.index[i];
+        auto end = i + 1 < l.index.size() ? l.index[i + 1] : l.index_offset;
+        size_t len = std::min(l.chunk_size, l.size - i * l.chunk_size);
+        return _file.dma_read_exactly<char>(start, end - start, _options.io_priority_class).then([len] (temporary_buffer<char> cbuf) {
+            if (cbuf.size() == len) {
+                return cbuf;
+            }
+            temporary_buffer<char> buf(len);
+            if (LZ4_decompress_safe(cbuf.get(), buf.get_write(), cbuf.size(), len) != int(len)) {
+                malformed("corrupt chunk");
+            }
+            return buf;
+        });
+    }
+
+    void drop_read_ahead() {
+        while (!_read_ahead.empty()) {
+            _dropped_reads = _dropped_reads.then([f = std::move(_read_ahead.front())] () mutable {
+                return f.then_wrapped([] (future<temporary_buffer<char>> f) {
+                    f.ignore_ready_future();
+                });
+            });
+            _read_ahead.pop_front();
+        }
+    }
+
+public:
+    compressed_file_data_source_impl(file f, uint64_t offset, compressed_file_input_stream_options options)
+        : _file(std::move(f))
+        , _options(options)
+        , _pos(offset)
+    {}
+
+    virtual future<temporary_buffer<char>> get() override {
+        if (!_layout) {
+            return load_layout().then([this] {
+                return get();
+            });
+        }
+        auto& l = *_layout;
+        if (_pos >= l.size) {
+            return make_ready_future<temporary_buffer<char>>();
+        }
+        while (_read_ahead.size() <= _options.read_ahead && _next_chunk < l.index.size()) {
+            _read_ahead.push_back(read_chunk(_next_chunk++));
+        }
+        auto f = std::move(_read_ahead.front());
+        _read_ahead.pop_front();
+        return f.then([this] (temporary_buffer<char> buf) {
+            buf.trim_front(_pos % _layout->chunk_size);
+            _pos += buf.size();
+            return buf;
+        });
+    }
+
+    virtual future<temporary_buffer<char>> skip(uint64_t n) override {
+        if (!_layout) {
+            _pos += n;
+            return get();
+        }
+        auto& l = *_layout;
+        auto pos = std::min(_pos + n, l.size);
+        if (pos / l.chunk_size != _pos / l.chunk_size) {
+            drop_read_ahead();
+            _next_chunk = pos / l.chunk_size;
+        }
+        _pos = pos;
+        return get();
+    }
+
+    virtual future<> close() override {
+        drop_read_ahead();
+        return std::move(_dropped_reads);
+    }
+};
+
+}
+
+future<output_stream<char>> make_compressed_file_output_stream(file f, compressed_file_output_stream_options options) noexcept {
+    auto chunk_size = options.chunk_size;
+    if (!chunk_size || chunk_size > LZ4_MAX_INPUT_SIZE) {
+        return f.close().then([chunk_size] () -> output_stream<char> {
+            throw std::invalid_argument(format("invalid compressed file chunk size {}", chunk_size));
+        });
+    }
+    return make_file_output_stream(std::move(f), options.file_options).then([chunk_size] (output_stream<char> out) {
+        return output_stream<char>(data_sink(std::make_unique<compressed_file_data_sink_impl>(std::move(out), chunk_size)), chunk_size);
+    });
+}
+
+input_stream<char> make_compressed_file_input_stream(file f, uint64_t offset, compressed_file_input_stream_options options) {
+    return input_stream<char>(data_source(std::make_unique<compressed_file_data_source_impl>(std::move(f), offset, options)));
+}
+
+}
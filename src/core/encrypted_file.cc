@@ -0,0 +1,284 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/core/encrypted_file.hh>
+#include <seastar/core/layered_file.hh>
+#include <seastar/core/align.hh>
+#include <seastar/core/print.hh>
+#include <seastar/util/defer.hh>
+#include <gnutls/gnutls.h>
+#include <gnutls/crypto.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <system_error>
+
+namespace seastar {
+
+#if GNUTLS_VERSION_NUMBER >= 0x030608
+
+namespace {
+
+class encrypted_file_impl final : public layered_file_impl {
+    gnutls_cipher_hd_t _cipher;
+    const uint64_t _block_size;
+
+    bool block_aligned(uint64_t pos, uint64_t len) const noexcept {
+        return (pos | len) % _block_size == 0;
+    }
+
+    template <typename T = size_t>
+    static future<T> misaligned() {
+        return make_exception_future<T>(std::system_error(EINVAL, std::system_category()));
+    }
+
+    // Encrypts or decrypts the whole blocks of [in, in + len), which hold
+    // the data at file offset \c pos, into out. in and out may be the same.
+    // An all-zero block is a hole or a discarded range, never ciphertext
+    // (the odds of a block encrypting to zeroes are nil), and decrypts to
+    // zeroes, as it reads from a plain file.
+    void crypt(uint64_t pos, const uint8_t* in, uint8_t* out, size_t len, bool encrypt) {
+        auto block = pos / _block_size;
+        for (size_t off = 0; off + _block_size <= len; off += _block_size, block++) {
+            if (!encrypt && std::all_of(in + off, in + off + _block_size, [] (uint8_t b) { return b == 0; })) {
+                std::fill_n(out + off, _block_size, 0);
+                continue;
+            }
+            // IEEE P1619: the tweak is the little-endian data unit number
+            std::array<uint8_t, 16> tweak = {};
+            for (unsigned i = 0; i < sizeof(block); i++) {
+                tweak[i] = block >> (8 * i);
+            }
+            gnutls_cipher_set_iv(_cipher, tweak.data(), tweak.size());
+            auto r = encrypt
+                    ? gnutls_cipher_encrypt2(_cipher, in + off, _block_size, out + off, _block_size)
+                    : gnutls_cipher_decrypt2(_cipher, in + off, _block_size, out + off, _block_size);
+            if (r < 0) {
+                throw std::runtime_error(format("AES-XTS {} failed: {}", encrypt ? "encryption" : "decryption", gnutls_strerror(r)));
+            }
+        }
+    }
+
+    future<size_t> write_encrypted(uint64_t pos, temporary_buffer<uint8_t> buf, const io_priority_class& pc, io_intent* intent) {
+        auto p = buf.get();
+        auto len = buf.size();
+        return _underlying_file.dma_write(pos, p, len, pc, intent).then([this, buf = std::move(buf)] (size_t written) {
+            // A partially written block is garbage; have the caller rewrite it
+            return align_down<size_t>(written, _block_size);
+        });
+    }
+
+    future<temporary_buffer<uint8_t>> read_decrypted(uint64_t offset, size_t range_size, const io_priority_class& pc, io_intent* intent) {
+        uint64_t astart = align_down(offset, _block_size);
+        uint64_t aend = align_up(offset + range_size, _block_size);
+        return _underlying_file.dma_read_bulk<uint8_t>(astart, aend - astart, pc, intent).then(
+                [this, offset, range_size, astart] (temporary_buffer<uint8_t> buf) {
+            buf.trim(align_down<size_t>(buf.size(), _block_size));
+            crypt(astart, buf.get(), buf.get_write(), buf.size(), false);
+            buf.trim_front(std::min<size_t>(offset - astart, buf.size()));
+            buf.trim(std::min(range_size, buf.size()));
+            return buf;
+        });
+    }
+
+public:
+    encrypted_file_impl(file f, gnutls_cipher_hd_t cipher, uint64_t block_size)
+        : layered_file_impl(std::move(f))
+        , _cipher(cipher)
+        , _block_size(block_size)
+    {
+        _disk_read_dma_alignment = _block_size;
+        _disk_write_dma_alignment = _block_size;
+        _disk_overwrite_dma_alignment = _block_size;
+    }
+
+    ~encrypted_file_impl() {
+        // Also wipes the expanded key held by the cipher
+        gnutls_cipher_deinit(_cipher);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, const io_priority_class& pc) override {
+        return write_dma(pos, buffer, len, pc, nullptr);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) override {
+        if (!block_aligned(pos, len)) {
+            return misaligned();
+        }
+        // Encrypting into the bounce buffer is the only pass over the data
+        auto buf = temporary_buffer<uint8_t>::aligned(_memory_dma_alignment, len);
+        crypt(pos, static_cast<const uint8_t*>(buffer), buf.get_write(), len, true);
+        return write_encrypted(pos, std::move(buf), pc, intent);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc) override {
+        return write_dma(pos, std::move(iov), pc, nullptr);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) override {
+        size_t len = 0;
+        for (auto& v : iov) {
+            len += v.iov_len;
+        }
+        if (!block_aligned(pos, len)) {
+            return misaligned();
+        }
+        // Blocks may straddle iovec boundaries, so gather them first
+        auto buf = temporary_buffer<uint8_t>::aligned(_memory_dma_alignment, len);
+        auto p = buf.get_write();
+        for (auto& v : iov) {
+            p = std::copy_n(static_cast<const uint8_t*>(v.iov_base), v.iov_len, p);
+        }
+        crypt(pos, buf.get(), buf.get_write(), len, true);
+        return write_encrypted(pos, std::move(buf), pc, intent);
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc) override {
+        return read_dma(pos, buffer, len, pc, nullptr);
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) override {
+        if (!block_aligned(pos, len)) {
+            return misaligned();
+        }
+        auto p = static_cast<uint8_t*>(buffer);
+        return _underlying_file.dma_read(pos, p, len, pc, intent).then([this, pos, p] (size_t read) {
+            read = align_down<size_t>(read, _block_size);
+            crypt(pos, p, p, read, false);
+            return read;
+        });
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc) override {
+        return read_dma(pos, std::move(iov), pc, nullptr);
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) override {
+        size_t len = 0;
+        for (auto& v : iov) {
+            len += v.iov_len;
+        }
+        if (!block_aligned(pos, len)) {
+            return misaligned();
+        }
+        return read_decrypted(pos, len, pc, intent).then([iov = std::move(iov)] (temporary_buffer<uint8_t> buf) {
+            size_t copied = 0;
+            for (auto& v : iov) {
+                auto n = std::min(v.iov_len, buf.size() - copied);
+                std::copy_n(buf.get() + copied, n, static_cast<uint8_t*>(v.iov_base));
+                copied += n;
+            }
+            return copied;
+        });
+    }
+
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc) override {
+        return dma_read_bulk(offset, range_size, pc, nullptr);
+    }
+
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc, io_intent* intent) override {
+        return read_decrypted(offset, range_size, pc, intent);
+    }
+
+    virtual future<> flush() override {
+        return _underlying_file.flush();
+    }
+
+    virtual future<struct stat> stat() override {
+        return _underlying_file.stat();
+    }
+
+    virtual future<> truncate(uint64_t length) override {
+        if (!block_aligned(length, 0)) {
+            return misaligned<void>();
+        }
+        return _underlying_file.truncate(length);
+    }
+
+    virtual future<> discard(uint64_t offset, uint64_t length) override {
+        return _underlying_file.discard(offset, length);
+    }
+
+    virtual future<> allocate(uint64_t position, uint64_t length) override {
+        return _underlying_file.allocate(position, length);
+    }
+
+    virtual future<uint64_t> size() override {
+        return _underlying_file.size();
+    }
+
+    virtual future<> close() override {
+        return _underlying_file.close();
+    }
+
+    virtual subscription<directory_entry> list_directory(std::function<future<> (directory_entry de)> next) override {
+        return _underlying_file.list_directory(std::move(next));
+    }
+};
+
+}
+
+file make_encrypted_file(file underlying, std::vector<uint8_t> key, encrypted_file_options options) {
+    auto bs = options.block_size;
+    if (bs == 0 || (bs & (bs - 1)) || bs % underlying.disk_write_dma_alignment()) {
+        throw std::invalid_argument(format("invalid encrypted file block size {}", bs));
+    }
+    // Our copy of the key must not outlive the call
+    auto wipe_key = defer([&key] () noexcept {
+        gnutls_memset(key.data(), 0, key.size());
+    });
+    gnutls_cipher_algorithm_t algo;
+    switch (key.size()) {
+    case 32: algo = GNUTLS_CIPHER_AES_128_XTS; break;
+    case 64: algo = GNUTLS_CIPHER_AES_256_XTS; break;
+    default:
+        throw std::invalid_argument(format("invalid AES-XTS key size {}", key.size()));
+    }
+    // With equal halves, the tweak key is the data key, and XTS is no
+    // longer secure (IEEE P1619-2018, Section 5.1)
+    auto half = key.size() / 2;
+    if (std::equal(key.begin(), key.begin() + half, key.begin() + half)) {
+        throw std::invalid_argument("AES-XTS key halves must differ");
+    }
+    gnutls_datum_t k{key.data(), unsigned(key.size())};
+    gnutls_cipher_hd_t cipher;
+    auto r = gnutls_cipher_init(&cipher, algo, &k, nullptr);
+    if (r < 0) {
+        throw std::invalid_argument(format("cannot initialize AES-XTS cipher: {}", gnutls_strerror(r)));
+    }
+    try {
+        return file(make_shared<encrypted_file_impl>(std::move(underlying), cipher, bs));
+    } catch (...) {
+        gnutls_cipher_deinit(cipher);
+        throw;
+    }
+}
+
+#else
+
+file make_encrypted_file(file underlying, std::vector<uint8_t> key, encrypted_file_options options) {
+    throw std::runtime_error("AES-XTS file encryption requires GnuTLS 3.6.8 or later");
+}
+
+#endif
+
+}
@@ -23,6 +23,7 @@
 
 #include <seastar/core/file.hh>
 #include <seastar/core/shared_ptr.hh>
+#include <seastar/core/internal/io_request.hh>
 
 #include <deque>
 #include <atomic>
@@ -166,6 +167,7 @@ class posix_file_impl : public file_impl {
     future<size_t> do_read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) noexcept;
     future<size_t> do_read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) noexcept;
     future<temporary_buffer<uint8_t>> do_dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc, io_intent* intent) noexcept;
+    future<> do_discard(internal::io_request req) noexcept;
 };
 
 class posix_file_real_impl final : public posix_file_impl {
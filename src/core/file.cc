@@ -175,13 +175,12 @@ posix_file_impl::truncate(uint64_t length) noexcept {
 
 future<>
 posix_file_impl::discard(uint64_t offset, uint64_t length) noexcept {
-    return engine()._thread_pool->submit<syscall_result<int>>([this, offset, length] () mutable {
-        return wrap_syscall<int>(::fallocate(_fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE,
-            offset, length));
-    }).then([] (syscall_result<int> sr) {
-        sr.throw_if_error();
-        return make_ready_future<>();
-    });
+    return do_discard(internal::io_request::make_discard(_fd, offset, length));
+}
+
+future<>
+posix_file_impl::do_discard(internal::io_request req) noexcept {
+    return _io_queue.queue_discard(discard_priority_class(), std::move(req));
 }
 
 future<>
@@ -515,13 +514,7 @@ blockdev_file_impl::truncate(uint64_t length) noexcept {
 
 future<>
 blockdev_file_impl::discard(uint64_t offset, uint64_t length) noexcept {
-    return engine()._thread_pool->submit<syscall_result<int>>([this, offset, length] () mutable {
-        uint64_t range[2] { offset, length };
-        return wrap_syscall<int>(::ioctl(_fd, BLKDISCARD, &range));
-    }).then([] (syscall_result<int> sr) {
-        sr.throw_if_error();
-        return make_ready_future<>();
-    });
+    return do_discard(internal::io_request::make_blkdiscard(_fd, offset, length));
 }
 
 future<>
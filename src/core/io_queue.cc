@@ -31,10 +31,12 @@
 #include <seastar/core/internal/io_desc.hh>
 #include <seastar/core/internal/io_sink.hh>
 #include <seastar/core/io_priority_class.hh>
+#include <seastar/core/shared_future.hh>
 #include <seastar/util/log.hh>
 #include <chrono>
 #include <mutex>
 #include <array>
+#include <deque>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
@@ -57,6 +59,7 @@ class priority_class_data {
     uint64_t _ops;
     uint32_t _nr_queued;
     uint32_t _nr_executing;
+    uint64_t _nr_cancelled_in_flight;
     std::chrono::duration<double> _queue_time;
     std::chrono::duration<double> _total_queue_time;
     std::chrono::duration<double> _total_execution_time;
@@ -73,6 +76,7 @@ class priority_class_data {
         , _ops(0)
         , _nr_queued(0)
         , _nr_executing(0)
+        , _nr_cancelled_in_flight(0)
         , _queue_time(0)
         , _total_queue_time(0)
         , _total_execution_time(0)
@@ -106,15 +110,21 @@ class priority_class_data {
         _nr_executing--;
     }
 
+    void on_cancel_in_flight() noexcept {
+        _nr_cancelled_in_flight++;
+        _nr_executing--;
+    }
+
     priority_class_ptr pclass() const noexcept { return _ptr; }
 };
 
-class io_desc_read_write final : public io_completion {
+class io_desc_read_write final : public io_completion, public internal::cancellable_inflight {
     io_queue& _ioq;
     priority_class_data& _pclass;
     std::chrono::steady_clock::time_point _dispatched;
     fair_queue_ticket _fq_ticket;
     promise<size_t> _pr;
+    bool _cancel_requested = false;
 
 public:
     io_desc_read_write(io_queue& ioq, priority_class_data& pc, fair_queue_ticket ticket)
@@ -124,6 +134,12 @@ class io_desc_read_write final : public io_completion {
     {}
 
     virtual void set_exception(std::exception_ptr eptr) noexcept override {
+        if (_cancel_requested) {
+            // Whatever error the request ended with, the caller
+            // asked for it to go away
+            complete_cancelled();
+            return;
+        }
         io_log.trace("dev {} : req {} error", _ioq.dev_id(), fmt::ptr(this));
         _pclass.on_error();
         _ioq.notify_requests_finished(_fq_ticket);
@@ -146,6 +162,21 @@ class io_desc_read_write final : public io_completion {
         delete this;
     }
 
+    // Called when the intent is cancelled after the request was dispatched
+    virtual void cancel_inflight() noexcept override {
+        io_log.trace("dev {} : req {} cancel in flight", _ioq.dev_id(), fmt::ptr(this));
+        _cancel_requested = true;
+        _ioq.cancel_inflight_request(this);
+    }
+
+    void complete_cancelled() noexcept {
+        io_log.trace("dev {} : req {} cancelled in flight", _ioq.dev_id(), fmt::ptr(this));
+        _pclass.on_cancel_in_flight();
+        _ioq.notify_requests_finished(_fq_ticket);
+        _pr.set_exception(std::make_exception_ptr(default_io_exception_factory::cancelled()));
+        delete this;
+    }
+
     void dispatch(size_t len, std::chrono::steady_clock::time_point queued) noexcept {
         auto now = std::chrono::steady_clock::now();
         _pclass.on_dispatch(len, std::chrono::duration_cast<std::chrono::duration<double>>(now - queued));
@@ -200,8 +231,11 @@ class queued_io_request : private internal::io_request {
         _desc.release()->cancel();
     }
 
-    void set_intent(internal::cancellable_queue* cq) noexcept {
+    void set_intent(io_intent* intent, internal::cancellable_queue* cq) noexcept {
         _intent.enqueue(cq);
+        if (intent != nullptr) {
+            intent->bind_inflight(*_desc);
+        }
     }
 
     future<size_t> get_future() noexcept { return _desc->get_future(); }
@@ -278,6 +312,146 @@ io_intent* internal::intent_reference::retrieve() const {
     return _intent;
 }
 
+// Discards sit here before entering the fair queue. This lets adjacent
+// discards (e.g. those of consecutive extents of a deleted file) merge into
+// a single range, and lets large ranges be fed to the disk in chunks paced
+// to the configured bandwidth, so that they don't starve foreground I/O.
+class io_queue::discard_queue {
+    struct range {
+        io_priority_class pc;
+        int fd;
+        internal::io_request::operation op;
+        // The part of the range not yet dispatched is [pos, end)
+        uint64_t pos;
+        uint64_t end;
+        bool dispatched_any = false;
+        unsigned in_flight = 0;
+        std::exception_ptr ex;
+        shared_promise<> done;
+
+        range(const io_priority_class& pc, const internal::io_request& req)
+            : pc(pc), fd(req.fd()), op(req.opcode()), pos(req.pos()), end(req.pos() + req.size())
+        {}
+
+        bool matches(const io_priority_class& opc, const internal::io_request& req) const noexcept {
+            return pc.id() == opc.id() && fd == req.fd() && op == req.opcode();
+        }
+
+        internal::io_request make_request(size_t len) const noexcept {
+            return op == internal::io_request::operation::blkdiscard
+                ? internal::io_request::make_blkdiscard(fd, pos, len)
+                : internal::io_request::make_discard(fd, pos, len);
+        }
+
+        void maybe_complete() {
+            if (pos == end && in_flight == 0) {
+                if (ex) {
+                    done.set_exception(std::move(ex));
+                } else {
+                    done.set_value();
+                }
+            }
+        }
+    };
+
+    // Looking further back than that for an adjacent range is not worth it
+    static constexpr unsigned max_merge_lookback = 16;
+
+    io_queue& _ioq;
+    std::deque<lw_shared_ptr<range>> _pending;
+    // Token bucket, in bytes; may go negative after a large chunk
+    double _tokens;
+    std::chrono::steady_clock::time_point _replenished;
+
+    bool rate_limited() const noexcept {
+        return _ioq.get_config().discard_bytes_rate != std::numeric_limits<uint64_t>::max();
+    }
+
+    void replenish(std::chrono::steady_clock::time_point now) noexcept {
+        auto& cfg = _ioq.get_config();
+        auto delta = std::chrono::duration_cast<std::chrono::duration<double>>(now - _replenished).count();
+        _tokens = std::min<double>(_tokens + delta * cfg.discard_bytes_rate, cfg.discard_max_request_size);
+        _replenished = now;
+    }
+
+public:
+    explicit discard_queue(io_queue& ioq)
+        : _ioq(ioq)
+        , _tokens(ioq.get_config().discard_max_request_size)
+        , _replenished(std::chrono::steady_clock::now())
+    {}
+
+    future<> queue(const io_priority_class& pc, internal::io_request req) {
+        if (!req.size()) {
+            return make_ready_future<>();
+        }
+        auto pos = req.pos();
+        auto end = pos + req.size();
+        unsigned looked = 0;
+        for (auto it = _pending.rbegin(); it != _pending.rend() && looked < max_merge_lookback; ++it, ++looked) {
+            auto& r = **it;
+            if (!r.matches(pc, req)) {
+                continue;
+            }
+            if (r.end == pos) {
+                r.end = end;
+                return r.done.get_shared_future();
+            }
+            if (end == r.pos && !r.dispatched_any) {
+                r.pos = pos;
+                return r.done.get_shared_future();
+            }
+        }
+        auto r = make_lw_shared<range>(pc, req);
+        auto f = r->done.get_shared_future();
+        _pending.push_back(std::move(r));
+        return f;
+    }
+
+    void dispatch() {
+        if (_pending.empty()) {
+            return;
+        }
+        if (rate_limited()) {
+            replenish(std::chrono::steady_clock::now());
+        }
+        while (!_pending.empty() && _tokens > 0) {
+            auto r = _pending.front();
+            size_t len = std::min<uint64_t>(r->end - r->pos, _ioq.get_config().discard_max_request_size);
+            auto req = r->make_request(len);
+            r->pos += len;
+            r->dispatched_any = true;
+            r->in_flight++;
+            if (rate_limited()) {
+                _tokens -= len;
+            }
+            if (r->pos == r->end) {
+                _pending.pop_front();
+            }
+            (void)_ioq.queue_request(r->pc, len, std::move(req), nullptr).then_wrapped([r] (future<size_t> f) {
+                if (f.failed()) {
+                    auto ex = f.get_exception();
+                    if (!r->ex) {
+                        r->ex = std::move(ex);
+                    }
+                } else {
+                    f.ignore_ready_future();
+                }
+                r->in_flight--;
+                r->maybe_complete();
+            });
+        }
+    }
+
+    std::chrono::steady_clock::time_point next_pending() const noexcept {
+        if (_pending.empty() || _tokens > 0) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        auto wait = std::chrono::duration<double>(-_tokens / _ioq.get_config().discard_bytes_rate);
+        return _replenished + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait);
+    }
+};
+
 void
 io_queue::notify_requests_finished(fair_queue_ticket& desc) noexcept {
     _requests_executing--;
@@ -296,6 +470,7 @@ io_queue::io_queue(io_group_ptr group, internal::io_sink& sink)
     , _group(std::move(group))
     , _fq(_group->_fg, make_fair_queue_config(_group->_config))
     , _sink(sink)
+    , _discards(std::make_unique<discard_queue>(*this))
 {
     seastar_logger.debug("Created io queue, multipliers {}:{}",
             get_config().disk_req_write_to_read_multiplier,
@@ -364,6 +539,14 @@ sstring io_priority_class::get_name() const {
 }
 
 io_priority_class io_priority_class::register_one(sstring name, uint32_t shares) {
+    return do_register(std::move(name), shares, true);
+}
+
+io_priority_class io_priority_class::register_or_reuse(sstring name, uint32_t shares) {
+    return do_register(std::move(name), shares, false);
+}
+
+io_priority_class io_priority_class::do_register(sstring name, uint32_t shares, bool check_shares) {
     std::lock_guard<std::mutex> lock(_register_lock);
     for (unsigned i = 0; i < _max_classes; ++i) {
         if (!_infos[i].registered()) {
@@ -376,7 +559,7 @@ io_priority_class io_priority_class::register_one(sstring name, uint32_t shares)
             // make sure it was registered with the same number shares
             // Note: those may change dynamically later on in the
             // fair queue priority_class_ptr
-            assert(_infos[i].shares == shares);
+            assert(!check_shares || _infos[i].shares == shares);
         }
         return io_priority_class(i);
     }
@@ -465,6 +648,8 @@ priority_class_data::register_stats(sstring name, sstring mountpoint) {
             sm::make_derive("total_exec_sec", [this] {
                     return _total_execution_time.count();
                 }, sm::description("Total time spent in disk"), {io_queue_shard(shard), sm::shard_label(owner), mountlabel, class_label}),
+            sm::make_derive("total_cancelled_in_flight", _nr_cancelled_in_flight,
+                    sm::description("Total requests cancelled by their intent after being dispatched"), {io_queue_shard(shard), sm::shard_label(owner), mountlabel, class_label}),
 
             // Note: The counter below is not the same as reactor's queued-io-requests
             // queued-io-requests shows us how many requests in total exist in this I/O Queue.
@@ -521,7 +706,12 @@ priority_class_data& io_queue::find_or_create_class(const io_priority_class& pc)
 fair_queue_ticket io_queue::request_fq_ticket(const internal::io_request& req, size_t len) const {
     unsigned weight;
     size_t size;
-    if (req.is_write()) {
+    if (req.is_discard()) {
+        // Discards move no data; they cost the disk a (write-like) request.
+        // Their volume is limited by the discard_queue pacing instead.
+        weight = get_config().disk_req_write_to_read_multiplier;
+        size = get_config().disk_bytes_write_to_read_multiplier * minimal_request_size;
+    } else if (req.is_write()) {
         weight = get_config().disk_req_write_to_read_multiplier;
         size = get_config().disk_bytes_write_to_read_multiplier * len;
     } else if (req.is_read()) {
@@ -568,7 +758,7 @@ io_queue::queue_request(const io_priority_class& pc, size_t len, internal::io_re
         }
 
         _fq.queue(pclass.pclass(), queued_req->queue_entry());
-        queued_req->set_intent(cq);
+        queued_req->set_intent(intent, cq);
         queued_req.release();
         pclass.on_queue();
         _queued_requests++;
@@ -576,7 +766,18 @@ io_queue::queue_request(const io_priority_class& pc, size_t len, internal::io_re
     });
 }
 
+future<> io_queue::queue_discard(const io_priority_class& pc, internal::io_request req) noexcept {
+    return futurize_invoke([this, &pc, req = std::move(req)] () mutable {
+        return _discards->queue(pc, std::move(req));
+    });
+}
+
+std::chrono::steady_clock::time_point io_queue::next_pending_aio() const noexcept {
+    return std::min(_fq.next_pending_aio(), _discards->next_pending());
+}
+
 void io_queue::poll_io_queue() {
+    _discards->dispatch();
     _fq.dispatch_requests([] (fair_queue_entry& fqe) {
         queued_io_request::from_fq_entry(fqe).dispatch();
     });
@@ -597,6 +798,17 @@ void io_queue::complete_cancelled_request(queued_io_request& req) noexcept {
     _fq.notify_requests_finished(req.queue_entry().ticket());
 }
 
+void io_queue::cancel_inflight_request(io_desc_read_write* desc) noexcept {
+    // Not yet picked up by the reactor -- just drop it. Otherwise
+    // the request is in the kernel and will complete via the usual
+    // path, either cancelled or not
+    if (_sink.cancel(desc)) {
+        desc->complete_cancelled();
+        return;
+    }
+    engine().cancel_io(desc);
+}
+
 future<>
 io_queue::update_shares_for_class(const io_priority_class pc, size_t new_shares) {
     return futurize_invoke([this, pc, new_shares] {
@@ -621,4 +833,15 @@ void internal::io_sink::submit(io_completion* desc, internal::io_request req) no
     }
 }
 
+bool internal::io_sink::cancel(io_completion* desc) noexcept {
+    auto it = std::find_if(_pending_io.begin(), _pending_io.end(), [desc] (const pending_io_request& req) {
+        return req._completion == desc;
+    });
+    if (it == _pending_io.end()) {
+        return false;
+    }
+    _pending_io.erase(it, std::next(it));
+    return true;
+}
+
 }
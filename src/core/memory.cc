@@ -55,12 +55,14 @@
 #include <seastar/core/cacheline.hh>
 #include <seastar/core/memory.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/scheduling.hh>
 #include <seastar/util/alloc_failure_injector.hh>
 #include <seastar/util/memory_diagnostics.hh>
 #include <seastar/util/std-compat.hh>
 #include <seastar/util/log.hh>
 #include <seastar/core/aligned_buffer.hh>
 #include <unordered_set>
+#include <map>
 #include <iostream>
 #include <thread>
 
@@ -320,7 +322,8 @@ struct free_object {
 };
 
 struct page {
-    bool free;
+    bool free : 1;
+    uint8_t sched_group : 7; // for the head of an allocated span, the group it is charged to
     uint8_t offset_in_span;
     uint16_t nr_small_alloc;
     uint32_t span_size; // in pages, if we're the head or the tail
@@ -448,6 +451,9 @@ class small_pool_array {
     small_pool& operator[](unsigned idx) { return _u.a[idx]; }
 };
 
+// Small pools carve their objects out of spans of at most this many pages
+static constexpr unsigned max_small_pool_span_pages = 32;
+
 static constexpr size_t max_small_allocation
     = small_pool::idx_to_size(small_pool_array::nr_small_pools - 1);
 
@@ -506,6 +512,28 @@ struct cpu_pages {
     } asu;
     allocation_site_ptr alloc_site_list_head = nullptr; // For easy traversal of asu.alloc_sites from scylla-gdb.py
     bool collect_backtrace = false;
+    // Pages charged to each scheduling group, see charge_span()
+    struct group_memory {
+        size_t pages = 0;
+        size_t soft_limit_pages = std::numeric_limits<size_t>::max();
+        uint64_t soft_limit_exceeded = 0;
+        bool over_soft_limit = false;
+        std::function<void ()> on_soft_limit_exceeded;
+    };
+    std::array<group_memory, max_scheduling_groups()> groups;
+    // Number of spans in each of free_spans, for the fragmentation metrics
+    std::array<uint32_t, nr_span_lists> nr_free_spans = {};
+    // Allocations of at least remap_threshold_pages that find no contiguous
+    // free span are assembled from scattered free spans, moved with mremap()
+    // into the remap window: the upper half of the shard's address range.
+    // Any local pointer at or above remap_window is such an allocation.
+    static constexpr size_t remap_window_size = (size_t(1) << cpu_id_shift) / 2;
+    char* remap_window = nullptr;
+    size_t remap_threshold_pages = (size_t(1) << 20) / page_size;
+    bool remap_supported = false;
+    std::map<size_t, size_t> remap_window_free; // offset -> length, both in pages
+    uint64_t remapped_allocs = 0;
+    size_t remapped_pages = 0;
     char* mem() { return memory; }
 
     void link(page_list& list, page* span);
@@ -515,7 +543,22 @@ struct cpu_pages {
         unsigned nr_pages;
     };
     void maybe_reclaim();
-    void* allocate_large_and_trim(unsigned nr_pages);
+    void* allocate_large_and_trim(unsigned nr_pages, bool reclaim = true);
+    bool is_remapped(void* ptr) const {
+        return reinterpret_cast<char*>(ptr) >= remap_window;
+    }
+    void* allocate_remapped(unsigned nr_pages);
+    void free_remapped(void* ptr);
+    size_t remapped_object_size(void* ptr);
+    bool reserve_remap_window(size_t nr_pages, size_t& offset);
+    void release_remap_window(size_t offset, size_t nr_pages);
+    void setup_remap_window(bool anonymous_memory);
+    void charge(unsigned sg, size_t nr_pages);
+    void uncharge(unsigned sg, size_t nr_pages);
+    void check_soft_limit(group_memory& g);
+    void move_charge(unsigned from, unsigned to);
+    void charge_span(page* span);
+    void uncharge_span(page* span, uint32_t nr_pages);
     void* allocate_large(unsigned nr_pages);
     void* allocate_large_aligned(unsigned align_pages, unsigned nr_pages);
     page* find_and_unlink_span(unsigned nr_pages);
@@ -615,11 +658,13 @@ unsigned index_of(unsigned pages) {
 void
 cpu_pages::unlink(page_list& list, page* span) {
     list.erase(pages, *span);
+    --nr_free_spans[&list - free_spans];
 }
 
 void
 cpu_pages::link(page_list& list, page* span) {
     list.push_front(pages, *span);
+    ++nr_free_spans[&list - free_spans];
 }
 
 void cpu_pages::free_span_no_merge(uint32_t span_start, uint32_t nr_pages) {
@@ -718,13 +763,13 @@ void cpu_pages::maybe_reclaim() {
 }
 
 void*
-cpu_pages::allocate_large_and_trim(unsigned n_pages) {
+cpu_pages::allocate_large_and_trim(unsigned n_pages, bool reclaim) {
     // Avoid exercising the reclaimers for requests we'll not be able to satisfy
     // nr_pages might be zero during startup, so check for that too
     if (nr_pages && n_pages >= nr_pages) {
         return nullptr;
     }
-    page* span = find_and_unlink_span_reclaiming(n_pages);
+    page* span = reclaim ? find_and_unlink_span_reclaiming(n_pages) : find_and_unlink_span(n_pages);
     if (!span) {
         return nullptr;
     }
@@ -740,6 +785,7 @@ cpu_pages::allocate_large_and_trim(unsigned n_pages) {
     span->free = span_end->free = false;
     span->span_size = span_end->span_size = span_size;
     span->pool = nullptr;
+    charge_span(span);
 #ifdef SEASTAR_HEAPPROF
     auto alloc_site = get_allocation_site();
     span->alloc_site = alloc_site;
@@ -752,6 +798,302 @@ cpu_pages::allocate_large_and_trim(unsigned n_pages) {
     return mem() + span_idx * page_size;
 }
 
+// Spans are charged to the scheduling group that takes them from the free
+// page pool: large allocations exactly, small objects by the pool spans
+// they refill, so the per-object fast paths stay untouched.
+void
+cpu_pages::charge_span(page* span) {
+    auto sg = seastar::internal::scheduling_group_index(*seastar::internal::current_scheduling_group_ptr());
+    span->sched_group = sg;
+    charge(sg, span->span_size);
+}
+
+void
+cpu_pages::uncharge_span(page* span, uint32_t nr_pages) {
+    uncharge(span->sched_group, nr_pages);
+}
+
+void
+cpu_pages::charge(unsigned sg, size_t nr_pages) {
+    auto& g = groups[sg];
+    g.pages += nr_pages;
+    check_soft_limit(g);
+}
+
+void
+cpu_pages::uncharge(unsigned sg, size_t nr_pages) {
+    auto& g = groups[sg];
+    g.pages -= nr_pages;
+    if (g.pages <= g.soft_limit_pages) {
+        g.over_soft_limit = false;
+    }
+}
+
+void
+cpu_pages::move_charge(unsigned from, unsigned to) {
+    // Every allocated span charged to a group, remapped allocations included,
+    // records the group in its head page
+    for (pageidx i = 0; i < nr_pages;) {
+        auto& span = pages[i];
+        if (!span.span_size) {
+            ++i;
+            continue;
+        }
+        if (!span.free && span.sched_group == from) {
+            span.sched_group = to;
+        }
+        i += span.span_size;
+    }
+    groups[to].pages += std::exchange(groups[from].pages, 0);
+    check_soft_limit(groups[to]);
+}
+
+void
+cpu_pages::check_soft_limit(group_memory& g) {
+    if (g.pages > g.soft_limit_pages && !g.over_soft_limit) {
+        g.over_soft_limit = true;
+        ++g.soft_limit_exceeded;
+        if (g.on_soft_limit_exceeded && reclaim_hook) {
+            // Run it outside the allocator, like the async reclaimers
+            reclaim_hook(g.on_soft_limit_exceeded);
+        }
+    }
+}
+
+#ifndef MREMAP_DONTUNMAP
+#define MREMAP_DONTUNMAP 4
+#endif
+
+// Moves the pages backing [from, from + len) to [to, to + len), leaving
+// fresh anonymous memory at the source.
+static bool remap_pages(char* from, char* to, size_t len) {
+    static std::atomic<bool> dontunmap_supported{true};
+    if (dontunmap_supported.load(std::memory_order_relaxed)) {
+        if (::mremap(from, len, len, MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP, to) != MAP_FAILED) {
+            return true;
+        }
+        if (errno != EINVAL) {
+            return false;
+        }
+        // Kernels older than 5.7
+        dontunmap_supported.store(false, std::memory_order_relaxed);
+    }
+#ifdef SEASTAR_HAVE_NUMA
+    // The mapping that plugs the hole must get the arena's NUMA policy back
+    int policy = MPOL_DEFAULT;
+    unsigned long nodemask = 0;
+    if (::get_mempolicy(&policy, &nodemask, std::numeric_limits<unsigned long>::digits, from, MPOL_F_ADDR) == -1) {
+        policy = MPOL_DEFAULT;
+    }
+#endif
+    if (::mremap(from, len, len, MREMAP_MAYMOVE | MREMAP_FIXED, to) == MAP_FAILED) {
+        return false;
+    }
+    if (::mmap(from, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        // The arena has a hole that we can't plug
+        abort();
+    }
+    ::madvise(from, len, MADV_HUGEPAGE);
+#ifdef SEASTAR_HAVE_NUMA
+    if (policy != MPOL_DEFAULT) {
+        ::mbind(from, len, policy, &nodemask, std::numeric_limits<unsigned long>::digits, 0);
+    }
+#endif
+    return true;
+}
+
+// Returns [p, p + len) to the PROT_NONE reservation made by mem_base().
+static bool unmap_pages(char* p, size_t len) {
+    if (::mmap(p, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        return false;
+    }
+    ::madvise(p, len, MADV_DONTDUMP);
+    return true;
+}
+
+// A remapped allocation starts with a header page describing where in the
+// arena its pages came from; the object itself starts at the next page.
+struct remapped_header {
+    static constexpr unsigned max_pieces = 256;
+    struct piece {
+        pageidx start;
+        uint32_t nr_pages;
+    };
+    uint32_t nr_pages; // including the header page
+    uint32_t nr_pieces;
+    piece pieces[max_pieces];
+};
+
+static_assert(sizeof(remapped_header) <= page_size, "remapped_header must fit in a page");
+
+void cpu_pages::setup_remap_window(bool anonymous_memory) {
+    if (!anonymous_memory || size_t(nr_pages) * page_size > remap_window_size) {
+        // Move the window out of the arena's way, to where nothing lives
+        remap_window = memory + (size_t(1) << cpu_id_shift);
+        remap_supported = false;
+        return;
+    }
+    remap_window_free.clear();
+    remap_window_free.emplace(0, remap_window_size / page_size);
+    remap_supported = true;
+}
+
+bool cpu_pages::reserve_remap_window(size_t n_pages, size_t& offset) {
+    // First fit
+    for (auto it = remap_window_free.begin(); it != remap_window_free.end(); ++it) {
+        if (it->second < n_pages) {
+            continue;
+        }
+        offset = it->first;
+        if (auto rest = it->second - n_pages) {
+            try {
+                remap_window_free.emplace_hint(std::next(it), offset + n_pages, rest);
+            } catch (...) {
+                return false;
+            }
+        }
+        remap_window_free.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void cpu_pages::release_remap_window(size_t offset, size_t n_pages) {
+    auto next = remap_window_free.lower_bound(offset);
+    bool merge_next = next != remap_window_free.end() && offset + n_pages == next->first;
+    if (next != remap_window_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += n_pages;
+            if (merge_next) {
+                prev->second += next->second;
+                remap_window_free.erase(next);
+            }
+            return;
+        }
+    }
+    try {
+        if (merge_next) {
+            remap_window_free.emplace_hint(next, offset, n_pages + next->second);
+            remap_window_free.erase(next);
+        } else {
+            remap_window_free.emplace_hint(next, offset, n_pages);
+        }
+    } catch (...) {
+        // Leak the address range; the window is much larger than the arena
+    }
+}
+
+void*
+cpu_pages::allocate_remapped(unsigned n_pages) {
+    size_t total = size_t(n_pages) + 1;
+    if (total > nr_free_pages) {
+        return nullptr;
+    }
+    size_t offset;
+    if (!reserve_remap_window(total, offset)) {
+        return nullptr;
+    }
+    // Take free spans, largest first, until we have enough pages
+    remapped_header hdr;
+    hdr.nr_pages = total;
+    hdr.nr_pieces = 0;
+    size_t gathered = 0;
+    auto take = [&] (pageidx start, uint32_t n) {
+        auto span = &pages[start];
+        auto span_end = &pages[start + n - 1];
+        span->free = span_end->free = false;
+        span->span_size = span_end->span_size = n;
+        span->pool = nullptr;
+        hdr.pieces[hdr.nr_pieces++] = {start, n};
+        gathered += n;
+    };
+    for (unsigned idx = nr_span_lists; idx-- > 0 && gathered < total && hdr.nr_pieces < hdr.max_pieces; ) {
+        auto& list = free_spans[idx];
+        while (!list.empty() && gathered < total && hdr.nr_pieces < hdr.max_pieces) {
+            page* span = &list.front(pages);
+            unlink(list, span);
+            pageidx span_idx = span - pages;
+            uint32_t span_size = span->span_size;
+            nr_free_pages -= span_size;
+            // Like allocate_large_and_trim(), only ever take aligned power-of-two
+            // pieces, so that they can go back to the free lists as they are
+            while (span_size) {
+                auto need = total - gathered;
+                if (!need || hdr.nr_pieces == hdr.max_pieces) {
+                    free_span_no_merge(span_idx, span_size);
+                    break;
+                }
+                if (span_size <= need) {
+                    take(span_idx, span_size);
+                    break;
+                }
+                span_size /= 2;
+                if (need >= span_size) {
+                    take(span_idx, span_size);
+                    span_idx += span_size;
+                } else {
+                    free_span_no_merge(span_idx + span_size, span_size);
+                }
+            }
+        }
+    }
+    auto window = remap_window + offset * page_size;
+    auto undo = [&] (unsigned moved) {
+        if (moved && !unmap_pages(window, total * page_size)) {
+            seastar_memory_logger.warn("failed to unmap remapped allocation: errno {}", errno);
+        }
+        for (unsigned i = 0; i < hdr.nr_pieces; ++i) {
+            free_span(hdr.pieces[i].start, hdr.pieces[i].nr_pages);
+        }
+        release_remap_window(offset, total);
+        return nullptr;
+    };
+    if (gathered < total) {
+        return undo(0);
+    }
+    auto to = window;
+    for (unsigned i = 0; i < hdr.nr_pieces; ++i) {
+        auto len = size_t(hdr.pieces[i].nr_pages) * page_size;
+        if (!remap_pages(mem() + size_t(hdr.pieces[i].start) * page_size, to, len)) {
+            return undo(i);
+        }
+        to += len;
+    }
+    // The group is kept in the page array, like for other spans
+    auto& head = pages[hdr.pieces[0].start];
+    head.sched_group = seastar::internal::scheduling_group_index(*seastar::internal::current_scheduling_group_ptr());
+    std::memcpy(window, &hdr, sizeof(hdr));
+    charge(head.sched_group, total);
+    ++remapped_allocs;
+    remapped_pages += total;
+    maybe_reclaim();
+    return window + page_size;
+}
+
+void cpu_pages::free_remapped(void* ptr) {
+    auto window = reinterpret_cast<char*>(ptr) - page_size;
+    remapped_header hdr;
+    std::memcpy(&hdr, window, sizeof(hdr));
+    // The arena ranges the pages came from are already backed by fresh memory,
+    // so drop the pages instead of moving them back
+    if (!unmap_pages(window, size_t(hdr.nr_pages) * page_size)) {
+        seastar_memory_logger.warn("failed to unmap remapped allocation: errno {}", errno);
+    }
+    uncharge(pages[hdr.pieces[0].start].sched_group, hdr.nr_pages);
+    for (unsigned i = 0; i < hdr.nr_pieces; ++i) {
+        free_span(hdr.pieces[i].start, hdr.pieces[i].nr_pages);
+    }
+    --remapped_allocs;
+    remapped_pages -= hdr.nr_pages;
+    release_remap_window((window - remap_window) / page_size, hdr.nr_pages);
+}
+
+size_t cpu_pages::remapped_object_size(void* ptr) {
+    auto hdr = reinterpret_cast<remapped_header*>(reinterpret_cast<char*>(ptr) - page_size);
+    return size_t(hdr->nr_pages - 1) * page_size;
+}
+
 void
 cpu_pages::warn_large_allocation(size_t size) {
     alloc_stats::increment_local(alloc_stats::types::large_allocs);
@@ -770,6 +1112,16 @@ cpu_pages::check_large_allocation(size_t size) {
 void*
 cpu_pages::allocate_large(unsigned n_pages) {
     check_large_allocation(n_pages * page_size);
+    if (n_pages >= remap_threshold_pages && remap_supported) {
+        // Prefer a contiguous span, but rather than evicting memory to get
+        // one, assemble the allocation from scattered free spans
+        if (auto ptr = allocate_large_and_trim(n_pages, false)) {
+            return ptr;
+        }
+        if (auto ptr = allocate_remapped(n_pages)) {
+            return ptr;
+        }
+    }
     return allocate_large_and_trim(n_pages);
 }
 
@@ -846,6 +1198,9 @@ cpu_pages::allocate_small(unsigned size) {
 }
 
 void cpu_pages::free_large(void* ptr) {
+    if (is_remapped(ptr)) {
+        return free_remapped(ptr);
+    }
     pageidx idx = (reinterpret_cast<char*>(ptr) - mem()) / page_size;
     page* span = &pages[idx];
 #ifdef SEASTAR_HEAPPROF
@@ -855,10 +1210,14 @@ void cpu_pages::free_large(void* ptr) {
         alloc_site->size -= span->span_size * page_size;
     }
 #endif
+    uncharge_span(span, span->span_size);
     free_span(idx, span->span_size);
 }
 
 size_t cpu_pages::object_size(void* ptr) {
+    if (is_remapped(ptr)) {
+        return remapped_object_size(ptr);
+    }
     page* span = to_page(ptr);
     if (span->pool) {
         auto s = span->pool->object_size();
@@ -904,6 +1263,9 @@ bool cpu_pages::drain_cross_cpu_freelist() {
 }
 
 void cpu_pages::free(void* ptr) {
+    if (__builtin_expect(is_remapped(ptr), false)) {
+        return free_remapped(ptr);
+    }
     page* span = to_page(ptr);
     if (span->pool) {
         small_pool& pool = *span->pool;
@@ -963,6 +1325,9 @@ cpu_pages::try_foreign_free(void* ptr) {
 void cpu_pages::shrink(void* ptr, size_t new_size) {
     auto obj_cpu = object_cpu_id(ptr);
     assert(obj_cpu == cpu_id);
+    if (is_remapped(ptr)) {
+        return;
+    }
     page* span = to_page(ptr);
     if (span->pool) {
         return;
@@ -982,6 +1347,7 @@ void cpu_pages::shrink(void* ptr, size_t new_size) {
         alloc_site->size += new_size_pages * page_size;
     }
 #endif
+    uncharge_span(span, old_size_pages - new_size_pages);
     span->span_size = new_size_pages;
     span[new_size_pages - 1].free = false;
     span[new_size_pages - 1].span_size = new_size_pages;
@@ -1020,6 +1386,7 @@ bool cpu_pages::initialize() {
     ::madvise(base, size, MADV_HUGEPAGE);
     pages = reinterpret_cast<page*>(base);
     memory = base;
+    remap_window = base + remap_window_size;
     nr_pages = size / page_size;
     // we reserve the end page so we don't have to special case
     // the last span.
@@ -1083,10 +1450,13 @@ void cpu_pages::do_resize(size_t new_size, allocate_system_memory_fn alloc_sys_m
     // one past last page structure is a sentinel
     auto new_page_array_pages = align_up(sizeof(page[new_pages + 1]), page_size) / page_size;
     auto new_page_array
-        = reinterpret_cast<page*>(allocate_large(new_page_array_pages));
+        = reinterpret_cast<page*>(allocate_large_and_trim(new_page_array_pages));
     if (!new_page_array) {
         throw std::bad_alloc();
     }
+    // The page array belongs to the allocator, not to a scheduling group
+    auto new_page_array_span = to_page(new_page_array);
+    uncharge_span(new_page_array_span, new_page_array_span->span_size);
     std::copy(pages, pages + nr_pages, new_page_array);
     // mark new one-past-last page as taken to avoid boundary conditions
     new_page_array[new_pages].free = false;
@@ -1188,7 +1558,7 @@ small_pool::small_pool(unsigned object_size) noexcept
     // satisfies this, just go with the minimum waste out of the checked span sizes.
     float min_waste = std::numeric_limits<float>::max();
     unsigned min_waste_span_size = 0;
-    for (span_size = 1; span_size <= 32; span_size *= 2) {
+    for (span_size = 1; span_size <= max_small_pool_span_pages; span_size *= 2) {
         if (span_bytes() / object_size >= 4) {
             auto w = waste();
             if (w < min_waste) {
@@ -1257,10 +1627,12 @@ small_pool::add_more_objects() {
     while (_free_count < goal) {
         disable_backtrace_temporarily dbt;
         auto span_size = _span_sizes.preferred;
-        auto data = reinterpret_cast<char*>(get_cpu_mem().allocate_large(span_size));
+        // Spans must come from the arena, since their objects are found
+        // through to_page(); never let them be remapped
+        auto data = reinterpret_cast<char*>(get_cpu_mem().allocate_large_and_trim(span_size));
         if (!data) {
             span_size = _span_sizes.fallback;
-            data = reinterpret_cast<char*>(get_cpu_mem().allocate_large(span_size));
+            data = reinterpret_cast<char*>(get_cpu_mem().allocate_large_and_trim(span_size));
             if (!data) {
                 return;
             }
@@ -1302,6 +1674,7 @@ small_pool::trim_free_list() {
         if (--span->nr_small_alloc == 0) {
             _pages_in_use -= span->span_size;
             _span_list.erase(get_cpu_mem().pages, *span);
+            get_cpu_mem().uncharge_span(span, span->span_size);
             get_cpu_mem().free_span(span - get_cpu_mem().pages, span->span_size);
         }
     }
@@ -1519,6 +1892,8 @@ void configure(std::vector<resource::memory> m, bool mbind,
         get_cpu_mem().replace_memory_backing(sys_alloc);
     }
     get_cpu_mem().resize(total, sys_alloc);
+    // mremap() does not support hugetlbfs
+    get_cpu_mem().setup_remap_window(!hugetlbfs_path);
     size_t pos = 0;
     for (auto&& x : m) {
 #ifdef SEASTAR_HAVE_NUMA
@@ -1541,6 +1916,25 @@ void configure(std::vector<resource::memory> m, bool mbind,
     }
 }
 
+size_t prefault() {
+    auto& cm = get_cpu_mem();
+    auto start = cm.mem();
+    auto size = size_t(cm.nr_pages) * page_size;
+#ifdef MADV_POPULATE_WRITE
+    // Linux 5.14+: fault the range in with a single syscall
+    if (::madvise(start, size, MADV_POPULATE_WRITE) == 0) {
+        return size;
+    }
+#endif
+    // The shard's memory is private to its thread and nothing else runs on
+    // the shard yet, so rewriting a byte of each page is safe.
+    for (size_t off = 0; off < size; off += page_size) {
+        auto p = reinterpret_cast<volatile char*>(start + off);
+        *p = *p;
+    }
+    return size;
+}
+
 statistics stats() {
     return statistics{alloc_stats::get(alloc_stats::types::allocs), alloc_stats::get(alloc_stats::types::frees), alloc_stats::get(alloc_stats::types::cross_cpu_frees),
         cpu_mem.nr_pages * page_size, cpu_mem.nr_free_pages * page_size, alloc_stats::get(alloc_stats::types::reclaims), alloc_stats::get(alloc_stats::types::large_allocs),
@@ -1563,6 +1957,67 @@ void set_min_free_pages(size_t pages) {
     get_cpu_mem().set_min_free_pages(pages);
 }
 
+static_assert(max_scheduling_groups() <= 128, "page::sched_group is too narrow");
+static_assert(std::tuple_size<decltype(fragmentation_stats::free_spans)>::value == cpu_pages::nr_span_lists);
+
+scheduling_group_memory_stats scheduling_group_memory(scheduling_group sg) noexcept {
+    auto& g = get_cpu_mem().groups[seastar::internal::scheduling_group_index(sg)];
+    scheduling_group_memory_stats ret;
+    ret.allocated_memory = g.pages * page_size;
+    ret.soft_limit = g.soft_limit_pages == std::numeric_limits<size_t>::max() ? std::numeric_limits<size_t>::max() : g.soft_limit_pages * page_size;
+    ret.soft_limit_exceeded = g.soft_limit_exceeded;
+    ret.over_soft_limit = g.over_soft_limit;
+    return ret;
+}
+
+void set_scheduling_group_memory_soft_limit(scheduling_group sg, size_t limit, std::function<void ()> on_exceeded) {
+    auto& cpu_mem = get_cpu_mem();
+    auto& g = cpu_mem.groups[seastar::internal::scheduling_group_index(sg)];
+    g.soft_limit_pages = limit == std::numeric_limits<size_t>::max() ? limit : limit / page_size;
+    g.on_soft_limit_exceeded = std::move(on_exceeded);
+    // A group that is already over the new limit has just crossed it
+    if (g.pages <= g.soft_limit_pages) {
+        g.over_soft_limit = false;
+    }
+    cpu_mem.check_soft_limit(g);
+}
+
+void release_scheduling_group_memory(scheduling_group sg) noexcept {
+    auto& cpu_mem = get_cpu_mem();
+    auto id = seastar::internal::scheduling_group_index(sg);
+    auto& g = cpu_mem.groups[id];
+    g.soft_limit_pages = std::numeric_limits<size_t>::max();
+    g.soft_limit_exceeded = 0;
+    g.over_soft_limit = false;
+    g.on_soft_limit_exceeded = {};
+    if (g.pages) {
+        cpu_mem.move_charge(id, seastar::internal::scheduling_group_index(default_scheduling_group()));
+    }
+}
+
+fragmentation_stats fragmentation() noexcept {
+    auto& cpu = get_cpu_mem();
+    fragmentation_stats ret;
+    for (unsigned i = 0; i < cpu_pages::nr_span_lists; ++i) {
+        ret.free_spans[i] = cpu.nr_free_spans[i];
+        if (cpu.nr_free_spans[i]) {
+            ret.largest_free_span = (size_t(1) << i) * page_size;
+        }
+    }
+    if (cpu.nr_free_pages) {
+        ret.fragmentation = 1 - double(ret.largest_free_span) / (size_t(cpu.nr_free_pages) * page_size);
+    }
+    ret.remapped_allocations = cpu.remapped_allocs;
+    ret.remapped_memory = cpu.remapped_pages * page_size;
+    return ret;
+}
+
+void set_remapped_allocation_threshold(size_t threshold) {
+    // Stay above the spans of the small pools, whose pages must be in the arena
+    get_cpu_mem().remap_threshold_pages = threshold == std::numeric_limits<size_t>::max()
+            ? threshold : std::max<size_t>(align_up(threshold, page_size) / page_size, max_small_pool_span_pages + 1);
+}
+
 static thread_local int report_on_alloc_failure_suppressed = 0;
 
 class disable_report_on_alloc_failure_temporarily {
@@ -2229,6 +2684,10 @@ void set_reclaim_hook(std::function<void (std::function<void ()>)> hook) {
 void configure(std::vector<resource::memory> m, bool mbind, std::optional<std::string> hugepages_path) {
 }
 
+size_t prefault() {
+    return 0;
+}
+
 statistics stats() {
     return statistics{0, 0, 0, 1 << 30, 1 << 30, 0, 0, 0, 0, 0};
 }
@@ -2249,6 +2708,26 @@ void set_min_free_pages(size_t pages) {
     // Ignore, reclaiming not supported for default allocator.
 }
 
+scheduling_group_memory_stats scheduling_group_memory(scheduling_group) noexcept {
+    return {};
+}
+
+void set_scheduling_group_memory_soft_limit(scheduling_group, size_t, std::function<void ()>) {
+    // Ignore, not supported for default allocator.
+}
+
+void release_scheduling_group_memory(scheduling_group) noexcept {
+    // Nothing is charged with the default allocator.
+}
+
+fragmentation_stats fragmentation() noexcept {
+    return {};
+}
+
+void set_remapped_allocation_threshold(size_t) {
+    // Ignore, not supported for default allocator.
+}
+
 void set_large_allocation_warning_threshold(size_t) {
     // Ignore, not supported for default allocator.
 }
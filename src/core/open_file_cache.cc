@@ -0,0 +1,343 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/core/open_file_cache.hh>
+#include <seastar/core/layered_file.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/loop.hh>
+#include "fsnotify.hh"
+
+namespace seastar {
+
+// Forwards everything to the cached file, except close() which only
+// hands the file back to the cache.
+class open_file_cache::cached_file_impl final : public layered_file_impl {
+    open_file_cache& _cache;
+    lw_shared_ptr<entry> _entry;
+
+    void release() noexcept {
+        if (_entry) {
+            _cache.release(std::move(_entry));
+        }
+    }
+public:
+    cached_file_impl(open_file_cache& cache, lw_shared_ptr<entry> e)
+        : layered_file_impl(e->f)
+        , _cache(cache)
+        , _entry(std::move(e))
+    {}
+
+    ~cached_file_impl() {
+        release();
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, const io_priority_class& pc) override {
+        return write_dma(pos, buffer, len, pc, nullptr);
+    }
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) override {
+        return _underlying_file.dma_write(pos, static_cast<const char*>(buffer), len, pc, intent);
+    }
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc) override {
+        return write_dma(pos, std::move(iov), pc, nullptr);
+    }
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) override {
+        return _underlying_file.dma_write(pos, std::move(iov), pc, intent);
+    }
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc) override {
+        return read_dma(pos, buffer, len, pc, nullptr);
+    }
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, const io_priority_class& pc, io_intent* intent) override {
+        return _underlying_file.dma_read(pos, static_cast<char*>(buffer), len, pc, intent);
+    }
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc) override {
+        return read_dma(pos, std::move(iov), pc, nullptr);
+    }
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, const io_priority_class& pc, io_intent* intent) override {
+        return _underlying_file.dma_read(pos, std::move(iov), pc, intent);
+    }
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc) override {
+        return dma_read_bulk(offset, range_size, pc, nullptr);
+    }
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, const io_priority_class& pc, io_intent* intent) override {
+        return _underlying_file.dma_read_bulk<uint8_t>(offset, range_size, pc, intent);
+    }
+    virtual future<> flush() override {
+        return _underlying_file.flush();
+    }
+    virtual future<struct stat> stat() override {
+        return _underlying_file.stat();
+    }
+    virtual future<> truncate(uint64_t length) override {
+        return _underlying_file.truncate(length);
+    }
+    virtual future<> discard(uint64_t offset, uint64_t length) override {
+        return _underlying_file.discard(offset, length);
+    }
+    virtual future<> allocate(uint64_t position, uint64_t length) override {
+        return _underlying_file.allocate(position, length);
+    }
+    virtual future<uint64_t> size() override {
+        return _underlying_file.size();
+    }
+    virtual future<> close() override {
+        release();
+        return make_ready_future<>();
+    }
+    virtual subscription<directory_entry> list_directory(std::function<future<> (directory_entry de)> next) override {
+        return _underlying_file.list_directory(std::move(next));
+    }
+};
+
+class open_file_cache::watcher {
+    open_file_cache& _cache;
+    fsnotifier _notifier;
+    std::unordered_map<fsnotifier::watch_token, std::pair<sstring, fsnotifier::watch>> _dirs;
+    future<> _done;
+
+    void handle(const fsnotifier::event& ev) {
+        auto it = _dirs.find(ev.id);
+        if (it == _dirs.end()) {
+            return;
+        }
+        auto& dir = it->second.first;
+        if (bool(ev.mask & (fsnotifier::flags::delete_self | fsnotifier::flags::move_self))) {
+            // Everything below the directory is gone or moved
+            auto prefix = dir + "/";
+            std::vector<sstring> names;
+            for (auto& [name, e] : _cache._entries) {
+                if (name.size() > prefix.size() && std::equal(prefix.begin(), prefix.end(), name.begin())) {
+                    names.push_back(name);
+                }
+            }
+            for (auto& name : names) {
+                _cache.invalidate(name);
+            }
+        } else if (!ev.name.empty()) {
+            _cache.invalidate(dir + "/" + ev.name);
+        }
+    }
+public:
+    explicit watcher(open_file_cache& cache)
+        : _cache(cache)
+        , _done(repeat([this] {
+            return _notifier.wait().then([this] (std::vector<fsnotifier::event> events) {
+                for (auto& ev : events) {
+                    handle(ev);
+                }
+                return stop_iteration(!_notifier.active());
+            });
+        }).handle_exception([] (std::exception_ptr ep) {
+            // Either shut down, or inotify failed: nothing more to watch
+            seastar_logger.debug("open_file_cache: stopped watching directories: {}", ep);
+        }))
+    {}
+
+    future<> add(sstring dir) {
+        while (dir.size() > 1 && dir.back() == '/') {
+            dir.resize(dir.size() - 1);
+        }
+        auto mask = fsnotifier::flags::delete_child | fsnotifier::flags::move | fsnotifier::flags::delete_self | fsnotifier::flags::move_self;
+        return _notifier.create_watch(dir, mask).then([this, dir] (fsnotifier::watch w) mutable {
+            auto token = w.token();
+            _dirs.emplace(token, std::make_pair(std::move(dir), std::move(w)));
+        });
+    }
+
+    future<> stop() {
+        _notifier.shutdown();
+        return std::move(_done);
+    }
+};
+
+open_file_cache::open_file_cache(open_file_cache_config cfg)
+    : _cfg(cfg)
+{}
+
+open_file_cache::~open_file_cache() = default;
+
+void open_file_cache::acquire(entry& e) {
+    _gate.enter();
+    if (e._lru_link.is_linked()) {
+        _lru.erase(_lru.iterator_to(e));
+    }
+    e.users++;
+}
+
+// Each caller of release() and close_entry() holds the gate on behalf of
+// the entry, so closes started while close() waits on the gate are covered.
+void open_file_cache::release(lw_shared_ptr<entry> e) noexcept {
+    if (--e->users) {
+        _gate.leave();
+        return;
+    }
+    if (!e->mapped || _closing) {
+        close_entry(std::move(e));
+        return;
+    }
+    _lru.push_back(*e);
+    evict();
+    _gate.leave();
+}
+
+void open_file_cache::close_entry(lw_shared_ptr<entry> e) noexcept {
+    _stats.open_files--;
+    if (!e->f) {
+        // Opening it failed
+        _gate.leave();
+        return;
+    }
+    (void)e->f.close().handle_exception([e] (std::exception_ptr ep) {
+        seastar_logger.warn("open_file_cache: failed to close {}: {}", e->name, ep);
+    }).finally([this, e] {
+        _gate.leave();
+    });
+}
+
+void open_file_cache::evict() noexcept {
+    while (_stats.open_files > _cfg.max_open_files && !_lru.empty()) {
+        auto& e = _lru.front();
+        _lru.pop_front();
+        unmap(e);
+        _stats.evictions++;
+        _gate.enter();
+        close_entry(e.shared_from_this());
+    }
+}
+
+void open_file_cache::unmap(entry& e) noexcept {
+    if (!e.mapped) {
+        return;
+    }
+    auto range = _entries.equal_range(e.name);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.get() == &e) {
+            _entries.erase(it);
+            break;
+        }
+    }
+    e.mapped = false;
+}
+
+future<file> open_file_cache::wait_opened(lw_shared_ptr<entry> e) noexcept {
+    return e->opened.get_future().then_wrapped([this, e = std::move(e)] (future<> f) mutable {
+        if (f.failed()) {
+            auto ex = f.get_exception();
+            unmap(*e);
+            release(std::move(e));
+            return make_exception_future<file>(std::move(ex));
+        }
+        try {
+            return make_ready_future<file>(file(make_shared<cached_file_impl>(*this, e)));
+        } catch (...) {
+            release(std::move(e));
+            return current_exception_as_future<file>();
+        }
+    });
+}
+
+future<file> open_file_cache::open(sstring name, open_flags flags, file_open_options options) noexcept {
+    try {
+        if (_closing) {
+            throw gate_closed_exception();
+        }
+        if (bool(flags & (open_flags::create | open_flags::truncate | open_flags::exclusive))) {
+            _stats.bypasses++;
+            return open_file_dma(name, flags, std::move(options));
+        }
+        auto range = _entries.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second->flags == flags) {
+                auto e = it->second;
+                acquire(*e);
+                _stats.hits++;
+                return wait_opened(std::move(e));
+            }
+        }
+        auto e = make_lw_shared<entry>(name, flags);
+        _entries.emplace(std::move(name), e);
+        acquire(*e);
+        _stats.misses++;
+        _stats.open_files++;
+        e->opened = open_file_dma(e->name, flags, std::move(options)).then([e] (file f) {
+            e->f = std::move(f);
+        });
+        evict();
+        return wait_opened(std::move(e));
+    } catch (...) {
+        return current_exception_as_future<file>();
+    }
+}
+
+void open_file_cache::invalidate(const sstring& name) noexcept {
+    auto range = _entries.equal_range(name);
+    std::vector<lw_shared_ptr<entry>> invalidated;
+    for (auto it = range.first; it != range.second; ++it) {
+        invalidated.push_back(it->second);
+    }
+    _entries.erase(range.first, range.second);
+    for (auto& e : invalidated) {
+        e->mapped = false;
+        if (e->_lru_link.is_linked()) {
+            _lru.erase(_lru.iterator_to(*e));
+            _gate.enter();
+            close_entry(std::move(e));
+        }
+    }
+}
+
+future<> open_file_cache::remove_file(sstring name) noexcept {
+    invalidate(name);
+    return seastar::remove_file(name);
+}
+
+future<> open_file_cache::rename_file(sstring old_name, sstring new_name) noexcept {
+    invalidate(old_name);
+    invalidate(new_name);
+    return seastar::rename_file(old_name, new_name);
+}
+
+future<> open_file_cache::watch_directory(sstring directory) {
+    if (!_watcher) {
+        _watcher = std::make_unique<watcher>(*this);
+    }
+    return _watcher->add(std::move(directory));
+}
+
+future<> open_file_cache::close() noexcept {
+    _closing = true;
+    auto stopped = _watcher ? _watcher->stop() : make_ready_future<>();
+    return stopped.then([this] {
+        while (!_lru.empty()) {
+            auto& e = _lru.front();
+            _lru.pop_front();
+            unmap(e);
+            _gate.enter();
+            close_entry(e.shared_from_this());
+        }
+        return _gate.close();
+    }).finally([this] {
+        _watcher.reset();
+    });
+}
+
+}
@@ -25,6 +25,7 @@
 #include <sys/syscall.h>
 #include <sys/vfs.h>
 #include <sys/statfs.h>
+#include <sys/sysmacros.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/inotify.h>
@@ -58,6 +59,7 @@
 #include "core/reactor_backend.hh"
 #include "core/syscall_result.hh"
 #include "core/thread_pool.hh"
+#include "net/egress_scheduler.hh"
 #include "syscall_work_queue.hh"
 #include "cgroup.hh"
 #include "uname.hh"
@@ -147,6 +149,7 @@ struct mountpoint_params {
     uint64_t write_req_rate = std::numeric_limits<uint64_t>::max();
     uint64_t read_saturation_length = std::numeric_limits<uint64_t>::max();
     uint64_t write_saturation_length = std::numeric_limits<uint64_t>::max();
+    uint64_t discard_bytes_rate = std::numeric_limits<uint64_t>::max();
 };
 
 }
@@ -167,6 +170,9 @@ struct convert<seastar::mountpoint_params> {
         if (node["write_saturation_length"]) {
             mp.write_saturation_length = parse_memory_size(node["write_saturation_length"].as<std::string>());
         }
+        if (node["discard_bandwidth"]) {
+            mp.discard_bytes_rate = parse_memory_size(node["discard_bandwidth"].as<std::string>());
+        }
         return true;
     }
 };
@@ -239,6 +245,10 @@ future<> reactor::do_connect(pollable_fd_state& pfd, socket_address& sa) {
         if (err != 0) {
             throw std::system_error(err, std::system_category());
         }
+        // A freshly connected socket has room in its send buffer. Saying so
+        // saves a poll for the first write, and is required when polling is
+        // edge-triggered, since the edge was consumed by this wait.
+        pfd.speculate_epoll(EPOLLOUT);
         return make_ready_future<>();
     });
 }
@@ -326,7 +336,7 @@ reactor::do_write_some(pollable_fd_state& fd, net::packet& p) {
         if (!r) {
             return do_write_some(fd, p);
         }
-        if (size_t(*r) == p.len()) {
+        if (size_t(*r) == iovec_len(mh.msg_iov, mh.msg_iovlen)) {
             fd.speculate_epoll(EPOLLOUT);
         }
         return make_ready_future<size_t>(*r);
@@ -861,6 +871,31 @@ reactor::task_queue::register_stats() {
                 return _time_spent_on_task_quota_violations / 1ms;
         }, sm::description("Total amount in milliseconds we were in violation of the task quota"),
            {group_label}),
+        sm::make_gauge("task_quota_ms", [this] {
+                return std::chrono::duration<double, std::milli>(engine().task_quota_for(*this)).count();
+        }, sm::description("Task quota of this group: how long it runs before the reactor preempts it to poll"),
+           {group_label}),
+        sm::make_histogram("preemption_latency_us", [this] {
+            return _preemption_latency.get();
+        }, sm::description("How long this group ran, in microseconds, before it was preempted with tasks still queued"),
+           {group_label}),
+        sm::make_counter("deadlines", _deadlines_completed,
+                sm::description("Count of deadlines registered with this group that have completed"),
+                {group_label}),
+        sm::make_counter("deadline_misses", _deadline_misses,
+                sm::description("Count of deadlines registered with this group that completed after the deadline had passed"),
+                {group_label}),
+        sm::make_gauge("pending_deadlines", [this] { return _deadlines.size(); },
+                sm::description("Number of deadlines currently registered with this group"),
+                {group_label}),
+        sm::make_gauge("memory_allocated_bytes", [this] {
+                return memory::scheduling_group_memory(internal::scheduling_group_from_index(_id)).allocated_memory;
+        }, sm::description("Memory charged to this group: large allocations, and the spans of small-object pools it refilled"),
+           {group_label}),
+        sm::make_counter("memory_soft_limit_exceeded", [this] {
+                return memory::scheduling_group_memory(internal::scheduling_group_from_index(_id)).soft_limit_exceeded;
+        }, sm::description("Number of times this group went over its memory soft limit"),
+           {group_label}),
     });
     _metrics = std::exchange(new_metrics, {});
 }
@@ -892,15 +927,27 @@ reactor::task_queue::set_shares(float shares) noexcept {
     _reciprocal_shares_times_2_power_32 = (uint64_t(1) << 32) / _shares;
 }
 
+void
+reactor::task_queue::account_preemption(sched_clock::duration runtime) noexcept {
+    _preemption_latency.add(std::chrono::duration<double, std::micro>(runtime).count());
+}
+
 void
 reactor::account_runtime(task_queue& tq, sched_clock::duration runtime) {
-    if (runtime > (2 * _task_quota)) {
-        tq._time_spent_on_task_quota_violations += runtime - _task_quota;
+    auto quota = task_quota_for(tq);
+    if (runtime > (2 * quota)) {
+        tq._time_spent_on_task_quota_violations += runtime - quota;
     }
     tq._vruntime += tq.to_vruntime(runtime);
     tq._runtime += runtime;
 }
 
+void
+reactor::arm_task_quota_timer(sched_clock::duration quota) {
+    _armed_task_quota = quota;
+    _task_quota_timer.timerfd_settime(0, seastar::posix::to_relative_itimerspec(quota, quota));
+}
+
 void
 reactor::account_idle(sched_clock::duration runtime) {
     // anything to do here?
@@ -1228,6 +1275,7 @@ void reactor::complete_timers(T& timers, E& expired_timers, EnableFunc&& enable_
         t._expired = true;
     }
     const auto prev_sg = current_scheduling_group();
+    const auto prev_ctx = std::exchange(*internal::current_request_context_ptr(), request_context{});
     while (!expired_timers.empty()) {
         auto t = &*expired_timers.begin();
         expired_timers.pop_front();
@@ -1248,6 +1296,7 @@ void reactor::complete_timers(T& timers, E& expired_timers, EnableFunc&& enable_
     // complete_timers() can be called from the context of run_tasks()
     // as well so we need to restore the previous scheduling group (set by run_tasks()).
     *internal::current_scheduling_group_ptr() = prev_sg;
+    *internal::current_request_context_ptr() = prev_ctx;
     enable_fn();
 }
 
@@ -1340,6 +1389,15 @@ void reactor::configure(boost::program_options::variables_map vm) {
            && !vm.count("poll-mode")) {
         _max_poll_time = 0us;
     }
+    if (vm["respect-cpu-quota"].as<bool>()
+           && vm["idle-poll-time-us"].defaulted()
+           && !vm.count("poll-mode")) {
+        // Busy-polling shards would burn the quota and get throttled
+        auto quota = cgroup::cpu_quota();
+        if (quota && *quota < smp::count) {
+            _max_poll_time = 0us;
+        }
+    }
     set_strict_dma(!vm.count("relaxed-dma"));
     if (!vm["poll-aio"].as<bool>()
             || (vm["poll-aio"].defaulted() && vm.count("overprovisioned"))) {
@@ -1347,9 +1405,15 @@ void reactor::configure(boost::program_options::variables_map vm) {
     }
     set_bypass_fsync(vm["unsafe-bypass-fsync"].as<bool>());
     _kernel_page_cache = vm["kernel-page-cache"].as<bool>();
+    _epoll_edge_triggered = vm["epoll-edge-triggered"].as<bool>();
     _force_io_getevents_syscall = vm["force-aio-syscalls"].as<bool>();
     aio_nowait_supported = vm["linux-aio-nowait"].as<bool>();
     _have_aio_fsync = vm["aio-fsync"].as<bool>();
+    auto egress_bandwidth = vm["network-egress-bandwidth"].as<double>();
+    if (egress_bandwidth > 0) {
+        // Each shard gets an equal share of the link
+        _egress_scheduler = std::make_unique<net::egress_scheduler>(std::max<uint64_t>(egress_bandwidth * (1 << 20) / smp::count, 1));
+    }
 }
 
 pollable_fd
@@ -1511,6 +1575,10 @@ sstring io_request::opname() const {
         return "poll remove";
     case io_request::operation::cancel:
         return "cancel";
+    case io_request::operation::discard:
+        return "discard";
+    case io_request::operation::blkdiscard:
+        return "block device discard";
     }
     std::abort();
 }
@@ -1562,6 +1630,14 @@ const io_priority_class& default_priority_class() {
     return shard_default_class;
 }
 
+const io_priority_class& discard_priority_class() {
+    static thread_local auto shard_discard_class = [] {
+        // The application may have registered its own "discard" class
+        return io_priority_class::register_or_reuse("discard", 1);
+    }();
+    return shard_discard_class;
+}
+
 future<size_t>
 reactor::submit_io_read(io_queue* ioq, const io_priority_class& pc, size_t len, io_request req, io_intent* intent) noexcept {
     ++_io_stats.aio_reads;
@@ -1831,6 +1907,75 @@ reactor::file_stat(std::string_view pathname, follow_symlink follow) noexcept {
     });
 }
 
+static std::chrono::system_clock::time_point
+statx_timestamp_to_time_point(const struct statx_timestamp& ts) {
+    auto d = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            ts.tv_sec * 1s + ts.tv_nsec * 1ns);
+    return std::chrono::system_clock::time_point(d);
+}
+
+static stat_data
+statx_to_stat_data(const struct statx& stx) {
+    stat_data sd;
+    sd.device_id = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    sd.inode_number = stx.stx_ino;
+    sd.mode = stx.stx_mode;
+    sd.type = stat_to_entry_type(stx.stx_mode);
+    sd.number_of_links = stx.stx_nlink;
+    sd.uid = stx.stx_uid;
+    sd.gid = stx.stx_gid;
+    sd.rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+    sd.size = stx.stx_size;
+    sd.block_size = stx.stx_blksize;
+    sd.allocated_size = stx.stx_blocks * 512UL;
+    sd.time_accessed = statx_timestamp_to_time_point(stx.stx_atime);
+    sd.time_modified = statx_timestamp_to_time_point(stx.stx_mtime);
+    sd.time_changed = statx_timestamp_to_time_point(stx.stx_ctime);
+    return sd;
+}
+
+future<std::vector<std::optional<stat_data>>>
+reactor::file_stat_batch(std::vector<sstring> pathnames, follow_symlink follow) noexcept {
+    struct batch {
+        std::vector<sstring> pathnames;
+        std::vector<struct statx> results;
+        std::vector<int> errors;
+    };
+    // Allocating memory for the batch can throw, hence the futurize_invoke
+    return futurize_invoke([this, &pathnames, follow] {
+        auto b = make_lw_shared<batch>();
+        b->results.resize(pathnames.size());
+        b->errors.resize(pathnames.size());
+        b->pathnames = std::move(pathnames);
+        // The whole batch is stat()ed in a single round-trip to the syscall
+        // thread. Everything it touches is allocated up front, since the
+        // syscall thread cannot allocate memory.
+        return _thread_pool->submit<syscall_result<int>>([b, follow] {
+            int flags = AT_STATX_SYNC_AS_STAT | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+            for (size_t i = 0; i < b->pathnames.size(); i++) {
+                auto ret = ::statx(AT_FDCWD, b->pathnames[i].c_str(), flags, STATX_BASIC_STATS, &b->results[i]);
+                b->errors[i] = ret == -1 ? errno : 0;
+            }
+            return wrap_syscall<int>(0);
+        }).then([b] (syscall_result<int>) {
+            std::vector<std::optional<stat_data>> ret;
+            ret.reserve(b->pathnames.size());
+            for (size_t i = 0; i < b->pathnames.size(); i++) {
+                auto error = b->errors[i];
+                if (error == ENOENT || error == ENOTDIR) {
+                    ret.emplace_back();
+                    continue;
+                }
+                if (error) {
+                    syscall_result<int>{-1, error}.throw_fs_exception("statx failed", fs::path(b->pathnames[i]));
+                }
+                ret.emplace_back(statx_to_stat_data(b->results[i]));
+            }
+            return make_ready_future<std::vector<std::optional<stat_data>>>(std::move(ret));
+        });
+    });
+}
+
 future<uint64_t>
 reactor::file_size(std::string_view pathname) noexcept {
     return file_stat(pathname, follow_symlink::yes).then([] (stat_data sd) {
@@ -2007,6 +2152,10 @@ reactor::fdatasync(int fd) noexcept {
 
 // Note: terminate if arm_highres_timer throws
 // `when` should always be valid
+void reactor::cancel_io(io_completion* desc) noexcept {
+    _backend->cancel_io(desc);
+}
+
 void reactor::enable_timer(steady_clock_type::time_point when) noexcept
 {
 #ifndef HAVE_OSV
@@ -2137,6 +2286,25 @@ reactor::tasks_processed() const {
     return _global_tasks_processed;
 }
 
+// The cgroup CPU metrics are read together on each scrape; read the cgroup
+// files at most once a second instead of once per metric per scrape
+struct cgroup_cpu_stats {
+    double quota = 0;
+    cgroup::cpu_throttling_stats throttling;
+};
+
+static const cgroup_cpu_stats& cached_cgroup_cpu_stats() {
+    static thread_local cgroup_cpu_stats stats;
+    static thread_local lowres_clock::time_point expires;
+    auto now = lowres_clock::now();
+    if (now >= expires) {
+        stats.quota = cgroup::cpu_quota().value_or(0);
+        stats.throttling = cgroup::cpu_throttling().value_or(cgroup::cpu_throttling_stats{});
+        expires = now + 1s;
+    }
+    return stats;
+}
+
 void reactor::register_metrics() {
 
     namespace sm = seastar::metrics;
@@ -2161,8 +2329,10 @@ void reactor::register_metrics() {
             sm::make_derive("aio_writes", _io_stats.aio_writes, sm::description("Total aio-writes operations")),
             sm::make_total_bytes("aio_bytes_write", _io_stats.aio_write_bytes, sm::description("Total aio-writes bytes")),
             sm::make_derive("aio_errors", _io_stats.aio_errors, sm::description("Total aio errors")),
+            sm::make_derive("aio_cancels", _io_stats.aio_cancels, sm::description("Total in-flight aio requests successfully cancelled in the kernel")),
             // total_operations value:DERIVE:0:U
             sm::make_derive("fsyncs", _fsyncs, sm::description("Total number of fsync operations")),
+            sm::make_derive("epoll_ctls", _epoll_ctls, sm::description("Total number of epoll_ctl() calls made by the epoll backend")),
             // total_operations value:DERIVE:0:U
             sm::make_derive("io_threaded_fallbacks", std::bind(&thread_pool::operation_count, _thread_pool.get()),
                     sm::description("Total number of io-threaded-fallbacks operations")),
@@ -2178,7 +2348,15 @@ void reactor::register_metrics() {
             sm::make_current_bytes("free_memory", [] { return memory::stats().free_memory(); }, sm::description("Free memeory size in bytes")),
             sm::make_current_bytes("total_memory", [] { return memory::stats().total_memory(); }, sm::description("Total memeory size in bytes")),
             sm::make_current_bytes("allocated_memory", [] { return memory::stats().allocated_memory(); }, sm::description("Allocated memeory size in bytes")),
-            sm::make_derive("reclaims_operations", [] { return memory::stats().reclaims(); }, sm::description("Total reclaims operations"))
+            sm::make_derive("reclaims_operations", [] { return memory::stats().reclaims(); }, sm::description("Total reclaims operations")),
+            sm::make_gauge("fragmentation", [] { return memory::fragmentation().fragmentation; },
+                    sm::description("Fragmentation of free memory: 1 - largest free span / free memory")),
+            sm::make_current_bytes("largest_free_span", [] { return memory::fragmentation().largest_free_span; },
+                    sm::description("Size of the largest contiguous free span in bytes")),
+            sm::make_gauge("remapped_allocations", [] { return memory::fragmentation().remapped_allocations; },
+                    sm::description("Number of live large allocations assembled from scattered free memory")),
+            sm::make_current_bytes("remapped_memory", [] { return memory::fragmentation().remapped_memory; },
+                    sm::description("Memory used by remapped allocations in bytes"))
     });
 
     _metric_groups.add_group("reactor", {
@@ -2188,6 +2366,20 @@ void reactor::register_metrics() {
             sm::make_derive("abandoned_failed_futures", _abandoned_failed_futures, sm::description("Total number of abandoned failed futures, futures destroyed while still containing an exception")),
     });
 
+    if (this_shard_id() == 0 && cgroup::cpu_quota()) {
+        // Throttling is accounted for the whole cgroup, so report it once
+        _metric_groups.add_group("reactor", {
+                sm::make_gauge("cgroup_cpu_quota", [] { return cached_cgroup_cpu_stats().quota; },
+                        sm::description("CPU bandwidth quota of the cgroup, in CPUs")),
+                sm::make_derive("cgroup_cpu_periods", [] { return cached_cgroup_cpu_stats().throttling.nr_periods; },
+                        sm::description("Number of cgroup CPU bandwidth enforcement periods elapsed")),
+                sm::make_derive("cgroup_cpu_throttled_periods", [] { return cached_cgroup_cpu_stats().throttling.nr_throttled; },
+                        sm::description("Number of cgroup CPU bandwidth periods in which the cgroup was throttled")),
+                sm::make_derive("cgroup_cpu_throttled_ms", [] { return cached_cgroup_cpu_stats().throttling.throttled_usec / 1000; },
+                        sm::description("Total time the cgroup was throttled for exceeding its CPU quota, in milliseconds")),
+        });
+    }
+
     using namespace seastar::metrics;
     _metric_groups.add_group("reactor", {
         make_counter("fstream_reads", _io_stats.fstream_reads,
@@ -2226,6 +2418,10 @@ void reactor::run_tasks(task_queue& tq) {
         tasks.pop_front();
         STAP_PROBE(seastar, reactor_run_tasks_single_start);
         task_histogram_add_task(*tsk);
+#ifdef SEASTAR_REQUEST_CONTEXT
+        // New tasks inherit the request context of the task that creates them
+        *internal::current_request_context_ptr() = tsk->context();
+#endif
         _current_task = tsk;
         tsk->run_and_dispose();
         _current_task = nullptr;
@@ -2262,11 +2458,14 @@ void reactor::force_poll() {
 bool
 reactor::flush_tcp_batches() {
     bool work = _flush_batching.size();
+    const auto prev_sg = current_scheduling_group();
     while (!_flush_batching.empty()) {
-        auto os = std::move(_flush_batching.front());
+        auto [os, sg] = _flush_batching.front();
         _flush_batching.pop_front();
+        *internal::current_scheduling_group_ptr() = sg;
         os->poll_flush();
     }
+    *internal::current_scheduling_group_ptr() = prev_sg;
     return work;
 }
 
@@ -2602,9 +2801,30 @@ void reactor::insert_active_task_queue(task_queue* tq) {
     }
 }
 
+size_t reactor::most_urgent_active_task_queue() noexcept {
+    auto& atq = _active_task_queues;
+    size_t best = 0;
+    const task_queue* best_tq = nullptr;
+    for (size_t i = 0; i != atq.size(); ++i) {
+        auto* tq = atq[i];
+        if (!tq->_deadlines.empty() && (!best_tq || *tq->_deadlines.begin() < *best_tq->_deadlines.begin())) {
+            best = i;
+            best_tq = tq;
+        }
+    }
+    // Without deadlines, the queue with the lowest vruntime
+    return best;
+}
+
 reactor::task_queue* reactor::pop_active_task_queue(sched_clock::time_point now) {
-    task_queue* tq = _active_task_queues.front();
-    _active_task_queues.pop_front();
+    auto& atq = _active_task_queues;
+    size_t i = _task_queues_with_deadlines ? most_urgent_active_task_queue() : 0;
+    task_queue* tq = atq[i];
+    // Keep the remaining queues ordered by vruntime
+    for (; i != 0; --i) {
+        atq[i] = atq[i - 1];
+    }
+    atq.pop_front();
     tq->_starvetime += now - tq->_ts;
     return tq;
 }
@@ -2636,6 +2856,12 @@ reactor::run_some_tasks() {
         sched_print("running tq {} {}", (void*)tq, tq->_name);
         tq->_current = true;
         _last_vruntime = std::max(tq->_vruntime, _last_vruntime);
+        auto quota = task_quota_for(*tq);
+        if (quota != _armed_task_quota) {
+            // Only when the quota changes (or the timer was stopped for
+            // sleep); restarts the period, so the group gets its full quota
+            arm_task_quota_timer(quota);
+        }
         run_tasks(*tq);
         tq->_current = false;
         t_run_completed = std::chrono::steady_clock::now();
@@ -2645,6 +2871,7 @@ reactor::run_some_tasks() {
                 (void*)tq, tq->_name, delta / 1us, tq->_vruntime, tq->_q.empty());
         tq->_ts = t_run_completed;
         if (!tq->_q.empty()) {
+            tq->account_preemption(delta);
             insert_active_task_queue(tq);
         } else {
             tq->_active = false;
@@ -2653,6 +2880,7 @@ reactor::run_some_tasks() {
     _cpu_stall_detector->end_task_run(t_run_completed);
     STAP_PROBE(seastar, reactor_run_tasks_end);
     *internal::current_scheduling_group_ptr() = default_scheduling_group(); // Prevent inheritance from last group run
+    *internal::current_request_context_ptr() = {}; // Likewise for the request context of the last task run
     sched_print("run_some_tasks: end");
 }
 
@@ -2726,6 +2954,9 @@ int reactor::run() {
     poller execution_stage_poller(std::make_unique<execution_stage_pollfn>());
 
     start_aio_eventfd_loop();
+    at_exit([this] {
+        return _backend->stop_storage();
+    });
 
     if (_id == 0 && _cfg.auto_handle_sigint_sigterm) {
        if (_handle_sigint) {
@@ -2776,9 +3007,7 @@ int reactor::run() {
     });
     load_timer.arm_periodic(1s);
 
-    itimerspec its = seastar::posix::to_relative_itimerspec(_task_quota, _task_quota);
-    _task_quota_timer.timerfd_settime(0, its);
-    auto& task_quote_itimerspec = its;
+    arm_task_quota_timer(_task_quota);
 
     struct sigaction sa_block_notifier = {};
     sa_block_notifier.sa_handler = &reactor::block_notifier;
@@ -2841,9 +3070,12 @@ int reactor::run() {
             if (go_to_sleep) {
                 internal::cpu_relax();
                 if (idle_end - idle_start > _max_poll_time) {
-                    // Turn off the task quota timer to avoid spurious wakeups
+                    // Turn off the task quota timer to avoid spurious wakeups.
+                    // run_some_tasks() arms it again, with the quota of the
+                    // group it runs first.
                     struct itimerspec zero_itimerspec = {};
                     _task_quota_timer.timerfd_settime(0, zero_itimerspec);
+                    _armed_task_quota = {};
                     auto start_sleep = sched_clock::now();
                     _cpu_stall_detector->start_sleep();
                     sleep();
@@ -2851,7 +3083,6 @@ int reactor::run() {
                     // We may have slept for a while, so freshen idle_end
                     idle_end = sched_clock::now();
                     _total_sleep += idle_end - start_sleep;
-                    _task_quota_timer.timerfd_settime(0, task_quote_itimerspec);
                 }
             } else {
                 // We previously ran pure_check_for_work(), might not actually have performed
@@ -3048,16 +3279,25 @@ unsigned syscall_work_queue::complete() {
 }
 
 
-smp_message_queue::smp_message_queue(reactor* from, reactor* to)
+smp_message_queue::smp_message_queue(reactor* from, reactor* to, bool measure_latency)
     : _pending(to)
+    , _pending_high(to)
     , _completed(from)
+    , _measure_latency(measure_latency)
 {
 }
 
 smp_message_queue::~smp_message_queue()
 {
     if (_pending.remote != _completed.remote) {
-        _tx.a.~aa();
+        if (_tx.a.destroy_batch.empty()) {
+            _tx.a.~aa();
+        } else {
+            // The remote shard is gone and the queued destructors must not
+            // run here, on the wrong shard; leak them, as a message that was
+            // never delivered would have been.
+            _tx.a.pending_fifo.~array();
+        }
     }
 }
 
@@ -3065,16 +3305,18 @@ void smp_message_queue::stop() {
     _metrics.clear();
 }
 
-void smp_message_queue::move_pending() {
-    auto begin = _tx.a.pending_fifo.cbegin();
-    auto end = _tx.a.pending_fifo.cend();
-    end = _pending.push(begin, end);
+void smp_message_queue::move_pending(unsigned lane) {
+    auto& fifo = _tx.a.pending_fifo[lane];
+    auto& q = pending_lane(lane);
+    auto begin = fifo.cbegin();
+    auto end = fifo.cend();
+    end = q.push(begin, end);
     if (begin == end) {
         return;
     }
     auto nr = end - begin;
-    _pending.maybe_wakeup();
-    _tx.a.pending_fifo.erase(begin, end);
+    q.maybe_wakeup();
+    fifo.erase(begin, end);
     _current_queue_length += nr;
     _last_snt_batch = nr;
     _sent += nr;
@@ -3098,12 +3340,18 @@ void smp_message_queue::submit_item(shard_id t, smp_timeout_clock::time_point ti
         ++_last_cmpl_batch;
         return;
     }
-    _tx.a.pending_fifo.push_back(item.get());
+    auto lane = item->lane;
+    auto& fifo = _tx.a.pending_fifo[lane];
+    if (_measure_latency) {
+        item->submitted = std::chrono::steady_clock::now();
+    }
+    fifo.push_back(item.get());
     // no exceptions from this point
     item.release();
     units_fut.get0().release();
-    if (_tx.a.pending_fifo.size() >= batch_size) {
-        move_pending();
+    // Don't hold back high-priority messages to fill a batch
+    if (lane || fifo.size() >= batch_size) {
+        move_pending(lane);
     }
   });
 }
@@ -3135,7 +3383,7 @@ bool smp_message_queue::has_unflushed_responses() const {
 bool smp_message_queue::pure_poll_rx() const {
     // can't use read_available(), not available on older boost
     // empty() is not const, so need const_cast.
-    return !const_cast<lf_queue&>(_pending).empty();
+    return !const_cast<lf_queue&>(_pending).empty() || !const_cast<lf_queue&>(_pending_high).empty();
 }
 
 void
@@ -3186,7 +3434,14 @@ size_t smp_message_queue::process_queue(lf_queue& q, Func process) {
 }
 
 size_t smp_message_queue::process_completions(shard_id t) {
-    auto nr = process_queue<prefetch_cnt*2>(_completed, [t] (work_item* wi) {
+    std::chrono::steady_clock::time_point now;
+    if (_measure_latency) {
+        now = std::chrono::steady_clock::now();
+    }
+    auto nr = process_queue<prefetch_cnt*2>(_completed, [this, t, now] (work_item* wi) {
+        if (_measure_latency) {
+            _lane_stats[wi->lane].latency.add(std::chrono::duration<double, std::micro>(now - wi->submitted).count());
+        }
         wi->complete();
         auto ssg_id = smp_service_group_id(wi->ssg);
         get_smp_service_groups_semaphore(ssg_id, t).signal();
@@ -3200,15 +3455,57 @@ size_t smp_message_queue::process_completions(shard_id t) {
 }
 
 void smp_message_queue::flush_request_batch() {
-    if (!_tx.a.pending_fifo.empty()) {
-        move_pending();
+    for (unsigned lane = nr_lanes; lane-- > 0; ) {
+        if (!_tx.a.pending_fifo[lane].empty()) {
+            move_pending(lane);
+        }
+    }
+}
+
+void smp_message_queue::queue_destroy(shard_id t, noncopyable_function<void ()> destroy) noexcept {
+    try {
+        _tx.a.destroy_batch.push_back(std::move(destroy));
+    } catch (...) {
+        // push_back() left destroy alone. Send what is already batched first
+        // so it still runs after older calls, then send it on its own.
+        flush_destroy_batch(t);
+        (void)submit(t, smp_submit_to_options(), [destroy = std::move(destroy)] () mutable {
+            destroy();
+        });
     }
 }
 
+void smp_message_queue::flush_destroy_batch(shard_id t) {
+    if (_tx.a.destroy_batch.empty()) {
+        return;
+    }
+    // The functions run on the remote shard, but they and the vector are
+    // destroyed here, along with the work item
+    (void)submit(t, smp_submit_to_options(), [batch = std::exchange(_tx.a.destroy_batch, {})] () mutable {
+        for (auto& destroy : batch) {
+            destroy();
+        }
+    });
+}
+
 size_t smp_message_queue::process_incoming() {
-    auto nr = process_queue<prefetch_cnt>(_pending, [] (work_item* wi) {
+    auto process = [] (work_item* wi) {
         wi->process();
+    };
+    // Take a batch from the high-priority lane first, and only one, so that
+    // a flood of high-priority messages can't starve the normal lane.
+    // High-priority items are scheduled urgently so they run ahead of tasks
+    // already queued; urgent tasks go to the front, so push them in reverse
+    // to keep them in the order they were sent.
+    work_item* high[queue_length + 1];
+    size_t nr_high = 0;
+    auto nr = process_queue<prefetch_cnt>(_pending_high, [&] (work_item* wi) {
+        high[nr_high++] = wi;
     });
+    while (nr_high) {
+        high[--nr_high]->process_urgent();
+    }
+    nr += process_queue<prefetch_cnt>(_pending, process);
     _received += nr;
     _last_rcv_batch = nr;
     return nr;
@@ -3233,6 +3530,15 @@ void smp_message_queue::start(unsigned cpuid) {
             // total_operations value:DERIVE:0:U
             sm::make_derive("total_completed_messages", _compl, sm::description("Total number of messages completed"), {sm::shard_label(instance)})(sm::metric_disabled)
     });
+    for (unsigned lane = 0; _measure_latency && lane < nr_lanes; lane++) {
+        auto& stats = _lane_stats[lane];
+        _metrics.add_group("smp", {
+                sm::make_histogram("message_latency_us", [&stats] {
+                    return stats.latency.get();
+                }, sm::description("Round-trip latency of messages sent to another shard, from submission until completion, in microseconds"),
+                   {sm::shard_label(instance), sm::label("lane")(lane ? "high" : "normal")}),
+        });
+    }
 }
 
 readable_eventfd writeable_eventfd::read_side() {
@@ -3263,6 +3569,10 @@ future<size_t> readable_eventfd::wait() {
     return engine().readable(*_fd._s).then([this] {
         uint64_t count;
         int r = ::read(_fd.get_fd(), &count, sizeof(count));
+        if (r == -1 && errno == EAGAIN) {
+            // Readiness cached by an edge-triggered backend can be stale
+            return wait();
+        }
         assert(r == sizeof(count));
         return make_ready_future<size_t>(count);
     });
@@ -3343,6 +3653,9 @@ reactor::get_options_description(reactor_config cfg) {
         ("network-stack", bpo::value<std::string>(),
                 format("select network stack (valid values: {})",
                         format_separated(net_stack_names.begin(), net_stack_names.end(), ", ")).c_str())
+        ("network-egress-bandwidth", bpo::value<double>()->default_value(0),
+                "bandwidth of the outgoing network link in MB/s; when set, writes to connected sockets are paced to it "
+                "and the link is shared between scheduling groups according to their shares (0 to disable)")
         ("poll-mode", "poll continuously (100% cpu use)")
         ("idle-poll-time-us", bpo::value<unsigned>()->default_value(calculate_poll_time() / 1us),
                 "idle polling time in microseconds (reduce for overprovisioned environments or laptops)")
@@ -3372,6 +3685,9 @@ reactor::get_options_description(reactor_config cfg) {
                  " Note that if the seastar_memory logger is set to debug or trace level, the diagnostics will be logged irrespective of this setting.")
         ("reactor-backend", bpo::value<reactor_backend_selector>()->default_value(reactor_backend_selector::default_backend()),
                 format("Internal reactor implementation ({})", reactor_backend_selector::available()).c_str())
+        ("epoll-edge-triggered", bpo::value<bool>()->default_value(false),
+                "With the epoll reactor backend, register each file descriptor once in edge-triggered mode"
+                " and track readiness in userspace, instead of adding and removing interest on every wait")
         ("aio-fsync", bpo::value<bool>()->default_value(kernel_supports_aio_fsync()),
                 "Use Linux aio for fsync() calls. This reduces latency; requires Linux 4.18 or later.")
 #ifdef SEASTAR_HEAPPROF
@@ -3399,7 +3715,9 @@ smp::get_options_description()
         ("reserve-memory", bpo::value<std::string>(), "memory reserved to OS (if --memory not specified)")
         ("hugepages", bpo::value<std::string>(), "path to accessible hugetlbfs mount (typically /dev/hugepages/something)")
         ("lock-memory", bpo::value<bool>(), "lock all memory (prevents swapping)")
+        ("prefault-memory", bpo::value<bool>()->default_value(false), "fault in each shard's memory at startup, in parallel on the shard's own thread (with --lock-memory, also locks it)")
         ("thread-affinity", bpo::value<bool>()->default_value(true), "pin threads to their cpus (disable for overprovisioning)")
+        ("smp-message-latency", bpo::value<bool>()->default_value(false), "measure the round-trip latency of cross-shard messages (the smp_message_latency_us metric); reads the clock twice per message")
 #ifdef SEASTAR_HAVE_HWLOC
         ("num-io-queues", bpo::value<unsigned>(), "Number of IO queues. Each IO unit will be responsible for a fraction of the IO requests. Defaults to the number of threads")
         ("num-io-groups", bpo::value<unsigned>(), "Number of IO groups. Each IO group will be responsible for a fraction of the IO requests. Defaults to the number of NUMA nodes")
@@ -3410,6 +3728,7 @@ smp::get_options_description()
         ("io-properties-file", bpo::value<std::string>(), "path to a YAML file describing the characteristics of the I/O Subsystem")
         ("io-properties", bpo::value<std::string>(), "a YAML string describing the characteristics of the I/O Subsystem")
         ("mbind", bpo::value<bool>()->default_value(true), "enable mbind")
+        ("respect-cpu-quota", bpo::value<bool>()->default_value(true), "if --smp is not given, use no more shards than the cgroup CPU quota (cpu.max or cpu.cfs_quota_us) allows; disable idle polling when the quota is below the number of shards")
 #ifndef SEASTAR_NO_EXCEPTION_HACK
         ("enable-glibc-exception-scaling-workaround", bpo::value<bool>()->default_value(true), "enable workaround for glibc/gcc c++ exception scalablity problem")
 #endif
@@ -3676,6 +3995,9 @@ class disk_config_params {
             if (p.write_saturation_length != std::numeric_limits<uint64_t>::max()) {
                 cfg.disk_write_saturation_length = p.write_saturation_length;
             }
+            if (p.discard_bytes_rate != std::numeric_limits<uint64_t>::max()) {
+                cfg.discard_bytes_rate = per_io_group(p.discard_bytes_rate, nr_groups);
+            }
             cfg.mountpoint = p.mountpoint;
         } else {
             // For backwards compatibility
@@ -3700,8 +4022,58 @@ void smp::register_network_stacks() {
     register_native_stack();
 }
 
+// Runs on each shard's thread, so shards fault in their memory in parallel
+// and the kernel allocates it on the NUMA node the shard's memory is bound to.
+static void prefault_shard_memory() {
+    auto start = std::chrono::steady_clock::now();
+    auto bytes = memory::prefault();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    seastar_logger.info("prefaulted {} MiB of memory in {} ms", bytes >> 20, elapsed.count());
+}
+
+namespace {
+
+// Startup phases run concurrently on all shards; the slowest shard
+// determines how long each one holds up startup.
+class startup_timings {
+public:
+    enum phase { resources, reactor, io_queues, smp_queues, nr_phases };
+    using clock = std::chrono::steady_clock;
+private:
+    clock::time_point _start = clock::now();
+    std::array<std::atomic<clock::rep>, nr_phases> _slowest = {};
+public:
+    template <typename Func>
+    auto time(phase p, Func&& func) {
+        auto start = clock::now();
+        auto record = defer([this, p, start] () noexcept {
+            auto d = (clock::now() - start).count();
+            auto& slowest = _slowest[p];
+            auto cur = slowest.load(std::memory_order_relaxed);
+            while (cur < d && !slowest.compare_exchange_weak(cur, d, std::memory_order_relaxed)) {
+            }
+        });
+        return func();
+    }
+
+    void report() const {
+        auto ms = [] (clock::duration d) {
+            return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(d).count();
+        };
+        auto phase_ms = [&] (phase p) {
+            return ms(clock::duration(_slowest[p].load(std::memory_order_relaxed)));
+        };
+        seastar_logger.info("Started {} shards in {:.1f} ms (resources {:.1f} ms, reactor {:.1f} ms, I/O queues {:.1f} ms, SMP queues {:.1f} ms)",
+                smp::count, ms(clock::now() - _start), phase_ms(resources), phase_ms(reactor), phase_ms(io_queues), phase_ms(smp_queues));
+    }
+};
+
+}
+
 void smp::configure(boost::program_options::variables_map configuration, reactor_config reactor_cfg)
 {
+    startup_timings timings;
+
 #ifndef SEASTAR_NO_EXCEPTION_HACK
     if (configuration["enable-glibc-exception-scaling-workaround"].as<bool>()) {
         init_phdr_cache();
@@ -3785,6 +4157,16 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
         nr_cpus = configuration["smp"].as<unsigned>();
     } else {
         nr_cpus = cpu_set.size();
+        if (configuration["respect-cpu-quota"].as<bool>()) {
+            if (auto quota = cgroup::cpu_quota()) {
+                // Running more shards than the quota allows just gets us throttled
+                auto quota_cpus = std::clamp<unsigned>(std::ceil(*quota), 1, nr_cpus);
+                if (quota_cpus < nr_cpus) {
+                    seastar_logger.info("cgroup CPU quota is {:.2f} CPUs, using {} of {} CPUs", *quota, quota_cpus, nr_cpus);
+                    nr_cpus = quota_cpus;
+                }
+            }
+        }
     }
     smp::count = nr_cpus;
     std::vector<reactor*> reactors(nr_cpus);
@@ -3841,6 +4223,8 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
         }
     }
 
+    auto prefault = configuration["prefault-memory"].as<bool>();
+
     rc.cpus = smp::count;
     rc.cpu_set = std::move(cpu_set);
 
@@ -3857,7 +4241,9 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
     }
 #endif
 
-    auto resources = resource::allocate(rc);
+    auto resources = timings.time(startup_timings::resources, [&] {
+        return resource::allocate(rc);
+    });
     std::vector<resource::cpu> allocations = std::move(resources.cpus);
     if (thread_affinity) {
         smp::pin(allocations[0].cpu_id);
@@ -3937,6 +4323,17 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
         }
     };
 
+    // Each shard constructs the queues it receives on, so that they are
+    // allocated from its own memory and built in parallel.
+    _qs_owner = decltype(smp::_qs_owner){new smp_message_queue* [smp::count], qs_deleter{}};
+    auto measure_latency = configuration["smp-message-latency"].as<bool>();
+    auto construct_smp_queues = [this, &reactors, measure_latency] (shard_id shard) {
+        _qs_owner[shard] = reinterpret_cast<smp_message_queue*>(operator new[] (sizeof(smp_message_queue) * smp::count));
+        for (unsigned j = 0; j < smp::count; ++j) {
+            new (&_qs_owner[shard][j]) smp_message_queue(reactors[j], reactors[shard], measure_latency);
+        }
+    };
+
     _all_event_loops_done.emplace(smp::count);
 
     auto backend_selector = configuration["reactor-backend"].as<reactor_backend_selector>();
@@ -3945,7 +4342,7 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
     auto smp_tmain = smp::_tmain;
     for (i = 1; i < smp::count; i++) {
         auto allocation = allocations[i];
-        create_thread([this, smp_tmain, inited, &reactors_registered, &smp_queues_constructed, configuration, &reactors, hugepages_path, i, allocation, assign_io_queues, alloc_io_queues, thread_affinity, heapprof_enabled, mbind, backend_selector, reactor_cfg] {
+        create_thread([this, smp_tmain, inited, &reactors_registered, &smp_queues_constructed, configuration, &reactors, &timings, hugepages_path, i, allocation, assign_io_queues, alloc_io_queues, construct_smp_queues, thread_affinity, heapprof_enabled, mbind, prefault, backend_selector, reactor_cfg] {
           try {
             // initialize thread_locals that are equal across all reacto threads of this smp instance
             smp::_tmain = smp_tmain;
@@ -3966,10 +4363,20 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
             auto r = ::pthread_sigmask(SIG_BLOCK, &mask, NULL);
             throw_pthread_error(r);
             init_default_smp_service_group(i);
-            allocate_reactor(i, backend_selector, reactor_cfg);
+            timings.time(startup_timings::reactor, [&] {
+                allocate_reactor(i, backend_selector, reactor_cfg);
+            });
             reactors[i] = &engine();
-            alloc_io_queues(i);
+            if (prefault) {
+                prefault_shard_memory();
+            }
+            timings.time(startup_timings::io_queues, [&] {
+                alloc_io_queues(i);
+            });
             reactors_registered.wait();
+            timings.time(startup_timings::smp_queues, [&] {
+                construct_smp_queues(i);
+            });
             smp_queues_constructed.wait();
             // _qs_owner is only initialized here
             _qs = _qs_owner.get();
@@ -3987,14 +4394,21 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
 
     init_default_smp_service_group(0);
     try {
-        allocate_reactor(0, backend_selector, reactor_cfg);
+        timings.time(startup_timings::reactor, [&] {
+            allocate_reactor(0, backend_selector, reactor_cfg);
+        });
     } catch (const std::exception& e) {
         seastar_logger.error(e.what());
         _exit(1);
     }
 
     reactors[0] = &engine();
-    alloc_io_queues(0);
+    if (prefault) {
+        prefault_shard_memory();
+    }
+    timings.time(startup_timings::io_queues, [&] {
+        alloc_io_queues(0);
+    });
 
 #ifdef SEASTAR_HAVE_DPDK
     if (_using_dpdk) {
@@ -4006,14 +4420,10 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
 #endif
 
     reactors_registered.wait();
-    _qs_owner = decltype(smp::_qs_owner){new smp_message_queue* [smp::count], qs_deleter{}};
     _qs = _qs_owner.get();
-    for(unsigned i = 0; i < smp::count; i++) {
-        smp::_qs_owner[i] = reinterpret_cast<smp_message_queue*>(operator new[] (sizeof(smp_message_queue) * smp::count));
-        for (unsigned j = 0; j < smp::count; ++j) {
-            new (&smp::_qs_owner[i][j]) smp_message_queue(reactors[j], reactors[i]);
-        }
-    }
+    timings.time(startup_timings::smp_queues, [&] {
+        construct_smp_queues(0);
+    });
     _alien._qs = alien::instance::create_qs(reactors);
     smp_queues_constructed.wait();
     start_all_queues();
@@ -4023,6 +4433,7 @@ void smp::configure(boost::program_options::variables_map configuration, reactor
     engine().configure(configuration);
     // The raw `new` is necessary because of the private constructor of `lowres_clock_impl`.
     engine()._lowres_clock_impl = std::unique_ptr<lowres_clock_impl>(new lowres_clock_impl);
+    timings.report();
 }
 
 bool smp::poll_queues() {
@@ -4034,6 +4445,7 @@ bool smp::poll_queues() {
             got += rxq.has_unflushed_responses();
             got += rxq.process_incoming();
             auto& txq = _qs[i][this_shard_id()];
+            txq.flush_destroy_batch(i);
             txq.flush_request_batch();
             got += txq.process_completions(i);
         }
@@ -4047,6 +4459,7 @@ bool smp::pure_poll_queues() {
             auto& rxq = _qs[this_shard_id()][i];
             rxq.flush_response_batch();
             auto& txq = _qs[i][this_shard_id()];
+            txq.flush_destroy_batch(i);
             txq.flush_request_batch();
             if (rxq.pure_poll_rx() || txq.pure_poll_tx() || rxq.has_unflushed_responses()) {
                 return true;
@@ -4170,7 +4583,7 @@ future<> later() noexcept {
 }
 
 void add_to_flush_poller(output_stream<char>* os) {
-    engine()._flush_batching.emplace_back(os);
+    engine()._flush_batching.emplace_back(os, current_scheduling_group());
 }
 
 reactor::sched_clock::duration reactor::total_idle_time() {
@@ -4299,6 +4712,7 @@ reactor::destroy_scheduling_group(scheduling_group sg) {
         auto& this_sg = sg_data.per_scheduling_group_data[sg._id];
         this_sg.queue_is_initialized = false;
         _task_queues[sg._id].reset();
+        memory::release_scheduling_group_memory(sg);
     });
 
 }
@@ -4318,6 +4732,44 @@ scheduling_group::set_shares(float shares) noexcept {
     engine()._task_queues[_id]->set_shares(shares);
 }
 
+void
+scheduling_group::set_task_quota(std::chrono::nanoseconds quota) noexcept {
+    engine()._task_queues[_id]->_task_quota = std::chrono::duration_cast<reactor::sched_clock::duration>(quota);
+}
+
+std::chrono::nanoseconds
+scheduling_group::task_quota() const noexcept {
+    auto& r = engine();
+    return r.task_quota_for(*r._task_queues[_id]);
+}
+
+scheduling_deadline::scheduling_deadline(scheduling_group sg, time_point deadline)
+        : _sg(sg) {
+    auto& r = engine();
+    auto& tq = *r._task_queues[internal::scheduling_group_index(sg)];
+    if (tq._deadlines.empty()) {
+        r._task_queues_with_deadlines++;
+    }
+    _it = tq._deadlines.insert(deadline);
+    _engaged = true;
+}
+
+void scheduling_deadline::unregister() noexcept {
+    if (!std::exchange(_engaged, false)) {
+        return;
+    }
+    auto& r = engine();
+    auto& tq = *r._task_queues[internal::scheduling_group_index(_sg)];
+    tq._deadlines_completed++;
+    if (clock_type::now() > *_it) {
+        tq._deadline_misses++;
+    }
+    tq._deadlines.erase(_it);
+    if (tq._deadlines.empty()) {
+        r._task_queues_with_deadlines--;
+    }
+}
+
 future<scheduling_group>
 create_scheduling_group(sstring name, float shares) noexcept {
     auto aid = allocate_scheduling_group_id();
@@ -29,6 +29,10 @@
 #include <chrono>
 #include <sys/poll.h>
 #include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/falloc.h>
+#include <fcntl.h>
 
 #ifdef HAVE_OSV
 #include <osv/newpoll.hh>
@@ -82,6 +86,7 @@ void prepare_iocb(io_request& req, io_completion* desc, iocb& iocb) {
 
 aio_storage_context::iocb_pool::iocb_pool() {
     for (unsigned i = 0; i != max_aio; ++i) {
+        set_user_data(_iocb_pool[i], nullptr);
         _free_iocbs.push(&_iocb_pool[i]);
     }
 }
@@ -109,6 +114,8 @@ aio_storage_context::iocb_pool::get_one() {
 inline
 void
 aio_storage_context::iocb_pool::put_one(internal::linux_abi::iocb* io) {
+    // Free iocbs must not be found by find() below
+    set_user_data(*io, nullptr);
     _free_iocbs.push(io);
 }
 
@@ -124,6 +131,16 @@ aio_storage_context::iocb_pool::has_capacity() const {
     return !_free_iocbs.empty();
 }
 
+internal::linux_abi::iocb*
+aio_storage_context::iocb_pool::find(io_completion* desc) noexcept {
+    for (auto& io : _iocb_pool) {
+        if (get_user_data(io) == desc) {
+            return &io;
+        }
+    }
+    return nullptr;
+}
+
 // Returns: number of iocbs consumed (0 or 1)
 size_t
 aio_storage_context::handle_aio_error(linux_abi::iocb* iocb, int ec) {
@@ -145,6 +162,33 @@ aio_storage_context::handle_aio_error(linux_abi::iocb* iocb, int ec) {
     }
 }
 
+void
+aio_storage_context::submit_discard(internal::io_request& req, io_completion* desc) {
+    // There is no aio command for discards, so run them in the syscall thread.
+    // The io_queue paces them, so there are never many in flight.
+    // The gate makes stop() wait for them, so none completes after the reactor is gone.
+    (void)try_with_gate(_discards, [this, req] {
+        return _r._thread_pool->submit<syscall_result<int>>([req] {
+            if (req.opcode() == io_request::operation::blkdiscard) {
+                uint64_t range[2] { req.pos(), req.size() };
+                return wrap_syscall<int>(::ioctl(req.fd(), BLKDISCARD, &range));
+            }
+            return wrap_syscall<int>(::fallocate(req.fd(), FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, req.pos(), req.size()));
+        });
+    }).then_wrapped([desc, len = req.size()] (future<syscall_result<int>> f) {
+        if (f.failed()) {
+            desc->set_exception(f.get_exception());
+            return;
+        }
+        auto sr = f.get0();
+        desc->complete_with(sr.result == -1 ? -ssize_t(sr.error) : ssize_t(len));
+    });
+}
+
+future<> aio_storage_context::stop() noexcept {
+    return _discards.close();
+}
+
 extern bool aio_nowait_supported;
 
 bool
@@ -152,7 +196,11 @@ aio_storage_context::submit_work() {
     bool did_work = false;
 
     _submission_queue.resize(0);
-    size_t to_submit = _r._io_sink.drain([this] (internal::io_request& req, io_completion* desc) -> bool {
+    size_t drained = _r._io_sink.drain([this] (internal::io_request& req, io_completion* desc) -> bool {
+        if (req.is_discard()) {
+            submit_discard(req, desc);
+            return true;
+        }
         if (!_iocb_pool.has_capacity()) {
             return false;
         }
@@ -166,6 +214,9 @@ aio_storage_context::submit_work() {
         _submission_queue.push_back(&io);
         return true;
     });
+    // Discards were drained, but went to the syscall thread
+    size_t to_submit = _submission_queue.size();
+    did_work = drained != to_submit;
 
     if (__builtin_expect(_r._kernel_page_cache, false)) {
         // linux-aio is not asynchrous when the page cache is used,
@@ -244,6 +295,38 @@ bool aio_storage_context::reap_completions()
     return n;
 }
 
+void aio_storage_context::cancel(io_completion* desc) noexcept {
+    // Cancellation is rare, so a linear scan over the iocbs is fine
+    auto iocb = _iocb_pool.find(desc);
+    if (iocb == nullptr) {
+        // Not an aio request (e.g. a discard running in the syscall thread)
+        return;
+    }
+
+    auto it = std::find(_pending_aio_retry.begin(), _pending_aio_retry.end(), iocb);
+    if (it != _pending_aio_retry.end()) {
+        _pending_aio_retry.erase(it);
+        _iocb_pool.put_one(iocb);
+        ++_r._io_stats.aio_cancels;
+        desc->complete_with(-ECANCELED);
+        return;
+    }
+
+    // Older kernels return the cancelled event right here, newer ones
+    // post it to the ring with -EINPROGRESS returned, and most drivers
+    // don't support cancellation at all and fail with -EINVAL. In the
+    // last case the request just completes normally.
+    linux_abi::io_event ev;
+    auto r = io_cancel(_io_context, iocb, &ev);
+    if (r == 0) {
+        _iocb_pool.put_one(iocb);
+        ++_r._io_stats.aio_cancels;
+        desc->complete_with(ev.res);
+    } else if (errno == EINPROGRESS) {
+        ++_r._io_stats.aio_cancels;
+    }
+}
+
 bool aio_storage_context::can_sleep() const {
     // Because aio depends on polling, it cannot generate events to wake us up, Therefore, sleep
     // is only possible if there are no in-flight aios. If there are, we need to keep polling.
@@ -452,6 +535,14 @@ bool reactor_backend_aio::kernel_submit_work() {
     return did_work;
 }
 
+void reactor_backend_aio::cancel_io(io_completion* desc) noexcept {
+    _storage_context.cancel(desc);
+}
+
+future<> reactor_backend_aio::stop_storage() noexcept {
+    return _storage_context.stop();
+}
+
 bool reactor_backend_aio::kernel_events_can_sleep() const {
     return _storage_context.can_sleep();
 }
@@ -745,6 +836,10 @@ reactor_backend_epoll::wait_and_process(int timeout, const sigset_t* active_sigm
             _steady_clock_timer_deadline = {};
             continue;
         }
+        if (_r._epoll_edge_triggered) {
+            process_edge_triggered_event(*pfd, evt.events);
+            continue;
+        }
         if (evt.events & (EPOLLHUP | EPOLLERR)) {
             // treat the events as required events when error occurs, let
             // send/recv/accept/connect handle the specific error.
@@ -768,11 +863,33 @@ reactor_backend_epoll::wait_and_process(int timeout, const sigset_t* active_sigm
             evt.events = pfd->events_epoll;
             auto op = evt.events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
             ::epoll_ctl(_epollfd.get(), op, pfd->fd.get(), &evt);
+            ++_r._epoll_ctls;
         }
     }
     return nr;
 }
 
+void reactor_backend_epoll::process_edge_triggered_event(pollable_fd_state& pfd, uint32_t revents) {
+    // The fd stays registered for both directions, so an edge may arrive
+    // when nobody waits for it. Remember it in events_known: the next
+    // wait then completes without going through epoll. Consumers only
+    // wait again after they see EAGAIN or a short read/write, so a
+    // readiness we remember is at worst stale, never lost.
+    auto events = revents & (EPOLLIN | EPOLLOUT);
+    if (revents & (EPOLLHUP | EPOLLERR)) {
+        // let send/recv/accept/connect handle the specific error
+        events = EPOLLIN | EPOLLOUT;
+    }
+    auto unclaimed = events & ~pfd.events_requested;
+    if (pfd.events_rw) {
+        complete_epoll_event(pfd, events, EPOLLIN|EPOLLOUT);
+    } else {
+        complete_epoll_event(pfd, events, EPOLLIN);
+        complete_epoll_event(pfd, events, EPOLLOUT);
+    }
+    pfd.events_known |= unclaimed;
+}
+
 class epoll_pollable_fd_state : public pollable_fd_state {
     pollable_fd_state_completion _pollin;
     pollable_fd_state_completion _pollout;
@@ -835,6 +952,14 @@ bool reactor_backend_epoll::complete_hrtimer() {
     return false;
 }
 
+void reactor_backend_epoll::cancel_io(io_completion* desc) noexcept {
+    _storage_context.cancel(desc);
+}
+
+future<> reactor_backend_epoll::stop_storage() noexcept {
+    return _storage_context.stop();
+}
+
 bool reactor_backend_epoll::kernel_events_can_sleep() const {
     return _storage_context.can_sleep();
 }
@@ -868,7 +993,19 @@ future<> reactor_backend_epoll::get_epoll_future(pollable_fd_state& pfd, int eve
     }
     pfd.events_rw = event == (EPOLLIN | EPOLLOUT);
     pfd.events_requested |= event;
-    if ((pfd.events_epoll & event) != event) {
+    if (_r._epoll_edge_triggered) {
+        if (!pfd.events_epoll) {
+            // Registered once, for good; forget() removes it
+            pfd.events_epoll = EPOLLIN | EPOLLOUT;
+            ::epoll_event eevt;
+            eevt.events = EPOLLIN | EPOLLOUT | EPOLLET;
+            eevt.data.ptr = &pfd;
+            int r = ::epoll_ctl(_epollfd.get(), EPOLL_CTL_ADD, pfd.fd.get(), &eevt);
+            assert(r == 0);
+            ++_r._epoll_ctls;
+            _need_epoll_events = true;
+        }
+    } else if ((pfd.events_epoll & event) != event) {
         auto ctl = pfd.events_epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
         pfd.events_epoll |= event;
         ::epoll_event eevt;
@@ -876,6 +1013,7 @@ future<> reactor_backend_epoll::get_epoll_future(pollable_fd_state& pfd, int eve
         eevt.data.ptr = &pfd;
         int r = ::epoll_ctl(_epollfd.get(), ctl, pfd.fd.get(), &eevt);
         assert(r == 0);
+        ++_r._epoll_ctls;
         _need_epoll_events = true;
     }
 
@@ -898,6 +1036,7 @@ future<> reactor_backend_epoll::readable_or_writeable(pollable_fd_state& fd) {
 void reactor_backend_epoll::forget(pollable_fd_state& fd) noexcept {
     if (fd.events_epoll) {
         ::epoll_ctl(_epollfd.get(), EPOLL_CTL_DEL, fd.fd.get(), nullptr);
+        ++_r._epoll_ctls;
     }
     auto* efd = static_cast<epoll_pollable_fd_state*>(&fd);
     delete efd;
@@ -27,6 +27,8 @@
 #include <seastar/core/internal/poll.hh>
 #include <seastar/core/linux-aio.hh>
 #include <seastar/core/cacheline.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/internal/io_request.hh>
 #include <sys/time.h>
 #include <signal.h>
 #include <thread>
@@ -42,6 +44,7 @@
 namespace seastar {
 
 class reactor;
+class io_completion;
 
 // FIXME: merge it with storage context below. At this point the
 // main thing to do is unify the iocb list
@@ -67,6 +70,7 @@ class aio_storage_context {
         void put_one(internal::linux_abi::iocb* io);
         unsigned outstanding() const;
         bool has_capacity() const;
+        internal::linux_abi::iocb* find(io_completion* desc) noexcept;
     };
 
     reactor& _r;
@@ -74,18 +78,25 @@ class aio_storage_context {
     boost::container::static_vector<internal::linux_abi::iocb*, max_aio> _submission_queue;
     iocb_pool _iocb_pool;
     size_t handle_aio_error(internal::linux_abi::iocb* iocb, int ec);
+    void submit_discard(internal::io_request& req, io_completion* desc);
     using pending_aio_retry_t = boost::container::static_vector<internal::linux_abi::iocb*, max_aio>;
     pending_aio_retry_t _pending_aio_retry;
     internal::linux_abi::io_event _ev_buffer[max_aio];
+    // Discards running in the syscall thread
+    gate _discards;
 
 public:
     explicit aio_storage_context(reactor& r);
     ~aio_storage_context();
 
+    // Waits for the discards in flight; later ones fail
+    future<> stop() noexcept;
+
     bool reap_completions();
     void schedule_retry();
     bool submit_work();
     bool can_sleep() const;
+    void cancel(io_completion* desc) noexcept;
 };
 
 class completion_with_iocb {
@@ -171,6 +182,14 @@ class reactor_backend {
     virtual bool kernel_submit_work() = 0;
     virtual bool kernel_events_can_sleep() const = 0;
     virtual void wait_and_process_events(const sigset_t* active_sigmask = nullptr) = 0;
+    // Tries to cancel a request that was already drained from the io_sink.
+    // If successful, the request is completed (possibly later, on reap),
+    // otherwise it is left to complete normally.
+    virtual void cancel_io(io_completion* desc) noexcept {}
+
+    // Waits for storage requests the backend runs outside of the kernel's
+    // completion queues. Called from the reactor's exit tasks.
+    virtual future<> stop_storage() noexcept { return make_ready_future<>(); }
 
     // Methods that allow polling on file descriptors. This will only work on
     // reactor_backend_epoll. Other reactor_backend will probably abort if
@@ -223,6 +242,7 @@ class reactor_backend_epoll : public reactor_backend {
     void task_quota_timer_thread_fn();
     future<> get_epoll_future(pollable_fd_state& fd, int event);
     void complete_epoll_event(pollable_fd_state& fd, int events, int event);
+    void process_edge_triggered_event(pollable_fd_state& fd, uint32_t revents);
     aio_storage_context _storage_context;
     void switch_steady_clock_timers(file_desc& from, file_desc& to);
     void maybe_switch_steady_clock_timers(int timeout, file_desc& from, file_desc& to);
@@ -237,6 +257,8 @@ class reactor_backend_epoll : public reactor_backend {
     virtual bool kernel_submit_work() override;
     virtual bool kernel_events_can_sleep() const override;
     virtual void wait_and_process_events(const sigset_t* active_sigmask) override;
+    virtual void cancel_io(io_completion* desc) noexcept override;
+    virtual future<> stop_storage() noexcept override;
     virtual future<> readable(pollable_fd_state& fd) override;
     virtual future<> writeable(pollable_fd_state& fd) override;
     virtual future<> readable_or_writeable(pollable_fd_state& fd) override;
@@ -284,6 +306,8 @@ class reactor_backend_aio : public reactor_backend {
     virtual bool kernel_submit_work() override;
     virtual bool kernel_events_can_sleep() const override;
     virtual void wait_and_process_events(const sigset_t* active_sigmask) override;
+    virtual void cancel_io(io_completion* desc) noexcept override;
+    virtual future<> stop_storage() noexcept override;
     future<> poll(pollable_fd_state& fd, int events);
     virtual future<> readable(pollable_fd_state& fd) override;
     virtual future<> writeable(pollable_fd_state& fd) override;
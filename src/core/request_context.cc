@@ -0,0 +1,118 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#include <seastar/core/with_request_context.hh>
+#include <seastar/core/circular_buffer.hh>
+#include <seastar/core/smp.hh>
+#include <random>
+
+namespace seastar {
+
+namespace {
+
+struct span_buffer {
+    circular_buffer<span_record> spans;
+    size_t capacity = 4096;
+    uint64_t dropped = 0;
+};
+
+thread_local span_buffer local_span_buffer;
+
+std::mt19937_64 make_id_generator() noexcept {
+    uint64_t seed;
+    try {
+        std::random_device rd;
+        seed = (uint64_t(rd()) << 32) | rd();
+    } catch (...) {
+        seed = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    return std::mt19937_64(seed ^ this_shard_id());
+}
+
+uint64_t new_id() noexcept {
+    static thread_local std::mt19937_64 gen = make_id_generator();
+    uint64_t id;
+    do {
+        id = gen();
+    } while (id == 0);
+    return id;
+}
+
+}
+
+request_context new_request_context() noexcept {
+    return request_context{new_id(), 0};
+}
+
+std::vector<span_record> drain_spans() {
+    auto& buf = local_span_buffer;
+    std::vector<span_record> ret;
+    ret.reserve(buf.spans.size());
+    for (auto& span : buf.spans) {
+        ret.push_back(span);
+    }
+    buf.spans.clear();
+    return ret;
+}
+
+void set_span_buffer_capacity(size_t capacity) noexcept {
+    auto& buf = local_span_buffer;
+    buf.capacity = capacity;
+    while (buf.spans.size() > capacity) {
+        buf.spans.pop_front();
+        buf.dropped++;
+    }
+}
+
+uint64_t dropped_spans() noexcept {
+    return local_span_buffer.dropped;
+}
+
+namespace internal {
+
+uint64_t new_span_id() noexcept {
+    return new_id();
+}
+
+void record_span(span_record span) noexcept {
+    auto& buf = local_span_buffer;
+    span.end = std::chrono::steady_clock::now();
+    span.shard = this_shard_id();
+    if (buf.capacity == 0) {
+        buf.dropped++;
+        return;
+    }
+    if (buf.spans.size() == buf.capacity) {
+        buf.spans.pop_front();
+        buf.dropped++;
+    }
+    try {
+        buf.spans.push_back(span);
+    } catch (...) {
+        buf.dropped++;
+    }
+}
+
+}
+
+}
@@ -23,6 +23,7 @@
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
 #include <regex>
+#include <fstream>
 #include <seastar/core/resource.hh>
 #include <seastar/core/align.hh>
 #include <seastar/core/print.hh>
@@ -118,6 +119,101 @@ size_t memory_limit() {
         .value_or(std::numeric_limits<size_t>::max());
 }
 
+static optional<fs::path> cgroup2_path_my_pid();
+static optional<fs::path> locate_lowest_cgroup2(fs::path lowest_subdir, std::string filename);
+
+// Like read_setting_V1V2_as(), but returns the path of the settings file
+// instead of reading its first line. Missing files are not reported, since
+// the CPU controller is often not enabled at all.
+static optional<fs::path> locate_setting_V1V2(std::string cg1_path, std::string cg2_fname) {
+    static optional<fs::path> cg2_path{cgroup2_path_my_pid()};
+
+    if (cg2_path) {
+        return locate_lowest_cgroup2(*cg2_path, cg2_fname);
+    }
+    auto path = fs::path{"/sys/fs/cgroup"} / cg1_path;
+    if (fs::exists(path)) {
+        return path;
+    }
+    return std::nullopt;
+}
+
+static optional<double> to_cpu_quota(long quota, long period) {
+    if (quota > 0 && period > 0) {
+        return double(quota) / period;
+    }
+    return std::nullopt;
+}
+
+/*
+ * Every cgroup on the way up from ours to the root may cap CPU bandwidth
+ * with its own cpu.max, "$MAX $PERIOD" with $MAX "max" when unlimited.
+ * The tightest one applies.
+ */
+static optional<double> cgroup2_cpu_quota(fs::path dir) {
+    optional<double> ret;
+    do {
+        auto path = dir / "cpu.max";
+        if (fs::exists(path)) {
+            std::vector<std::string> fields;
+            auto line = read_first_line(path);
+            boost::split(fields, line, boost::is_any_of(" "));
+            if (fields.size() != 2) {
+                throw std::runtime_error(format("malformed {}: {}", path.native(), line));
+            }
+            if (fields[0] != "max") {
+                auto quota = to_cpu_quota(boost::lexical_cast<long>(fields[0]), boost::lexical_cast<long>(fields[1]));
+                if (quota && (!ret || *quota < *ret)) {
+                    ret = quota;
+                }
+            }
+        }
+        dir = dir.parent_path();
+    } while (dir.compare("/sys/fs"));
+    return ret;
+}
+
+optional<double> cpu_quota() {
+    try {
+        static optional<fs::path> cg2_path{cgroup2_path_my_pid()};
+        if (cg2_path) {
+            return cgroup2_cpu_quota(*cg2_path);
+        }
+        auto path = fs::path{"/sys/fs/cgroup/cpu/cpu.cfs_quota_us"};
+        if (fs::exists(path)) {
+            return to_cpu_quota(boost::lexical_cast<long>(read_first_line(path)),
+                    boost::lexical_cast<long>(read_first_line(path.parent_path() / "cpu.cfs_period_us")));
+        }
+    } catch (...) {
+        seastar_logger.warn("Unable to parse cgroup's CPU quota. Ignoring: {}", std::current_exception());
+    }
+    return std::nullopt;
+}
+
+optional<cpu_throttling_stats> cpu_throttling() {
+    auto path = locate_setting_V1V2("cpu/cpu.stat", "cpu.stat");
+    if (!path) {
+        return std::nullopt;
+    }
+    std::ifstream in(path->native());
+    cpu_throttling_stats ret;
+    std::string key;
+    uint64_t value;
+    while (in >> key >> value) {
+        if (key == "nr_periods") {
+            ret.nr_periods = value;
+        } else if (key == "nr_throttled") {
+            ret.nr_throttled = value;
+        } else if (key == "throttled_usec") {
+            ret.throttled_usec = value;
+        } else if (key == "throttled_time") {
+            // v1 reports nanoseconds
+            ret.throttled_usec = value / 1000;
+        }
+    }
+    return ret;
+}
+
 template <typename T>
 optional<T> read_setting_as(std::string path) {
     try {
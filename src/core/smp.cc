@@ -32,6 +32,10 @@ void smp_message_queue::work_item::process() {
     schedule(this);
 }
 
+void smp_message_queue::work_item::process_urgent() {
+    schedule_urgent(this);
+}
+
 struct smp_service_group_impl {
     std::vector<smp_service_group_semaphore> clients;   // one client per server shard
 };
@@ -50,6 +50,13 @@ operation_type str2type(const sstring& type) {
     return GET;
 }
 
+sstring type2str(operation_type type) {
+    static const char* names[NUM_OPERATION] = {
+        "GET", "POST", "PUT", "DELETE", "HEAD", "OPTIONS", "TRACE", "CONNECT",
+    };
+    return type < NUM_OPERATION ? names[type] : "UNKNOWN";
+}
+
 }
 
 }
@@ -28,6 +28,14 @@
 #include <seastar/core/shared_ptr.hh>
 #include <seastar/core/app-template.hh>
 #include <seastar/http/exception.hh>
+#include <seastar/http/httpd.hh>
+#include <seastar/http/mime_types.hh>
+#include <seastar/core/align.hh>
+#include <seastar/core/loop.hh>
+#include <boost/algorithm/string/trim.hpp>
+#include <cstdio>
+#include <ctime>
+#include <random>
 
 namespace seastar {
 
@@ -83,11 +91,213 @@ output_stream<char> file_interaction_handler::get_stream(std::unique_ptr<request
     return std::move(s);
 }
 
+// Range bodies are read in chunks of this size. Every read but the first
+// starts at a multiple of it, so dma_read_bulk() never has to read the same
+// disk block twice.
+static constexpr uint64_t range_read_size = 128 * 1024;
+
+// Parses an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT", as produced
+// by http_server::http_date().
+static std::optional<std::time_t> parse_http_date(const sstring& value) {
+    static const char* months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+    char wday[4], month[4];
+    struct tm tm = {};
+    if (std::sscanf(value.c_str(), "%3s, %2d %3s %4d %2d:%2d:%2d GMT", wday, &tm.tm_mday,
+            month, &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 7) {
+        return std::nullopt;
+    }
+    auto m = std::find_if(std::begin(months), std::end(months), [&month] (const char* name) {
+        return ::strcmp(name, month) == 0;
+    });
+    if (m == std::end(months)) {
+        return std::nullopt;
+    }
+    tm.tm_mon = m - std::begin(months);
+    tm.tm_year -= 1900;
+    return ::timegm(&tm);
+}
+
+static std::time_t to_time_t(std::chrono::system_clock::time_point t) {
+    return std::chrono::system_clock::to_time_t(t);
+}
+
+static std::vector<sstring> split_list(const sstring& value) {
+    std::vector<sstring> ret;
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        auto end = std::min(value.find(',', pos), value.size());
+        auto item = boost::algorithm::trim_copy(std::string(value.data() + pos, end - pos));
+        if (!item.empty()) {
+            ret.emplace_back(item);
+        }
+        pos = end + 1;
+    }
+    return ret;
+}
+
+static std::string_view strip_weak(std::string_view etag) {
+    if (etag.size() >= 2 && etag.substr(0, 2) == "W/") {
+        etag.remove_prefix(2);
+    }
+    return etag;
+}
+
+// If-None-Match uses the weak comparison function (RFC 7232, Section 3.2).
+static bool etag_matches_any(const sstring& value, const sstring& etag) {
+    for (auto& tag : split_list(value)) {
+        if (tag == "*" || strip_weak(tag) == strip_weak(etag)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether a GET or HEAD request can be answered with 304 Not Modified.
+// If-Modified-Since is only looked at when If-None-Match is absent.
+static bool not_modified(const request& req, const sstring& etag, std::chrono::system_clock::time_point modified) {
+    if (req._method != "GET" && req._method != "HEAD") {
+        return false;
+    }
+    auto inm = req.get_header("If-None-Match");
+    if (!inm.empty()) {
+        return etag_matches_any(inm, etag);
+    }
+    auto ims = parse_http_date(req.get_header("If-Modified-Since"));
+    return ims && to_time_t(modified) <= *ims;
+}
+
+// Whether the Range header should be honoured: If-Range must hold either
+// the current ETag (strong comparison) or the exact Last-Modified date.
+static bool if_range_matches(const request& req, const sstring& etag, std::chrono::system_clock::time_point modified) {
+    auto value = req.get_header("If-Range");
+    if (value.empty()) {
+        return true;
+    }
+    if (value[0] == '"' || value.find("W/") == 0) {
+        return value == etag;
+    }
+    auto date = parse_http_date(value);
+    return date && *date == to_time_t(modified);
+}
+
+std::optional<std::vector<file_interaction_handler::byte_range>>
+file_interaction_handler::parse_range(const sstring& value, uint64_t size) {
+    static const std::string_view unit = "bytes=";
+    if (value.size() < unit.size() || ::strncasecmp(value.c_str(), unit.data(), unit.size()) != 0) {
+        return std::nullopt;
+    }
+    auto specs = split_list(value.substr(unit.size()));
+    if (specs.empty() || specs.size() > max_ranges) {
+        return std::nullopt;
+    }
+    std::vector<byte_range> ret;
+    for (auto& spec : specs) {
+        auto dash = spec.find('-');
+        if (dash == sstring::npos) {
+            return std::nullopt;
+        }
+        auto first_str = spec.substr(0, dash);
+        auto last_str = spec.substr(dash + 1);
+        auto is_number = [] (const sstring& s) {
+            return !s.empty() && s.size() <= 19 && std::all_of(s.begin(), s.end(), ::isdigit);
+        };
+        if (first_str.empty()) {
+            // suffix range: the last N bytes
+            if (!is_number(last_str)) {
+                return std::nullopt;
+            }
+            uint64_t n = std::stoull(last_str);
+            if (n && size) {
+                ret.push_back({size - std::min(n, size), size - 1});
+            }
+            continue;
+        }
+        if (!is_number(first_str) || (!last_str.empty() && !is_number(last_str))) {
+            return std::nullopt;
+        }
+        uint64_t first = std::stoull(first_str);
+        uint64_t last = last_str.empty() ? std::numeric_limits<uint64_t>::max() : std::stoull(last_str);
+        if (last < first) {
+            return std::nullopt;
+        }
+        if (first < size) {
+            ret.push_back({first, std::min(last, size - 1)});
+        }
+    }
+    return ret;
+}
+
+future<file_interaction_handler::validators> file_interaction_handler::get_validators(const sstring& file_name) {
+    auto now = lowres_clock::now();
+    auto i = _validators.find(file_name);
+    if (i != _validators.end() && now < i->second.expires) {
+        return make_ready_future<validators>(i->second);
+    }
+    return file_stat(file_name).then_wrapped([this, file_name, now] (future<stat_data> f) {
+        stat_data sd;
+        try {
+            sd = f.get0();
+        } catch (const std::system_error& e) {
+            if (e.code().value() == ENOENT || e.code().value() == ENOTDIR) {
+                _validators.erase(file_name);
+                throw not_found_exception();
+            }
+            throw;
+        }
+        auto mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(sd.time_modified.time_since_epoch()).count();
+        validators v{sd.size, sd.time_modified,
+                format("\"{:x}-{:x}-{:x}\"", sd.inode_number, sd.size, mtime_ns),
+                http_server::http_date(to_time_t(sd.time_modified)),
+                now + validators_ttl};
+        if (_validators.size() >= max_cached_validators) {
+            _validators.clear();
+        }
+        _validators.insert_or_assign(file_name, v);
+        return v;
+    });
+}
+
 future<std::unique_ptr<reply>> file_interaction_handler::read(
         sstring file_name, std::unique_ptr<request> req,
         std::unique_ptr<reply> rep) {
     sstring extension = get_extension(file_name);
-    rep->write_body(extension, [req = std::move(req), extension, file_name, this] (output_stream<char>&& s) mutable {
+    if (transformer) {
+        // A transformer may change the content, so the file's validators and
+        // offsets do not describe the reply.
+        read_file(file_name, extension, std::move(req), *rep);
+        return make_ready_future<std::unique_ptr<reply>>(std::move(rep));
+    }
+    return get_validators(file_name).then([this, file_name, extension, req = std::move(req), rep = std::move(rep)] (validators v) mutable {
+        rep->add_header("ETag", v.etag);
+        rep->add_header("Last-Modified", v.last_modified);
+        rep->add_header("Accept-Ranges", "bytes");
+        if (not_modified(*req, v.etag, v.modified)) {
+            rep->set_status(reply::status_type::not_modified).done();
+            return make_ready_future<std::unique_ptr<reply>>(std::move(rep));
+        }
+        auto range = req->get_header("Range");
+        if (!range.empty() && req->_method == "GET" && if_range_matches(*req, v.etag, v.modified)) {
+            if (auto ranges = parse_range(range, v.size)) {
+                if (ranges->empty()) {
+                    rep->add_header("Content-Range", format("bytes */{}", v.size));
+                    rep->set_status(reply::status_type::range_not_satisfiable).done();
+                } else {
+                    read_ranges(file_name, extension, std::move(*ranges), v.size, *rep);
+                }
+                return make_ready_future<std::unique_ptr<reply>>(std::move(rep));
+            }
+        }
+        read_file(file_name, extension, std::move(req), *rep);
+        return make_ready_future<std::unique_ptr<reply>>(std::move(rep));
+    });
+}
+
+void file_interaction_handler::read_file(const sstring& file_name, const sstring& extension,
+        std::unique_ptr<request> req, reply& rep) {
+    rep.write_body(extension, [req = std::move(req), extension, file_name, this] (output_stream<char>&& s) mutable {
         return do_with(output_stream<char>(get_stream(std::move(req), extension, std::move(s))),
                 [file_name] (output_stream<char>& os) {
             return open_file_dma(file_name, open_flags::ro).then([&os] (file f) {
@@ -101,7 +311,62 @@ future<std::unique_ptr<reply>> file_interaction_handler::read(
             });
         });
     });
-    return make_ready_future<std::unique_ptr<reply>>(std::move(rep));
+}
+
+static future<> write_range(file& f, output_stream<char>& os, uint64_t first, uint64_t last) {
+    return do_with(first, [&f, &os, last] (uint64_t& pos) {
+        return do_until([&pos, last] { return pos > last; }, [&f, &os, &pos, last] {
+            auto end = std::min(last + 1, align_down(pos + range_read_size, range_read_size));
+            return f.dma_read_bulk<char>(pos, end - pos).then([&os, &pos] (temporary_buffer<char> buf) {
+                if (buf.empty()) {
+                    // The file was truncated after its size was sampled.
+                    return make_exception_future<>(std::runtime_error("unexpected end of file"));
+                }
+                pos += buf.size();
+                return os.write(std::move(buf));
+            });
+        });
+    });
+}
+
+void file_interaction_handler::read_ranges(const sstring& file_name, const sstring& extension,
+        std::vector<byte_range> ranges, uint64_t size, reply& rep) {
+    rep.set_status(reply::status_type::partial_content);
+    sstring boundary;
+    if (ranges.size() == 1) {
+        rep.add_header("Content-Range", format("bytes {}-{}/{}", ranges[0].first, ranges[0].last, size));
+    } else {
+        static thread_local std::mt19937_64 random_engine{std::random_device{}()};
+        boundary = format("{:016x}", random_engine());
+    }
+    rep.write_body(extension, [file_name, ranges = std::move(ranges), boundary, size,
+            mime = sstring(mime_types::extension_to_type(extension))] (output_stream<char>&& s) mutable {
+        return do_with(std::move(s), std::move(ranges), [file_name, boundary, size, mime] (output_stream<char>& os, std::vector<byte_range>& ranges) {
+            return open_file_dma(file_name, open_flags::ro).then([&os, &ranges, boundary, size, mime] (file f) {
+                return do_with(std::move(f), [&os, &ranges, boundary, size, mime] (file& f) {
+                    return do_for_each(ranges, [&f, &os, boundary, size, mime] (const byte_range& r) {
+                        if (boundary.empty()) {
+                            return write_range(f, os, r.first, r.last);
+                        }
+                        auto part_header = format("\r\n--{}\r\nContent-Type: {}\r\nContent-Range: bytes {}-{}/{}\r\n\r\n",
+                                boundary, mime, r.first, r.last, size);
+                        return os.write(part_header).then([&f, &os, r] {
+                            return write_range(f, os, r.first, r.last);
+                        });
+                    }).then([&os, boundary] {
+                        return boundary.empty() ? make_ready_future<>() : os.write(format("\r\n--{}--\r\n", boundary));
+                    }).finally([&f] {
+                        return f.close();
+                    });
+                });
+            }).finally([&os] {
+                return os.close();
+            });
+        });
+    });
+    if (!boundary.empty()) {
+        rep.set_mime_type("multipart/byteranges; boundary=" + boundary);
+    }
 }
 
 bool file_interaction_handler::redirect_if_needed(const request& req,
@@ -59,7 +59,8 @@ http_stats::http_stats(http_server& server, const sstring& name)
             sm::make_gauge("connections_current", [&server] { return server.current_connections(); }, sm::description("The current number of open  connections"), labels),
             sm::make_derive("read_errors", [&server] { return server.read_errors(); }, sm::description("The total number of errors while reading http requests"), labels),
             sm::make_derive("reply_errors", [&server] { return server.reply_errors(); }, sm::description("The total number of errors while replying to http"), labels),
-            sm::make_derive("requests_served", [&server] { return server.requests_served(); }, sm::description("The total number of http requests served"), labels)
+            sm::make_derive("requests_served", [&server] { return server.requests_served(); }, sm::description("The total number of http requests served"), labels),
+            sm::make_histogram("request_arrival_latency_us", [&server] { return server.arrival_latency().get(); }, sm::description("Delay between the arrival of a request in the kernel and its dispatch, in microseconds; only measured with receive timestamps enabled"), labels)
     });
 }
 
@@ -121,8 +122,12 @@ future<> connection::start_response() {
         });
     }
     set_headers(*_resp);
-    _resp->_headers["Content-Length"] = to_sstring(
-            _resp->_content.size());
+    // A 304 has no body; a Content-Length would describe the representation
+    // it stands for, so leave it out rather than send a misleading 0
+    if (_resp->_status != reply::status_type::not_modified) {
+        _resp->_headers["Content-Length"] = to_sstring(
+                _resp->_content.size());
+    }
     return _write_buf.write(_resp->_response_line.data(),
             _resp->_response_line.size()).then([this] {
         return _resp->write_reply_headers(*this);
@@ -168,6 +173,13 @@ void connection::on_new_connection() {
     ++_server._total_connections;
     ++_server._current_connections;
     _server._connections.push_back(*this);
+    _tcp_info = _server._tcp_info_sampler.track(_fd);
+}
+
+connected_socket_input_stream_config connection::input_config(const http_server& server) noexcept {
+    connected_socket_input_stream_config csisc;
+    csisc.receive_timestamps = server._receive_timestamps;
+    return csisc;
 }
 
 future<> connection::read() {
@@ -228,6 +240,10 @@ future<> connection::read_one() {
         }
         ++_server._requests_served;
         std::unique_ptr<httpd::request> req = _parser.get_parsed_request();
+        req->arrival_time = _read_buf.receive_timestamp();
+        if (req->arrival_time) {
+            _server._arrival_latency.add(*req->arrival_time);
+        }
         if (_server._credentials) {
             req->protocol_name = "https";
         }
@@ -477,6 +493,14 @@ void http_server::set_content_streaming(bool b) {
     _content_streaming = b;
 }
 
+bool http_server::get_receive_timestamps() const {
+    return _receive_timestamps;
+}
+
+void http_server::set_receive_timestamps(bool b) {
+    _receive_timestamps = b;
+}
+
 future<> http_server::listen(socket_address addr, listen_options lo) {
     if (_credentials) {
         _listeners.push_back(seastar::tls::listen(_credentials, addr, lo));
@@ -552,7 +576,10 @@ uint64_t http_server::reply_errors() const {
 // RFC 7231, Section 7.1.1.1, a.k.a. IMF (Internet Message Format) fixdate.
 // For example: Sun, 06 Nov 1994 08:49:37 GMT
 sstring http_server::http_date() {
-    auto t = ::time(nullptr);
+    return http_date(::time(nullptr));
+}
+
+sstring http_server::http_date(std::time_t t) {
     struct tm tm;
     gmtime_r(&t, &tm);
     // Using strftime() would have been easier, but unfortunately relies on
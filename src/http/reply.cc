@@ -47,6 +47,7 @@ const sstring accepted = " 202 Accepted\r\n";
 const sstring nonauthoritative_information = " 203 Non-Authoritative Information\r\n";
 const sstring no_content = " 204 No Content\r\n";
 const sstring reset_content = " 205 Reset Content\r\n";
+const sstring partial_content = " 206 Partial Content\r\n";
 const sstring multiple_choices = " 300 Multiple Choices\r\n";
 const sstring moved_permanently = " 301 Moved Permanently\r\n";
 const sstring moved_temporarily = " 302 Moved Temporarily\r\n";
@@ -68,6 +69,7 @@ const sstring length_required = " 411 Length Required\r\n";
 const sstring payload_too_large = " 413 Payload Too Large\r\n";
 const sstring uri_too_long = " 414 URI Too Long\r\n";
 const sstring unsupported_media_type = " 415 Unsupported Media Type\r\n";
+const sstring range_not_satisfiable = " 416 Range Not Satisfiable\r\n";
 const sstring expectation_failed = " 417 Expectation Failed\r\n";
 const sstring unprocessable_entity = " 422 Unprocessable Entity\r\n";
 const sstring upgrade_required = " 426 Upgrade Required\r\n";
@@ -97,6 +99,8 @@ static const sstring& to_string(reply::status_type status) {
         return no_content;
     case reply::status_type::reset_content:
         return reset_content;
+    case reply::status_type::partial_content:
+        return partial_content;
     case reply::status_type::multiple_choices:
         return multiple_choices;
     case reply::status_type::moved_permanently:
@@ -139,6 +143,8 @@ static const sstring& to_string(reply::status_type status) {
         return uri_too_long;
     case reply::status_type::unsupported_media_type:
         return unsupported_media_type;
+    case reply::status_type::range_not_satisfiable:
+        return range_not_satisfiable;
     case reply::status_type::expectation_failed:
         return expectation_failed;
     case reply::status_type::unprocessable_entity:
@@ -24,6 +24,7 @@
 #include <seastar/http/request.hh>
 #include <seastar/http/exception.hh>
 #include <seastar/http/json_path.hh>
+#include <seastar/core/metrics.hh>
 
 namespace seastar {
 
@@ -31,6 +32,41 @@ namespace httpd {
 
 using namespace std;
 
+route_stats::route_stats(const sstring& service, const sstring& method, const sstring& route) {
+    namespace sm = seastar::metrics;
+    std::vector<sm::label_instance> labels{
+        sm::label_instance("service", service),
+        sm::label_instance("method", method),
+        sm::label_instance("route", route),
+    };
+    _metrics.add_group("httpd", {
+        sm::make_histogram("route_latency_us", [this] { return _latency.get(); },
+                sm::description("Time to produce the replies of this route, in microseconds"), labels),
+        sm::make_histogram("route_request_bytes", [this] { return _request_size.get(); },
+                sm::description("Content length of the requests of this route"), labels),
+        sm::make_histogram("route_response_bytes", [this] { return _response_size.get(); },
+                sm::description("Content length of the replies of this route, not counting streamed bodies"), labels),
+    });
+    for (unsigned i = 0; i < _replies.size(); i++) {
+        auto status_labels = labels;
+        status_labels.push_back(sm::label_instance("status", format("{}xx", i + 1)));
+        _metrics.add_group("httpd", {
+            sm::make_counter("route_replies", _replies[i],
+                    sm::description("Replies of this route, by status class"), status_labels),
+        });
+    }
+}
+
+void route_stats::account(std::chrono::steady_clock::duration latency, size_t request_size, const reply& rep) noexcept {
+    _latency.add(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    _request_size.add(request_size);
+    _response_size.add(rep._content.size());
+    auto status_class = static_cast<unsigned>(rep._status) / 100;
+    if (status_class >= 1 && status_class <= _replies.size()) {
+        _replies[status_class - 1]++;
+    }
+}
+
 void verify_param(const request& req, const sstring& param) {
     if (req.get_query_param(param) == "") {
         throw missing_param_exception(param);
@@ -82,15 +118,25 @@ std::unique_ptr<reply> routes::exception_reply(std::exception_ptr eptr) {
 }
 
 future<std::unique_ptr<reply> > routes::handle(const sstring& path, std::unique_ptr<request> req, std::unique_ptr<reply> rep) {
-    handler_base* handler = get_handler(str2type(req->_method),
-            normalize_url(path), req->param);
+    route_stats* stats = nullptr;
+    handler_base* handler = find_handler(str2type(req->_method),
+            normalize_url(path), req->param, stats);
     if (handler != nullptr) {
+        auto start = std::chrono::steady_clock::now();
+        auto request_size = req->content_length;
         try {
             for (auto& i : handler->_mandatory_param) {
                 verify_param(*req.get(), i);
             }
             auto r =  handler->handle(path, std::move(req), std::move(rep));
-            return r.handle_exception(_general_handler);
+            if (!stats) {
+                return r.handle_exception(_general_handler);
+            }
+            return r.then_wrapped([this, stats, start, request_size] (future<std::unique_ptr<reply>> f) {
+                auto rep = f.failed() ? _general_handler(f.get_exception()) : f.get0();
+                stats->account(std::chrono::steady_clock::now() - start, request_size, *rep);
+                return rep;
+            });
         } catch (const redirect_exception& _e) {
             rep.reset(new reply());
             rep->add_header("Location", _e.url).set_status(_e.status()).done(
@@ -98,6 +144,9 @@ future<std::unique_ptr<reply> > routes::handle(const sstring& path, std::unique_
         } catch (...) {
             rep = exception_reply(std::current_exception());
         }
+        if (stats) {
+            stats->account(std::chrono::steady_clock::now() - start, request_size, *rep);
+        }
     } else {
         rep.reset(new reply());
         json_exception ex(not_found_exception("Not found"));
@@ -116,18 +165,27 @@ sstring routes::normalize_url(const sstring& url) {
 
 handler_base* routes::get_handler(operation_type type, const sstring& url,
         parameters& params) {
+    route_stats* stats;
+    return find_handler(type, url, params, stats);
+}
+
+handler_base* routes::find_handler(operation_type type, const sstring& url,
+        parameters& params, route_stats*& stats) {
     handler_base* handler = get_exact_match(type, url);
     if (handler != nullptr) {
+        stats = _metrics_service ? _map_stats[type][url] : nullptr;
         return handler;
     }
 
     for (auto&& rule : _rules[type]) {
         handler = rule.second->get(url, params);
         if (handler != nullptr) {
+            stats = _metrics_service ? _rule_stats[type][rule.first] : nullptr;
             return handler;
         }
         params.clear();
     }
+    stats = _default_stats;
     return _default_handler;
 }
 
@@ -142,10 +200,65 @@ routes& routes::add(operation_type type, const url& url,
 }
 
 routes& routes::add_default_handler(handler_base* handler) {
+    if (_default_stats) {
+        release_route_stats("any", "/*");
+        _default_stats = nullptr;
+    }
     _default_handler = handler;
+    if (handler) {
+        _default_stats = acquire_route_stats("any", "/*");
+    }
     return *this;
 }
 
+route_stats* routes::acquire_route_stats(const sstring& method, const sstring& route) {
+    if (!_metrics_service) {
+        return nullptr;
+    }
+    auto& e = _route_stats[std::make_pair(method, route)];
+    if (!e.stats) {
+        try {
+            e.stats = std::make_unique<route_stats>(*_metrics_service, method, route);
+        } catch (...) {
+            _route_stats.erase(std::make_pair(method, route));
+            throw;
+        }
+    }
+    e.refs++;
+    return e.stats.get();
+}
+
+void routes::release_route_stats(const sstring& method, const sstring& route) {
+    auto i = _route_stats.find(std::make_pair(method, route));
+    if (i != _route_stats.end() && --i->second.refs == 0) {
+        _route_stats.erase(i);
+    }
+}
+
+const route_stats* routes::get_route_stats(const sstring& method, const sstring& route) const {
+    auto i = _route_stats.find(std::make_pair(method, route));
+    return i == _route_stats.end() ? nullptr : i->second.stats.get();
+}
+
+void routes::enable_metrics(const sstring& service) {
+    if (_metrics_service) {
+        return;
+    }
+    _metrics_service = service;
+    for (int i = 0; i < NUM_OPERATION; i++) {
+        auto method = type2str(static_cast<operation_type>(i));
+        for (auto& kv : _map[i]) {
+            _map_stats[i][kv.first] = acquire_route_stats(method, kv.first);
+        }
+        for (auto& r : _rules[i]) {
+            _rule_stats[i][r.first] = acquire_route_stats(method, r.second->pattern());
+        }
+    }
+    if (_default_handler) {
+        _default_stats = acquire_route_stats("any", "/*");
+    }
+}
+
 template <typename Map, typename Key>
 static auto delete_rule_from(operation_type type, Key& key, Map& map) {
     auto& bucket = map[type];
@@ -160,7 +273,11 @@ static auto delete_rule_from(operation_type type, Key& key, Map& map) {
 }
 
 handler_base* routes::drop(operation_type type, const sstring& url) {
-    return delete_rule_from(type, url, _map);
+    auto handler = delete_rule_from(type, url, _map);
+    if (handler && _map_stats[type].erase(url)) {
+        release_route_stats(type2str(type), url);
+    }
+    return handler;
 }
 
 routes& routes::put(operation_type type, const sstring& url, handler_base* handler) {
@@ -168,11 +285,33 @@ routes& routes::put(operation_type type, const sstring& url, handler_base* handl
     if (it.second == false) {
         throw std::runtime_error(format("Handler for {} already exists.", url));
     }
+    if (_metrics_service) {
+        try {
+            _map_stats[type][url] = acquire_route_stats(type2str(type), url);
+        } catch (...) {
+            _map[type].erase(it.first);
+            throw;
+        }
+    }
     return *this;
 }
 
+routes::rule_cookie routes::add_cookie(match_rule* rule, operation_type type) {
+    if (_metrics_service) {
+        auto stats = acquire_route_stats(type2str(type), rule->pattern());
+        _rule_stats[type][_rover] = stats;
+    }
+    auto pos = _rover++;
+    _rules[type][pos] = rule;
+    return pos;
+}
+
 match_rule* routes::del_cookie(rule_cookie cookie, operation_type type) {
-    return delete_rule_from(type, cookie, _rules);
+    auto rule = delete_rule_from(type, cookie, _rules);
+    if (rule && _rule_stats[type].erase(cookie)) {
+        release_route_stats(type2str(type), rule->pattern());
+    }
+    return rule;
 }
 
 void routes::add_alias(const path_description& old_path, const path_description& new_path) {
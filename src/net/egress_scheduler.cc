@@ -0,0 +1,200 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#include "net/egress_scheduler.hh"
+#include <seastar/core/reactor.hh>
+#include <seastar/core/metrics.hh>
+#include <seastar/net/packet.hh>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace seastar {
+
+namespace net {
+
+// Lets up to 1ms worth of the link (and no less than 64k) be admitted at once
+static uint64_t burst_bytes(uint64_t bandwidth) noexcept {
+    return std::clamp<uint64_t>(bandwidth / 1000, 64 << 10, std::numeric_limits<int32_t>::max());
+}
+
+static fair_queue::config make_fair_queue_config(uint64_t bandwidth) noexcept {
+    fair_queue::config cfg;
+    cfg.ticket_size_pace = 1e6 / bandwidth;
+    cfg.ticket_weight_pace = 0;
+    return cfg;
+}
+
+egress_scheduler::egress_scheduler(uint64_t bandwidth)
+        : _bandwidth(bandwidth)
+        , _burst(burst_bytes(bandwidth))
+        , _group(fair_group::config(1 << 20, _burst))
+        , _fq(_group, make_fair_queue_config(bandwidth))
+        , _link_free_at(clock_type::now())
+        , _release_timer([this] { release(); })
+{
+}
+
+egress_scheduler::~egress_scheduler() = default;
+
+egress_scheduler::group_class& egress_scheduler::get_class(scheduling_group sg) {
+    auto id = internal::scheduling_group_index(sg);
+    auto shares = std::max(1u, unsigned(engine()._task_queues[id]->_shares));
+    auto& c = _classes[id];
+    if (c) {
+        c->pclass->update_shares(shares);
+        return *c;
+    }
+
+    auto nc = std::make_unique<group_class>();
+    nc->pclass = _fq.register_priority_class(shares);
+    namespace sm = seastar::metrics;
+    auto group_label = sm::label("group")(sg.name());
+    auto& stats = *nc;
+    nc->metrics.add_group("network_egress", {
+        sm::make_counter("bytes", stats.bytes,
+                sm::description("Bytes admitted to connected sockets for this scheduling group"), {group_label}),
+        sm::make_counter("writes", stats.writes,
+                sm::description("Writes admitted to connected sockets for this scheduling group"), {group_label}),
+        sm::make_gauge("queue_length", stats.queued,
+                sm::description("Writes of this scheduling group waiting for their share of the link"), {group_label}),
+        sm::make_counter("queue_time_ms", [&stats] {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(stats.queue_time).count();
+        }, sm::description("Accumulated time writes of this scheduling group spent waiting for their share of the link"), {group_label}),
+    });
+    c = std::move(nc);
+    return *c;
+}
+
+future<> egress_scheduler::admit(size_t bytes, scheduling_group sg) noexcept {
+    if (!bytes) {
+        return make_ready_future<>();
+    }
+    try {
+        if (!engine()._task_queues[internal::scheduling_group_index(sg)]) {
+            // The group that buffered the data was destroyed since
+            sg = default_scheduling_group();
+        }
+        auto id = internal::scheduling_group_index(sg);
+        auto& c = get_class(sg);
+        // Requests larger than the burst are charged as a whole burst, so
+        // that they can get through at all; the virtual link still accounts
+        // their full size
+        auto r = std::make_unique<request>(fair_queue_ticket(1, std::min<uint64_t>(bytes, _burst)), bytes, id);
+        auto f = r->pr.get_future();
+        _fq.queue(c.pclass, *r);
+        r.release();
+        c.queued++;
+        dispatch();
+        return f;
+    } catch (...) {
+        return current_exception_as_future();
+    }
+}
+
+uint64_t egress_scheduler::admitted_bytes(scheduling_group sg) const noexcept {
+    auto& c = _classes[internal::scheduling_group_index(sg)];
+    return c ? c->bytes : 0;
+}
+
+void egress_scheduler::dispatch() {
+    _fq.dispatch_requests([this] (fair_queue_entry& fqe) {
+        std::unique_ptr<request> r(static_cast<request*>(&fqe));
+        auto now = clock_type::now();
+        auto& c = *_classes[r->group];
+        c.queued--;
+        c.writes++;
+        c.bytes += r->bytes;
+        c.queue_time += now - r->queued_at;
+        auto busy = std::chrono::duration<double>(double(r->bytes) / _bandwidth);
+        _link_free_at = std::max(now, _link_free_at) + std::chrono::duration_cast<clock_type::duration>(busy);
+        _in_flight.push_back(in_flight{_link_free_at, r->ticket()});
+        if (!_release_timer.armed()) {
+            _release_timer.arm(_in_flight.front().release_at);
+        }
+        r->pr.set_value();
+    });
+}
+
+void egress_scheduler::release() {
+    release(clock_type::now());
+}
+
+void egress_scheduler::release(clock_type::time_point until) {
+    while (!_in_flight.empty() && _in_flight.front().release_at <= until) {
+        _fq.notify_requests_finished(_in_flight.front().ticket);
+        _in_flight.pop_front();
+    }
+    if (!_in_flight.empty()) {
+        _release_timer.rearm(_in_flight.front().release_at);
+    }
+    dispatch();
+}
+
+class metered_data_sink_impl final : public data_sink_impl {
+    data_sink _sink;
+    egress_scheduler& _sched;
+public:
+    metered_data_sink_impl(data_sink sink, egress_scheduler& sched) noexcept
+        : _sink(std::move(sink)), _sched(sched) {}
+    virtual temporary_buffer<char> allocate_buffer(size_t size) override {
+        return _sink.allocate_buffer(size);
+    }
+    virtual future<> put(packet p) override {
+        auto len = p.len();
+        return _sched.admit(len).then([this, p = std::move(p)] () mutable {
+            return _sink.put(std::move(p));
+        });
+    }
+    virtual future<> put(std::vector<temporary_buffer<char>> data) override {
+        auto len = std::accumulate(data.begin(), data.end(), size_t(0), [] (size_t s, const temporary_buffer<char>& b) {
+            return s + b.size();
+        });
+        return _sched.admit(len).then([this, data = std::move(data)] () mutable {
+            return _sink.put(std::move(data));
+        });
+    }
+    virtual future<> put(temporary_buffer<char> buf) override {
+        auto len = buf.size();
+        return _sched.admit(len).then([this, buf = std::move(buf)] () mutable {
+            return _sink.put(std::move(buf));
+        });
+    }
+    virtual future<> flush() override {
+        return _sink.flush();
+    }
+    virtual future<> close() override {
+        return _sink.close();
+    }
+    virtual size_t buffer_size() const noexcept override {
+        return _sink.buffer_size();
+    }
+};
+
+data_sink egress_scheduler::wrap(data_sink sink) {
+    return data_sink(std::make_unique<metered_data_sink_impl>(std::move(sink), *this));
+}
+
+}
+
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#pragma once
+
+#include <seastar/core/fair_queue.hh>
+#include <seastar/core/future.hh>
+#include <seastar/core/iostream.hh>
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/core/scheduling.hh>
+#include <seastar/core/timer.hh>
+#include <array>
+#include <chrono>
+#include <deque>
+
+namespace seastar {
+
+namespace net {
+
+class egress_scheduler_tester;
+
+// Paces the data written to connected sockets on this shard to a share of
+// the link bandwidth, and divides it between scheduling groups according
+// to their shares, using a fair_queue with one priority class per group.
+//
+// A write is admitted once its class gets to dispatch it. Admitted bytes
+// then occupy a virtual link for bytes / bandwidth; the capacity they hold
+// in the fair_group (a burst worth of bytes) is only released once the
+// virtual link has sent them, which is what meters the writes.
+class egress_scheduler {
+    using clock_type = std::chrono::steady_clock;
+
+    struct request : public fair_queue_entry {
+        promise<> pr;
+        size_t bytes;
+        unsigned group;
+        clock_type::time_point queued_at;
+        request(fair_queue_ticket t, size_t bytes, unsigned group) noexcept
+            : fair_queue_entry(t), bytes(bytes), group(group), queued_at(clock_type::now()) {}
+    };
+
+    struct group_class {
+        priority_class_ptr pclass;
+        uint64_t bytes = 0;
+        uint64_t writes = 0;
+        uint64_t queued = 0;
+        clock_type::duration queue_time = {};
+        metrics::metric_groups metrics;
+    };
+
+    struct in_flight {
+        clock_type::time_point release_at;
+        fair_queue_ticket ticket;
+    };
+
+    const uint64_t _bandwidth; // bytes per second
+    const uint64_t _burst;
+    fair_group _group;
+    fair_queue _fq;
+    std::array<std::unique_ptr<group_class>, max_scheduling_groups()> _classes;
+    std::deque<in_flight> _in_flight;
+    clock_type::time_point _link_free_at;
+    timer<clock_type> _release_timer;
+public:
+    // \c bandwidth is this shard's share of the link, in bytes per second
+    explicit egress_scheduler(uint64_t bandwidth);
+    egress_scheduler(const egress_scheduler&) = delete;
+    ~egress_scheduler();
+
+    // Resolves when \c sg may write \c bytes
+    future<> admit(size_t bytes, scheduling_group sg) noexcept;
+
+    // Resolves when the current scheduling group may write \c bytes
+    future<> admit(size_t bytes) noexcept {
+        return admit(bytes, current_scheduling_group());
+    }
+
+    // Bytes admitted so far for \c sg
+    uint64_t admitted_bytes(scheduling_group sg) const noexcept;
+
+    // Wraps a connected socket's sink so that its writes go through admit(),
+    // charged to the scheduling group that puts them. The flush poller runs
+    // batched flushes under the group that requested them.
+    data_sink wrap(data_sink sink);
+private:
+    group_class& get_class(scheduling_group sg);
+    void dispatch();
+    void release();
+    void release(clock_type::time_point until);
+
+    friend class egress_scheduler_tester;
+};
+
+class egress_scheduler_tester {
+public:
+    // Lets the virtual link finish sending everything admitted so far, and
+    // admits what fits in the freed capacity
+    static void complete_in_flight(egress_scheduler& sched) {
+        sched.release(egress_scheduler::clock_type::time_point::max());
+    }
+};
+
+}
+
+}
@@ -103,6 +103,9 @@ class native_connected_socket_impl : public connected_socket_impl {
     keepalive_params get_keepalive_parameters() const override;
     int get_sockopt(int level, int optname, void* data, size_t len) const override;
     void set_sockopt(int level, int optname, const void* data, size_t len) override;
+    std::optional<tcp_info_sample> get_tcp_info() const override {
+        return _conn->get_tcp_info();
+    }
 };
 
 template <typename Protocol>
@@ -89,6 +89,9 @@ class posix_connected_socket_operations {
     virtual int get_sockopt(file_desc& _fd, int level, int optname, void* data, size_t len) const {
         return _fd.getsockopt(level, optname, reinterpret_cast<char*>(data), socklen_t(len));
     }
+    virtual std::optional<tcp_info_sample> get_tcp_info(file_desc& _fd) const {
+        return std::nullopt;
+    }
 };
 
 thread_local posix_ap_server_socket_impl::sockets_map_t posix_ap_server_socket_impl::sockets{};
@@ -121,6 +124,21 @@ class posix_tcp_connected_socket_operations : public posix_connected_socket_oper
             _fd.getsockopt<unsigned>(IPPROTO_TCP, TCP_KEEPCNT)
         };
     }
+    virtual std::optional<tcp_info_sample> get_tcp_info(file_desc& _fd) const override {
+        auto ti = _fd.getsockopt<struct ::tcp_info>(IPPROTO_TCP, TCP_INFO);
+        tcp_info_sample s;
+        s.rtt = std::chrono::microseconds(ti.tcpi_rtt);
+        s.rtt_var = std::chrono::microseconds(ti.tcpi_rttvar);
+        s.rto = std::chrono::microseconds(ti.tcpi_rto);
+        s.snd_cwnd = ti.tcpi_snd_cwnd;
+        s.snd_ssthresh = ti.tcpi_snd_ssthresh;
+        s.snd_mss = ti.tcpi_snd_mss;
+        s.rcv_space = ti.tcpi_rcv_space;
+        s.unacked = ti.tcpi_unacked;
+        s.lost = ti.tcpi_lost;
+        s.total_retransmits = ti.tcpi_total_retrans;
+        return s;
+    }
 };
 
 class posix_sctp_connected_socket_operations : public posix_connected_socket_operations {
@@ -248,6 +266,9 @@ class posix_connected_socket_impl final : public connected_socket_impl {
     int get_sockopt(int level, int optname, void* data, size_t len) const override {
         return _ops->get_sockopt(_fd.get_file_desc(), level, optname, data, len);
     }
+    std::optional<tcp_info_sample> get_tcp_info() const override {
+        return _ops->get_tcp_info(_fd.get_file_desc());
+    }
     friend class posix_server_socket_impl;
     friend class posix_ap_server_socket_impl;
     friend class posix_reuseport_server_socket_impl;
@@ -570,20 +591,65 @@ posix_ap_server_socket_impl::move_connected_socket(int protocol, socket_address
     }
 }
 
+posix_data_source_impl::posix_data_source_impl(pollable_fd fd, connected_socket_input_stream_config config,
+        std::pmr::polymorphic_allocator<char>* allocator)
+        : _buffer_allocator(allocator), _fd(std::move(fd)), _config(config) {
+    if (_config.receive_timestamps) {
+        // Software timestamps, taken when the kernel queues the data on the
+        // socket. Reads go through recvmsg() to get them.
+        _fd.get_file_desc().setsockopt(SOL_SOCKET, SO_TIMESTAMPNS, int(1));
+        _timestamped = std::make_unique<timestamped_read>();
+    }
+}
+
 future<temporary_buffer<char>>
 posix_data_source_impl::get() {
+    if (_timestamped) {
+        return get_timestamped();
+    }
     return _fd.read_some(static_cast<internal::buffer_allocator*>(this)).then([this] (temporary_buffer<char> b) {
-        if (b.size() >= _config.buffer_size) {
-            _config.buffer_size *= 2;
-            _config.buffer_size = std::min(_config.buffer_size, _config.max_buffer_size);
-        } else if (b.size() <= _config.buffer_size / 4) {
-            _config.buffer_size /= 2;
-            _config.buffer_size = std::max(_config.buffer_size, _config.min_buffer_size);
-        }
+        adjust_buffer_size(b.size());
         return b;
     });
 }
 
+future<temporary_buffer<char>>
+posix_data_source_impl::get_timestamped() {
+    auto buf = allocate_buffer();
+    auto& t = *_timestamped;
+    t.iov.iov_base = buf.get_write();
+    t.iov.iov_len = buf.size();
+    t.msg = {};
+    t.msg.msg_iov = &t.iov;
+    t.msg.msg_iovlen = 1;
+    t.msg.msg_control = t.control;
+    t.msg.msg_controllen = sizeof(t.control);
+    return _fd.recvmsg(&t.msg).then([this, buf = std::move(buf)] (size_t size) mutable {
+        auto& msg = _timestamped->msg;
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                auto ts = copy_reinterpret_cast<::timespec>(CMSG_DATA(cmsg));
+                auto since_epoch = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+                _receive_timestamp = std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(since_epoch));
+            }
+        }
+        buf.trim(size);
+        adjust_buffer_size(size);
+        return std::move(buf);
+    });
+}
+
+void posix_data_source_impl::adjust_buffer_size(size_t last_read) noexcept {
+    if (last_read >= _config.buffer_size) {
+        _config.buffer_size *= 2;
+        _config.buffer_size = std::min(_config.buffer_size, _config.max_buffer_size);
+    } else if (last_read <= _config.buffer_size / 4) {
+        _config.buffer_size /= 2;
+        _config.buffer_size = std::max(_config.buffer_size, _config.min_buffer_size);
+    }
+}
+
 temporary_buffer<char>
 posix_data_source_impl::allocate_buffer() {
     return make_temporary_buffer<char>(_buffer_allocator, _config.buffer_size);
@@ -21,6 +21,8 @@
 
 #include <seastar/net/stack.hh>
 #include <seastar/net/inet_address.hh>
+#include <seastar/core/reactor.hh>
+#include "net/egress_scheduler.hh"
 
 namespace seastar {
 
@@ -100,7 +102,11 @@ output_stream<char> connected_socket::output(size_t buffer_size) {
     output_stream_options opts;
     opts.batch_flushes = true;
     // TODO: allow user to determine buffer size etc
-    return output_stream<char>(_csi->sink(), buffer_size, opts);
+    auto sink = _csi->sink();
+    if (auto sched = engine().network_egress_scheduler()) {
+        sink = sched->wrap(std::move(sink));
+    }
+    return output_stream<char>(std::move(sink), buffer_size, opts);
 }
 
 void connected_socket::set_nodelay(bool nodelay) {
@@ -128,6 +134,9 @@ void connected_socket::set_sockopt(int level, int optname, const void* data, siz
 int connected_socket::get_sockopt(int level, int optname, void* data, size_t len) const {
     return _csi->get_sockopt(level, optname, data, len);
 }
+std::optional<net::tcp_info_sample> connected_socket::get_tcp_info() const {
+    return _csi->get_tcp_info();
+}
 
 void connected_socket::shutdown_output() {
     _csi->shutdown_output();
@@ -0,0 +1,111 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#include <seastar/net/tcp_info_sampler.hh>
+#include <seastar/core/metrics.hh>
+#include <algorithm>
+
+namespace seastar {
+
+namespace net {
+
+tcp_info_sampler::tcp_info_sampler(sstring name, tcp_info_sampler_config cfg)
+        : _max_per_period(std::max(cfg.max_connections_per_period, 1u))
+        , _timer([this] { sample(); })
+{
+    namespace sm = seastar::metrics;
+    auto endpoint_label = sm::label("endpoint")(name);
+    _metrics.add_group("tcp", {
+        sm::make_histogram("rtt_us", [this] { return _rtt.get(); },
+                sm::description("Smoothed round-trip time of the connections, in microseconds, sampled once per period"),
+                {endpoint_label}),
+        sm::make_histogram("cwnd", [this] { return _cwnd.get(); },
+                sm::description("Congestion window of the connections, in segments, sampled once per period"),
+                {endpoint_label}),
+        sm::make_histogram("period_retransmits", [this] { return _retransmits.get(); },
+                sm::description("Segments each connection retransmitted since its previous sample"),
+                {endpoint_label}),
+        sm::make_counter("retransmits", _total_retransmits,
+                sm::description("Segments retransmitted by the connections, as seen by sampling"),
+                {endpoint_label}),
+        sm::make_gauge("connections", [this] { return connections(); },
+                sm::description("Connections being sampled"),
+                {endpoint_label}),
+        sm::make_counter("sample_errors", _errors,
+                sm::description("Connections whose TCP state could not be sampled"),
+                {endpoint_label}),
+    });
+    _timer.arm_periodic(cfg.period);
+}
+
+tcp_info_sampler::~tcp_info_sampler() {
+    _entries.clear();
+}
+
+tcp_info_sampler::registration tcp_info_sampler::track(const connected_socket& socket) {
+    auto e = std::make_unique<entry>(socket);
+    _entries.push_back(*e);
+    return registration(std::move(e));
+}
+
+void tcp_info_sampler::sample() noexcept {
+    if (_entries.empty()) {
+        return;
+    }
+    // Stop after a full round, when the first connection sampled is back
+    // at the front
+    const entry* first = &_entries.front();
+    for (unsigned n = 0; n < _max_per_period && (n == 0 || &_entries.front() != first); n++) {
+        auto& e = _entries.front();
+        _entries.pop_front();
+        _entries.push_back(e);
+        std::optional<tcp_info_sample> s;
+        try {
+            s = e.socket.get_tcp_info();
+        } catch (...) {
+            _errors++;
+            continue;
+        }
+        if (!s) {
+            continue;
+        }
+        auto retransmits = s->total_retransmits - (e.last ? e.last->total_retransmits : 0);
+        _rtt.add(s->rtt.count());
+        _cwnd.add(s->snd_cwnd);
+        _retransmits.add(retransmits);
+        _total_retransmits += retransmits;
+        e.last = s;
+    }
+}
+
+void tcp_info_sampler::for_each_sample(noncopyable_function<void (const connected_socket&, const tcp_info_sample&)> func) const {
+    for (auto& e : _entries) {
+        if (e.last) {
+            func(e.socket, *e.last);
+        }
+    }
+}
+
+}
+
+}
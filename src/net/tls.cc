@@ -1585,6 +1585,9 @@ class tls_connected_socket_impl : public net::connected_socket_impl, public sess
     int get_sockopt(int level, int optname, void* data, size_t len) const override {
         return _session->socket().get_sockopt(level, optname, data, len);
     }
+    std::optional<net::tcp_info_sample> get_tcp_info() const override {
+        return _session->socket().get_tcp_info();
+    }
 };
 
 
@@ -3,6 +3,8 @@
 #include <seastar/core/seastar.hh>
 #include <seastar/core/print.hh>
 #include <seastar/core/future-util.hh>
+#include <seastar/core/metrics.hh>
+#include <seastar/core/with_request_context.hh>
 #include <seastar/util/defer.hh>
 #include <boost/range/adaptor/map.hpp>
 
@@ -134,15 +136,26 @@ namespace rpc {
                   d.pcancel->cancel_send = std::function<void()>(); // request is no longer cancellable
               }
               if (QueueType == outgoing_queue_type::request) {
-                  static_assert(snd_buf::chunk_size >= 8, "send buffer chunk size is too small");
+                  static_assert(snd_buf::chunk_size >= 24, "send buffer chunk size is too small");
+                  // The request is preceded by 16 bytes of request context and 8 bytes of
+                  // timeout; drop whatever was not negotiated.
+                  if (!_request_context_negotiated) {
+                      d.buf.front().trim_front(16);
+                      d.buf.size -= 16;
+                  }
+                  size_t timeout_offset = _request_context_negotiated ? 16 : 0;
                   if (_timeout_negotiated) {
                       auto expire = d.t.get_timeout();
                       uint64_t left = 0;
                       if (expire != typename timer<rpc_clock_type>::time_point()) {
                           left = std::chrono::duration_cast<std::chrono::milliseconds>(expire - timer<rpc_clock_type>::clock::now()).count();
                       }
-                      write_le<uint64_t>(d.buf.front().get_write(), left);
+                      write_le<uint64_t>(d.buf.front().get_write() + timeout_offset, left);
                   } else {
+                      if (timeout_offset) {
+                          auto p = d.buf.front().get_write();
+                          std::memmove(p + 8, p, timeout_offset);
+                      }
                       d.buf.front().trim_front(8);
                       d.buf.size -= 8;
                   }
@@ -173,12 +186,12 @@ namespace rpc {
       });
   }
 
-  void connection::set_socket(connected_socket&& fd) {
+  void connection::set_socket(connected_socket&& fd, connected_socket_input_stream_config csisc) {
       if (_connected) {
           throw std::runtime_error("already connected");
       }
       _fd = std::move(fd);
-      _read_buf =_fd.input();
+      _read_buf =_fd.input(csisc);
       _write_buf = _fd.output();
       _connected = true;
   }
@@ -538,6 +551,9 @@ namespace rpc {
           case protocol_features::TIMEOUT:
               _timeout_negotiated = true;
               break;
+          case protocol_features::REQUEST_CONTEXT:
+              _request_context_negotiated = true;
+              break;
           case protocol_features::CONNECTION_ID: {
               _id = deserialize_connection_id(e.second);
               break;
@@ -660,6 +676,9 @@ namespace rpc {
               fd.set_keepalive_parameters(ops.keepalive.value());
           }
           set_socket(std::move(fd));
+          if (_options.tcp_info_sampler) {
+              _tcp_info = _options.tcp_info_sampler->track(_fd);
+          }
 
           feature_map features;
           if (_options.compressor_factory) {
@@ -668,6 +687,9 @@ namespace rpc {
           if (_options.send_timeout_data) {
               features[protocol_features::TIMEOUT] = "";
           }
+          if (_options.send_request_context) {
+              features[protocol_features::REQUEST_CONTEXT] = "";
+          }
           if (_options.stream_parent) {
               features[protocol_features::STREAM_PARENT] = serialize_connection_id(_options.stream_parent);
           }
@@ -777,6 +799,10 @@ namespace rpc {
               _timeout_negotiated = true;
               ret[protocol_features::TIMEOUT] = "";
               break;
+          case protocol_features::REQUEST_CONTEXT:
+              _request_context_negotiated = true;
+              ret[protocol_features::REQUEST_CONTEXT] = "";
+              break;
           case protocol_features::STREAM_PARENT: {
               if (!_server._options.streaming_domain) {
                   f = make_exception_future<>(std::runtime_error("streaming is not configured for the server"));
@@ -831,9 +857,9 @@ namespace rpc {
 
   struct request_frame {
       using opt_buf_type = std::optional<rcv_buf>;
-      using header_and_buffer_type = std::tuple<std::optional<uint64_t>, uint64_t, int64_t, opt_buf_type>;
+      using header_and_buffer_type = std::tuple<std::optional<uint64_t>, uint64_t, int64_t, opt_buf_type, request_context>;
       using return_type = future<header_and_buffer_type>;
-      using header_type = std::tuple<std::optional<uint64_t>, uint64_t, int64_t, uint32_t>;
+      using header_type = std::tuple<std::optional<uint64_t>, uint64_t, int64_t, uint32_t, request_context>;
       static size_t header_size() {
           return 20;
       }
@@ -841,19 +867,19 @@ namespace rpc {
           return "server";
       }
       static auto empty_value() {
-          return make_ready_future<header_and_buffer_type>(header_and_buffer_type(std::nullopt, uint64_t(0), 0, std::nullopt));
+          return make_ready_future<header_and_buffer_type>(header_and_buffer_type(std::nullopt, uint64_t(0), 0, std::nullopt, request_context{}));
       }
       static header_type decode_header(const char* ptr) {
           auto type = read_le<uint64_t>(ptr);
           auto msgid = read_le<int64_t>(ptr + 8);
           auto size = read_le<uint32_t>(ptr + 16);
-          return std::make_tuple(std::nullopt, type, msgid, size);
+          return std::make_tuple(std::nullopt, type, msgid, size, request_context{});
       }
       static uint32_t get_size(const header_type& t) {
           return std::get<3>(t);
       }
       static auto make_value(const header_type& t, rcv_buf data) {
-          return make_ready_future<header_and_buffer_type>(header_and_buffer_type(std::get<0>(t), std::get<1>(t), std::get<2>(t), std::move(data)));
+          return make_ready_future<header_and_buffer_type>(header_and_buffer_type(std::get<0>(t), std::get<1>(t), std::get<2>(t), std::move(data), std::get<4>(t)));
       }
   };
 
@@ -869,8 +895,27 @@ namespace rpc {
       }
   };
 
+  template <typename Frame>
+  struct request_frame_with_context : Frame {
+      static size_t header_size() {
+          return Frame::header_size() + 16;
+      }
+      static typename request_frame::header_type decode_header(const char* ptr) {
+          auto h = Frame::decode_header(ptr + 16);
+          std::get<4>(h) = request_context{read_le<uint64_t>(ptr), read_le<uint64_t>(ptr + 8)};
+          return h;
+      }
+  };
+
   future<request_frame::header_and_buffer_type>
   server::connection::read_request_frame_compressed(input_stream<char>& in) {
+      if (_request_context_negotiated) {
+          if (_timeout_negotiated) {
+              return read_frame_compressed<request_frame_with_context<request_frame_with_timeout>>(_info.addr, _compressor, in);
+          } else {
+              return read_frame_compressed<request_frame_with_context<request_frame>>(_info.addr, _compressor, in);
+          }
+      }
       if (_timeout_negotiated) {
           return read_frame_compressed<request_frame_with_timeout>(_info.addr, _compressor, in);
       } else {
@@ -922,10 +967,14 @@ future<> server::connection::send_unknown_verb_reply(std::optional<rpc_clock_typ
                   auto& type = std::get<1>(header_and_buffer);
                   auto& msg_id = std::get<2>(header_and_buffer);
                   auto& data = std::get<3>(header_and_buffer);
+                  auto& ctx = std::get<4>(header_and_buffer);
                   if (!data) {
                       _error = true;
                       return make_ready_future<>();
                   } else {
+                      if (auto arrival = _read_buf.receive_timestamp()) {
+                          _server._arrival_latency.add(*arrival);
+                      }
                       std::optional<rpc_clock_type::time_point> timeout;
                       if (expire && *expire) {
                           timeout = relative_timeout_to_absolute(std::chrono::milliseconds(*expire));
@@ -938,8 +987,11 @@ future<> server::connection::send_unknown_verb_reply(std::optional<rpc_clock_typ
                       // If the new method of per-connection scheduling group was used, honor it.
                       // Otherwise, use the old per-handler scheduling group.
                       auto sg = _isolation_config ? _isolation_config->sched_group : h->sg;
-                      return with_scheduling_group(sg, [this, timeout, msg_id, h, data = std::move(data.value())] () mutable {
-                          return h->func(shared_from_this(), timeout, msg_id, std::move(data)).finally([this, h] {
+                      return with_scheduling_group(sg, [this, timeout, msg_id, h, ctx, data = std::move(data.value())] () mutable {
+                          // The handler, and everything it does, runs under the caller's request context
+                          return with_request_context(ctx, [&] {
+                              return h->func(shared_from_this(), timeout, msg_id, std::move(data));
+                          }).finally([this, h] {
                               // If anything between get_handler() and here throws, we leak put_handler
                               _server._proto->put_handler(h);
                           });
@@ -972,8 +1024,14 @@ future<> server::connection::send_unknown_verb_reply(std::optional<rpc_clock_typ
       });
   }
 
+  static connected_socket_input_stream_config server_input_config(const server_options& opts) noexcept {
+      connected_socket_input_stream_config csisc;
+      csisc.receive_timestamps = opts.receive_timestamps;
+      return csisc;
+  }
+
   server::connection::connection(server& s, connected_socket&& fd, socket_address&& addr, const logger& l, void* serializer, connection_id id)
-      : rpc::connection(std::move(fd), l, serializer, id), _server(s) {
+      : rpc::connection(std::move(fd), l, serializer, id, server_input_config(s._options)), _server(s) {
       _info.addr = std::move(addr);
   }
 
@@ -1006,6 +1064,18 @@ future<> server::connection::send_unknown_verb_reply(std::optional<rpc_clock_typ
   server::server(protocol_base* proto, server_socket ss, resource_limits limits, server_options opts)
           : _proto(proto), _ss(std::move(ss)), _limits(limits), _resources_available(limits.max_memory), _options(opts)
   {
+      if (_options.receive_timestamps) {
+          namespace sm = seastar::metrics;
+          try {
+              _metrics.add_group("rpc_server", {
+                  sm::make_histogram("request_arrival_latency_us", [this] { return _arrival_latency.get(); },
+                          sm::description("Delay between the arrival of a request in the kernel and its dispatch to the handler, in microseconds"),
+                          {sm::label("domain")(_options.metrics_domain)}),
+              });
+          } catch (metrics::double_registration&) {
+              throw std::runtime_error(format("An RPC server with the metrics domain {} already exports metrics on this shard", _options.metrics_domain));
+          }
+      }
       if (_options.streaming_domain) {
           if (_servers.find(*_options.streaming_domain) != _servers.end()) {
               throw std::runtime_error(format("An RPC server with the streaming domain {} is already exist", *_options.streaming_domain));
@@ -0,0 +1,169 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/util/crc32c.hh>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace seastar {
+
+namespace {
+
+// Reflected Castagnoli polynomial
+constexpr uint32_t crc32c_poly = 0x82f63b78;
+
+// Slicing-by-8 tables: table[0] is the classic byte-at-a-time table,
+// table[k][b] is the CRC of byte b followed by k zero bytes.
+struct crc32c_tables {
+    std::array<std::array<uint32_t, 256>, 8> t = {};
+
+    constexpr crc32c_tables() noexcept {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; i++) {
+                crc = (crc >> 1) ^ (crc & 1 ? crc32c_poly : 0);
+            }
+            t[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; b++) {
+            for (size_t k = 1; k < t.size(); k++) {
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+            }
+        }
+    }
+};
+
+constexpr crc32c_tables tables;
+
+uint32_t crc32c_sw(uint32_t crc, const uint8_t* p, size_t len) noexcept {
+    auto& t = tables.t;
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        v ^= crc;
+        crc = t[7][v & 0xff] ^ t[6][(v >> 8) & 0xff] ^ t[5][(v >> 16) & 0xff] ^ t[4][(v >> 24) & 0xff]
+            ^ t[3][(v >> 32) & 0xff] ^ t[2][(v >> 40) & 0xff] ^ t[1][(v >> 48) & 0xff] ^ t[0][v >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) noexcept {
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = crc64;
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+bool have_hw_crc32c() noexcept {
+    // May run before libgcc's own constructor has initialized the cpu model
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) noexcept {
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+bool have_hw_crc32c() noexcept {
+    return true;
+}
+
+#else
+
+uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t len) noexcept {
+    return crc32c_sw(crc, p, len);
+}
+
+bool have_hw_crc32c() noexcept {
+    return false;
+}
+
+#endif
+
+using crc32c_fn = uint32_t (*)(uint32_t, const uint8_t*, size_t) noexcept;
+
+// Selected on first use rather than during dynamic initialization, so that
+// checksums computed by other static initializers are correct
+crc32c_fn crc32c_impl() noexcept {
+    static const crc32c_fn fn = have_hw_crc32c() ? crc32c_hw : crc32c_sw;
+    return fn;
+}
+
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t len) noexcept {
+    return ~crc32c_impl()(~crc, static_cast<const uint8_t*>(data), len);
+}
+
+void crc32c_blocks(const void* data, size_t block_size, size_t nr_blocks, uint32_t* out) noexcept {
+    auto fn = crc32c_impl();
+    auto p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < nr_blocks; i++) {
+        out[i] = ~fn(~uint32_t(0), p, block_size);
+        p += block_size;
+    }
+}
+
+namespace internal {
+
+uint32_t crc32c_portable(uint32_t crc, const void* data, size_t len) noexcept {
+    return ~crc32c_sw(~crc, static_cast<const uint8_t*>(data), len);
+}
+
+}
+
+}
@@ -24,8 +24,14 @@
 #include <list>
 #include <deque>
 
+#include <boost/range/irange.hpp>
+
 #include <seastar/core/reactor.hh>
 #include <seastar/core/seastar.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/semaphore.hh>
+#include <seastar/core/condition-variable.hh>
 #include <seastar/util/file.hh>
 
 namespace seastar {
@@ -201,4 +207,135 @@ future<> recursive_remove_directory(fs::path path) noexcept {
     });
 }
 
+namespace {
+
+class directory_scanner {
+    directory_scan_options _opts;
+    noncopyable_function<future<> (scanned_entry)> _consumer;
+    // Directories found but not yet listed. Only paths are kept here, so
+    // memory is dominated by the directories currently being scanned.
+    std::deque<fs::path> _pending;
+    unsigned _busy = 0;
+    unsigned _next_shard;
+    bool _failed = false;
+    condition_variable _cv;
+    semaphore _consume_lock{1};
+public:
+    directory_scanner(fs::path root, noncopyable_function<future<> (scanned_entry)> consumer, directory_scan_options opts)
+            : _opts(std::move(opts))
+            , _consumer(std::move(consumer))
+            , _next_shard(this_shard_id())
+    {
+        _pending.push_back(std::move(root));
+    }
+
+    future<> run() {
+        return parallel_for_each(boost::irange(0u, std::max(_opts.concurrency, 1u)), [this] (unsigned) {
+            return worker();
+        });
+    }
+
+private:
+    shard_id pick_shard() noexcept {
+        if (!_opts.use_all_shards) {
+            return this_shard_id();
+        }
+        return _next_shard++ % smp::count;
+    }
+
+    future<> worker() {
+        return repeat([this] {
+            if (_failed) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            if (_pending.empty()) {
+                if (!_busy) {
+                    _cv.broadcast();
+                    return make_ready_future<stop_iteration>(stop_iteration::yes);
+                }
+                // Someone else is listing a directory and may find more work
+                return _cv.wait().then([] {
+                    return stop_iteration::no;
+                });
+            }
+            auto dir = std::move(_pending.front());
+            _pending.pop_front();
+            ++_busy;
+            return smp::submit_to(pick_shard(), [dir = std::move(dir), batch_size = _opts.stat_batch_size] () mutable {
+                return scan_directory(std::move(dir), batch_size);
+            }).then([this] (std::vector<scanned_entry> entries) {
+                return consume(std::move(entries));
+            }).then_wrapped([this] (future<> f) {
+                --_busy;
+                _cv.broadcast();
+                if (f.failed()) {
+                    _failed = true;
+                    return make_exception_future<stop_iteration>(f.get_exception());
+                }
+                return make_ready_future<stop_iteration>(stop_iteration::no);
+            });
+        });
+    }
+
+    future<> consume(std::vector<scanned_entry> entries) {
+        return with_semaphore(_consume_lock, 1, [this, entries = std::move(entries)] () mutable {
+            return do_with(std::move(entries), [this] (std::vector<scanned_entry>& entries) {
+                return do_for_each(entries, [this] (scanned_entry& e) {
+                    if (e.stat.type == directory_entry_type::directory) {
+                        _pending.push_back(e.path);
+                        _cv.signal();
+                    }
+                    return _consumer(std::move(e));
+                });
+            });
+        });
+    }
+
+    // Runs on the shard chosen by pick_shard(): lists a single directory and
+    // stats its entries in batches on that shard's syscall thread.
+    static future<std::vector<scanned_entry>> scan_directory(fs::path dir, size_t batch_size) {
+        return open_directory(dir.native()).then([dir] (file f) mutable {
+            return do_with(std::move(f), std::move(dir), std::vector<sstring>(), [] (file& f, const fs::path& dir, std::vector<sstring>& paths) {
+                return f.list_directory([&dir, &paths] (directory_entry de) {
+                    paths.push_back((dir / de.name.c_str()).native());
+                    return make_ready_future<>();
+                }).done().finally([&f] {
+                    return f.close();
+                }).then([&paths] {
+                    return std::move(paths);
+                });
+            });
+        }).then([batch_size = std::max(batch_size, size_t(1))] (std::vector<sstring> paths) {
+            return do_with(std::move(paths), std::vector<scanned_entry>(), size_t(0), [batch_size] (const std::vector<sstring>& paths, std::vector<scanned_entry>& entries, size_t& pos) {
+                entries.reserve(paths.size());
+                return do_until([&paths, &pos] { return pos == paths.size(); }, [&paths, &entries, &pos, batch_size] {
+                    auto end = std::min(paths.size(), pos + batch_size);
+                    std::vector<sstring> batch(paths.begin() + pos, paths.begin() + end);
+                    return engine().file_stat_batch(std::move(batch), follow_symlink::no).then([&paths, &entries, &pos, end] (std::vector<std::optional<stat_data>> stats) {
+                        for (size_t i = 0; i < stats.size(); i++) {
+                            // Disengaged if the entry was removed after it was listed
+                            if (stats[i]) {
+                                entries.push_back(scanned_entry{fs::path(paths[pos + i]), *stats[i]});
+                            }
+                        }
+                        pos = end;
+                    });
+                }).then([&entries] {
+                    return std::move(entries);
+                });
+            });
+        });
+    }
+};
+
+} // anonymous namespace
+
+future<> scan_directory_tree(fs::path root, noncopyable_function<future<> (scanned_entry)> consumer, directory_scan_options opts) noexcept {
+    return futurize_invoke([root = std::move(root), consumer = std::move(consumer), opts = std::move(opts)] () mutable {
+        auto scanner = std::make_unique<directory_scanner>(std::move(root), std::move(consumer), std::move(opts));
+        auto f = scanner->run();
+        return f.finally([scanner = std::move(scanner)] {});
+    });
+}
+
 } //namespace seastar
@@ -0,0 +1,136 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+// Simulates a startup scan of a data directory: builds a synthetic tree
+// and walks it, first with one file_stat() per entry on the local shard,
+// then with scan_directory_tree().
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/file.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/util/file.hh>
+#include <seastar/util/tmp_file.hh>
+#include <fmt/printf.h>
+#include <boost/range/irange.hpp>
+#include <deque>
+
+using namespace seastar;
+namespace fs = std::filesystem;
+
+static void populate(const fs::path& dir, unsigned depth, unsigned fanout, unsigned files) {
+    touch_directory(dir.native()).get();
+    parallel_for_each(boost::irange(0u, files), [&dir] (unsigned i) {
+        auto name = dir / format("file-{}", i).c_str();
+        return open_file_dma(name.native(), open_flags::wo | open_flags::create).then([] (file f) {
+            return f.close().finally([f] {});
+        });
+    }).get();
+    if (depth) {
+        for (unsigned i = 0; i < fanout; i++) {
+            populate(dir / format("dir-{}", i).c_str(), depth - 1, fanout, files);
+        }
+    }
+}
+
+// What a typical application does today: list each directory and stat its
+// entries one by one.
+static size_t naive_scan(const fs::path& root) {
+    size_t entries = 0;
+    std::deque<fs::path> pending{root};
+    while (!pending.empty()) {
+        auto dir = std::move(pending.front());
+        pending.pop_front();
+        auto f = open_directory(dir.native()).get0();
+        std::vector<fs::path> names;
+        f.list_directory([&] (directory_entry de) {
+            names.push_back(dir / de.name.c_str());
+            return make_ready_future<>();
+        }).done().get();
+        f.close().get();
+        for (auto& name : names) {
+            auto sd = file_stat(name.native(), follow_symlink::no).get0();
+            if (sd.type == directory_entry_type::directory) {
+                pending.push_back(name);
+            }
+            entries++;
+        }
+    }
+    return entries;
+}
+
+int main(int ac, char** av) {
+    app_template at;
+    namespace bpo = boost::program_options;
+    at.add_options()
+            ("directory", bpo::value<sstring>()->default_value("."), "Directory in which to create the synthetic tree")
+            ("depth", bpo::value<unsigned>()->default_value(3), "Depth of the tree")
+            ("fanout", bpo::value<unsigned>()->default_value(8), "Subdirectories per directory")
+            ("files", bpo::value<unsigned>()->default_value(200), "Files per directory")
+            ("concurrency", bpo::value<unsigned>()->default_value(16), "Directories scanned in parallel")
+            ("stat-batch-size", bpo::value<size_t>()->default_value(128), "Entries stat()ed per syscall thread round-trip")
+            ;
+    return at.run(ac, av, [&at] {
+        return seastar::async([&at] {
+            auto& cfg = at.configuration();
+            auto depth = cfg["depth"].as<unsigned>();
+            auto fanout = cfg["fanout"].as<unsigned>();
+            auto files = cfg["files"].as<unsigned>();
+            directory_scan_options opts;
+            opts.concurrency = cfg["concurrency"].as<unsigned>();
+            opts.stat_batch_size = cfg["stat-batch-size"].as<size_t>();
+
+            auto td = tmp_dir();
+            td.create(fs::path(cfg["directory"].as<sstring>())).get();
+            futurize_invoke([&] {
+                auto root = td.get_path() / "tree";
+                fmt::print("Populating {} (depth {}, fanout {}, {} files per directory)\n", root.native(), depth, fanout, files);
+                populate(root, depth, fanout, files);
+
+                using fseconds = std::chrono::duration<float, std::ratio<1, 1>>;
+                fmt::print("{:20} {:10} {:10} {:12}\n", "method", "entries", "time (s)", "entries/s");
+                auto report = [] (const char* method, size_t entries, std::chrono::steady_clock::duration d) {
+                    auto secs = std::chrono::duration_cast<fseconds>(d).count();
+                    fmt::print("{:20} {:10d} {:10.3f} {:12.0f}\n", method, entries, secs, entries / secs);
+                };
+
+                auto start = std::chrono::steady_clock::now();
+                auto entries = naive_scan(root);
+                report("naive", entries, std::chrono::steady_clock::now() - start);
+
+                for (auto all_shards : { false, true }) {
+                    opts.use_all_shards = all_shards;
+                    entries = 0;
+                    start = std::chrono::steady_clock::now();
+                    scan_directory_tree(root, [&entries] (scanned_entry) {
+                        entries++;
+                        return make_ready_future<>();
+                    }, opts).get();
+                    report(all_shards ? "scan (all shards)" : "scan (local shard)", entries, std::chrono::steady_clock::now() - start);
+                }
+            }).finally([&td] {
+                return td.remove();
+            }).get();
+        });
+    });
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+// Measures how long it takes to drop a vector of foreign_ptrs, as returned
+// by a map_reduce over shards, until every object has been destroyed on its
+// owner shard.
+//
+// Usage: foreign_ptr_perf --smp 2 [--count N] [--runs N]
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/sharded.hh>
+#include <seastar/core/thread.hh>
+#include <fmt/printf.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace seastar;
+using clk = std::chrono::steady_clock;
+
+static thread_local size_t destroyed;
+
+struct object {
+    ~object() { ++destroyed; }
+};
+
+int main(int ac, char** av) {
+    app_template at;
+    namespace bpo = boost::program_options;
+    at.add_options()
+            ("count", bpo::value<unsigned>()->default_value(10000), "Number of foreign_ptrs to drop")
+            ("runs", bpo::value<unsigned>()->default_value(10), "Number of runs")
+            ;
+    return at.run(ac, av, [&at] {
+        return seastar::async([&at] {
+            if (smp::count < 2) {
+                fmt::print("foreign_ptr_perf needs at least 2 shards\n");
+                return;
+            }
+            auto& cfg = at.configuration();
+            auto count = cfg["count"].as<unsigned>();
+            auto runs = cfg["runs"].as<unsigned>();
+            fmt::print("{:>5} {:>12} {:>12} {:>14}\n", "run", "drop (us)", "total (us)", "destroys/s");
+            for (unsigned run = 0; run < runs; run++) {
+                auto ptrs = smp::submit_to(1, [count] {
+                    destroyed = 0;
+                    std::vector<foreign_ptr<std::unique_ptr<object>>> ptrs;
+                    ptrs.reserve(count);
+                    for (unsigned i = 0; i < count; i++) {
+                        ptrs.push_back(make_foreign(std::make_unique<object>()));
+                    }
+                    return ptrs;
+                }).get0();
+
+                auto start = clk::now();
+                ptrs.clear();
+                auto dropped = clk::now();
+                while (smp::submit_to(1, [] { return destroyed; }).get0() < count) {
+                    thread::yield();
+                }
+                auto end = clk::now();
+
+                using usecs = std::chrono::duration<double, std::micro>;
+                auto total = std::chrono::duration_cast<usecs>(end - start).count();
+                fmt::print("{:5d} {:12.1f} {:12.1f} {:14.0f}\n", run,
+                        std::chrono::duration_cast<usecs>(dropped - start).count(), total, count / total * 1e6);
+            }
+        });
+    });
+}
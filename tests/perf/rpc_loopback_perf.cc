@@ -0,0 +1,128 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+// Ping-pong RPC over loopback TCP, reporting throughput and the number of
+// epoll_ctl() calls the reactor made per request. Run it twice to compare
+// the epoll registration modes:
+//
+//   rpc_loopback_perf --reactor-backend epoll --epoll-edge-triggered 0
+//   rpc_loopback_perf --reactor-backend epoll --epoll-edge-triggered 1
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/net/api.hh>
+#include <seastar/rpc/rpc.hh>
+#include <seastar/util/defer.hh>
+#include <fmt/printf.h>
+#include <boost/range/irange.hpp>
+#include <chrono>
+
+using namespace seastar;
+
+struct serializer {
+};
+
+template <typename Output>
+inline void write(serializer, Output& out, uint32_t v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename Input>
+inline uint32_t read(serializer, Input& in, rpc::type<uint32_t>) {
+    uint32_t v;
+    in.read(reinterpret_cast<char*>(&v), sizeof(v));
+    return v;
+}
+
+template <typename Output>
+inline void write(serializer s, Output& out, const sstring& v) {
+    write(s, out, uint32_t(v.size()));
+    out.write(v.c_str(), v.size());
+}
+
+template <typename Input>
+inline sstring read(serializer s, Input& in, rpc::type<sstring>) {
+    auto size = read(s, in, rpc::type<uint32_t>());
+    sstring ret = uninitialized_string(size);
+    in.read(ret.data(), size);
+    return ret;
+}
+
+int main(int ac, char** av) {
+    app_template at;
+    namespace bpo = boost::program_options;
+    at.add_options()
+            ("requests", bpo::value<unsigned>()->default_value(200000), "Total number of requests")
+            ("concurrency", bpo::value<unsigned>()->default_value(1), "Requests in flight")
+            ("payload", bpo::value<size_t>()->default_value(64), "Request and response size in bytes")
+            ;
+    return at.run(ac, av, [&at] {
+        return seastar::async([&at] {
+            auto& cfg = at.configuration();
+            auto requests = cfg["requests"].as<unsigned>();
+            auto concurrency = std::max(1u, cfg["concurrency"].as<unsigned>());
+            auto payload = sstring(cfg["payload"].as<size_t>(), 'x');
+
+            rpc::protocol<serializer> proto(serializer{});
+            proto.register_handler(1, [] (sstring s) {
+                return s;
+            });
+            auto echo = proto.make_client<sstring (sstring)>(1);
+
+            listen_options lo;
+            lo.reuse_address = true;
+            auto ss = seastar::listen(ipv4_addr("127.0.0.1", 0), lo);
+            auto addr = ss.local_address();
+            rpc::protocol<serializer>::server server(proto, rpc::server_options{}, std::move(ss));
+            rpc::protocol<serializer>::client client(proto, addr);
+            auto stop = defer([&] {
+                client.stop().get();
+                server.stop().get();
+            });
+
+            // Warm up, so that connection setup isn't measured
+            echo(client, payload).get();
+
+            auto ctls = engine().epoll_ctl_calls();
+            auto start = std::chrono::steady_clock::now();
+            parallel_for_each(boost::irange(0u, concurrency), [&] (unsigned worker) {
+                auto nr = requests / concurrency + (worker < requests % concurrency);
+                return do_with(nr, [&] (unsigned& left) {
+                    return do_until([&left] { return left == 0; }, [&] {
+                        --left;
+                        return echo(client, payload).discard_result();
+                    });
+                });
+            }).get();
+            auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ctls = engine().epoll_ctl_calls() - ctls;
+
+            fmt::print("epoll-edge-triggered={} requests={} concurrency={} payload={}\n",
+                    cfg["epoll-edge-triggered"].as<bool>(), requests, concurrency, payload.size());
+            fmt::print("{:.0f} requests/s, {} epoll_ctl calls ({:.3f} per request)\n",
+                    requests / secs, ctls, double(ctls) / requests);
+        });
+    });
+}
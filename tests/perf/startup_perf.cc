@@ -0,0 +1,125 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+// Measures reactor startup time: how long it takes until a task has run
+// on every shard. Startup can only happen once per process, so the
+// benchmark re-executes itself once per run and collects the results.
+//
+// Usage: startup_perf [--runs N] [seastar options, e.g. --smp 64]
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/smp.hh>
+#include <fmt/printf.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace seastar;
+using clk = std::chrono::steady_clock;
+
+static constexpr const char* child_env = "SEASTAR_STARTUP_PERF_CHILD";
+
+static double to_ms(clk::duration d) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(d).count();
+}
+
+static int run_child(int ac, char** av) {
+    auto start = clk::now();
+    app_template app;
+    return app.run(ac, av, [start] {
+        return smp::invoke_on_all([] {}).then([start] {
+            fmt::print("{:.3f}\n", to_ms(clk::now() - start));
+        });
+    });
+}
+
+struct measurement {
+    double in_process_ms;
+    double wall_ms;
+};
+
+static measurement run_once(std::vector<char*>& args) {
+    int fds[2];
+    if (::pipe(fds)) {
+        throw std::system_error(errno, std::system_category(), "pipe");
+    }
+    auto start = clk::now();
+    auto pid = ::fork();
+    if (pid == 0) {
+        ::dup2(fds[1], STDOUT_FILENO);
+        ::close(fds[0]);
+        ::close(fds[1]);
+        ::setenv(child_env, "1", 1);
+        ::execv("/proc/self/exe", args.data());
+        ::_exit(127);
+    }
+    ::close(fds[1]);
+    std::string out;
+    char buf[256];
+    ssize_t n;
+    while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+        out.append(buf, n);
+    }
+    ::close(fds[0]);
+    auto wall = clk::now() - start;
+    int status;
+    ::waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || out.empty()) {
+        throw std::runtime_error(fmt::format("child failed (status {}), output: {}", status, out));
+    }
+    return measurement{std::stod(out), to_ms(wall)};
+}
+
+int main(int ac, char** av) {
+    if (std::getenv(child_env)) {
+        return run_child(ac, av);
+    }
+
+    unsigned runs = 5;
+    std::vector<char*> args{av[0]};
+    for (int i = 1; i < ac; i++) {
+        if (!std::strcmp(av[i], "--runs") && i + 1 < ac) {
+            runs = std::max(1ul, std::stoul(av[++i]));
+        } else {
+            args.push_back(av[i]);
+        }
+    }
+    args.push_back(nullptr);
+
+    std::vector<measurement> results;
+    for (unsigned i = 0; i < runs; i++) {
+        results.push_back(run_once(args));
+        fmt::print("run {}: {:.1f} ms to first task on all shards, {:.1f} ms including exec\n",
+                i, results.back().in_process_ms, results.back().wall_ms);
+    }
+    std::sort(results.begin(), results.end(), [] (const measurement& a, const measurement& b) {
+        return a.in_process_ms < b.in_process_ms;
+    });
+    fmt::print("min {:.1f} ms, median {:.1f} ms, max {:.1f} ms\n",
+            results.front().in_process_ms, results[results.size() / 2].in_process_ms, results.back().in_process_ms);
+    return 0;
+}
@@ -23,8 +23,13 @@
 #include <seastar/core/memory.hh>
 #include <seastar/core/smp.hh>
 #include <seastar/core/temporary_buffer.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/core/with_scheduling_group.hh>
+#include <seastar/util/defer.hh>
+#include <seastar/util/later.hh>
 #include <seastar/util/memory_diagnostics.hh>
 
+#include <utility>
 #include <vector>
 #include <future>
 #include <iostream>
@@ -176,3 +181,128 @@ SEASTAR_TEST_CASE(test_foreign_function_use_glibc_malloc) {
     return make_ready_future<>();
 }
 #endif
+
+SEASTAR_TEST_CASE(test_scheduling_group_memory) {
+#ifdef SEASTAR_DEFAULT_ALLOCATOR
+    return make_ready_future<>();
+#else
+    return seastar::async([] {
+        auto sg = create_scheduling_group("memory", 100).get0();
+        auto destroy = defer([&] { destroy_scheduling_group(sg).get(); });
+        constexpr size_t size = 4 << 20;
+        auto allocate = [&] {
+            return with_scheduling_group(sg, [] { return malloc(size); }).get0();
+        };
+
+        auto before = memory::scheduling_group_memory(sg).allocated_memory;
+        auto p = allocate();
+        BOOST_REQUIRE_GE(memory::scheduling_group_memory(sg).allocated_memory, before + size);
+        free(p);
+        BOOST_REQUIRE_LT(memory::scheduling_group_memory(sg).allocated_memory, before + size);
+
+        bool exceeded = false;
+        memory::set_scheduling_group_memory_soft_limit(sg, before + size / 2, [&] { exceeded = true; });
+        p = allocate();
+        auto stats = memory::scheduling_group_memory(sg);
+        BOOST_REQUIRE(stats.over_soft_limit);
+        BOOST_REQUIRE_EQUAL(stats.soft_limit_exceeded, 1);
+        // The callback runs from a task, not from within the allocator
+        later().get();
+        BOOST_REQUIRE(exceeded);
+        free(p);
+        BOOST_REQUIRE(!memory::scheduling_group_memory(sg).over_soft_limit);
+    });
+#endif
+}
+
+SEASTAR_TEST_CASE(test_remapped_allocation) {
+#ifdef SEASTAR_DEFAULT_ALLOCATOR
+    return make_ready_future<>();
+#else
+    // Fragment memory: take every free span of at least `block` bytes, then
+    // return only the lower buddy of each pair so that none of them merge
+    constexpr size_t block = 512 << 10;
+    constexpr size_t size = 8 * block;
+    std::vector<void*> blocks;
+    while (memory::fragmentation().largest_free_span >= block) {
+        blocks.push_back(malloc(block));
+    }
+    auto release = defer([&] {
+        for (auto b : blocks) {
+            free(b);
+        }
+    });
+    for (auto& b : blocks) {
+        if (reinterpret_cast<uintptr_t>(b) / block % 2 == 0) {
+            free(std::exchange(b, nullptr));
+        }
+    }
+    auto frag = memory::fragmentation();
+    BOOST_REQUIRE_LT(frag.largest_free_span, size);
+    BOOST_REQUIRE_GT(frag.fragmentation, 0);
+    BOOST_REQUIRE_EQUAL(frag.remapped_allocations, 0);
+
+    memory::set_remapped_allocation_threshold(size);
+    auto restore = defer([] { memory::set_remapped_allocation_threshold(1 << 20); });
+    auto p = static_cast<char*>(malloc(size));
+    BOOST_REQUIRE(p);
+    BOOST_REQUIRE_EQUAL(memory::fragmentation().remapped_allocations, 1);
+    BOOST_REQUIRE_GE(malloc_usable_size(p), size);
+    for (size_t i = 0; i < size; ++i) {
+        p[i] = i % 251;
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < size; ++i) {
+        mismatches += p[i] != char(i % 251);
+    }
+    BOOST_REQUIRE_EQUAL(mismatches, 0);
+    free(p);
+    frag = memory::fragmentation();
+    BOOST_REQUIRE_EQUAL(frag.remapped_allocations, 0);
+    BOOST_REQUIRE_EQUAL(frag.remapped_memory, 0);
+    return make_ready_future<>();
+#endif
+}
+
+SEASTAR_TEST_CASE(test_scheduling_group_memory_lifetime) {
+#ifdef SEASTAR_DEFAULT_ALLOCATOR
+    return make_ready_future<>();
+#else
+    return seastar::async([] {
+        constexpr size_t size = 4 << 20;
+        auto sg = create_scheduling_group("memory_lifetime", 100).get0();
+        auto p = with_scheduling_group(sg, [] { return malloc(size); }).get0();
+
+        // A limit below the current usage applies right away
+        memory::set_scheduling_group_memory_soft_limit(sg, size / 2);
+        auto stats = memory::scheduling_group_memory(sg);
+        BOOST_REQUIRE(stats.over_soft_limit);
+        BOOST_REQUIRE_EQUAL(stats.soft_limit_exceeded, 1);
+
+        // Destroying a group hands what is still charged to it to the
+        // default group, which is uncharged when it is freed
+        auto default_before = memory::scheduling_group_memory(default_scheduling_group()).allocated_memory;
+        destroy_scheduling_group(sg).get();
+        BOOST_REQUIRE_GE(memory::scheduling_group_memory(default_scheduling_group()).allocated_memory, default_before + size);
+        free(p);
+        BOOST_REQUIRE_LT(memory::scheduling_group_memory(default_scheduling_group()).allocated_memory, default_before + size);
+
+        // Groups that leave memory behind can be created and destroyed
+        // any number of times; their ids are reused, and a new group
+        // doesn't inherit the charge of an old one with the same id
+        constexpr size_t leftover_size = 1 << 20;
+        std::vector<void*> leftovers;
+        auto free_leftovers = defer([&] {
+            for (auto p : leftovers) {
+                free(p);
+            }
+        });
+        for (unsigned i = 0; i < 2 * max_scheduling_groups(); i++) {
+            auto sg = create_scheduling_group(format("memory_lifetime{}", i), 100).get0();
+            BOOST_REQUIRE_LT(memory::scheduling_group_memory(sg).allocated_memory, leftover_size);
+            leftovers.push_back(with_scheduling_group(sg, [] { return malloc(leftover_size); }).get0());
+            destroy_scheduling_group(sg).get();
+        }
+    });
+#endif
+}
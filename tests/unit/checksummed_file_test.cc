@@ -0,0 +1,177 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/checksummed_file.hh>
+#include <seastar/core/fstream.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/util/crc32c.hh>
+#include <seastar/util/tmp_file.hh>
+#include <seastar/util/closeable.hh>
+#include <array>
+#include <numeric>
+
+using namespace seastar;
+
+SEASTAR_TEST_CASE(test_crc32c_known_values) {
+    // Check values from RFC 3720, appendix B.4, against both the default
+    // and the table-driven implementation
+    for (auto fn : {crc32c, internal::crc32c_portable}) {
+        std::array<uint8_t, 32> buf;
+        buf.fill(0);
+        BOOST_REQUIRE_EQUAL(fn(0, buf.data(), buf.size()), 0x8a9136aa);
+        buf.fill(0xff);
+        BOOST_REQUIRE_EQUAL(fn(0, buf.data(), buf.size()), 0x62a8ab43);
+        for (unsigned i = 0; i < buf.size(); i++) {
+            buf[i] = i;
+        }
+        BOOST_REQUIRE_EQUAL(fn(0, buf.data(), buf.size()), 0x46dd794e);
+        // Incremental computation gives the same result, including over
+        // lengths that are not a multiple of 8
+        BOOST_REQUIRE_EQUAL(fn(fn(0, buf.data(), 13), buf.data() + 13, buf.size() - 13), 0x46dd794e);
+        const char* check = "123456789";
+        BOOST_REQUIRE_EQUAL(fn(0, check, 9), 0xe3069283);
+    }
+
+    std::array<uint8_t, 32> buf;
+    for (unsigned i = 0; i < buf.size(); i++) {
+        buf[i] = i;
+    }
+
+    uint32_t blocks[4];
+    crc32c_blocks(buf.data(), 8, 4, blocks);
+    for (unsigned i = 0; i < 4; i++) {
+        BOOST_REQUIRE_EQUAL(blocks[i], crc32c(0, buf.data() + i * 8, 8));
+    }
+    return make_ready_future<>();
+}
+
+static file open_checksummed(const std::filesystem::path& dir) {
+    auto flags = open_flags::rw | open_flags::create;
+    auto data = open_file_dma((dir / "data").native(), flags).get0();
+    auto checksums = open_file_dma((dir / "data.crc").native(), flags).get0();
+    return make_checksummed_file(std::move(data), std::move(checksums));
+}
+
+static temporary_buffer<char> make_block(file& f, size_t len, char fill) {
+    auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), len);
+    std::fill_n(buf.get_write(), len, fill);
+    return buf;
+}
+
+SEASTAR_TEST_CASE(test_checksummed_file_roundtrip) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto f = open_checksummed(t.get_path());
+        auto close_f = deferred_close(f);
+        constexpr size_t bs = 4096;
+
+        // Leave a hole before the written blocks
+        auto buf = make_block(f, 3 * bs, 'a');
+        std::fill_n(buf.get_write() + bs, bs, 'b');
+        BOOST_REQUIRE_EQUAL(f.dma_write(2 * bs, buf.get(), buf.size()).get0(), buf.size());
+
+        auto all = f.dma_read_bulk<char>(0, 5 * bs).get0();
+        BOOST_REQUIRE_EQUAL(all.size(), 5 * bs);
+        BOOST_REQUIRE(std::all_of(all.begin(), all.begin() + 2 * bs, [] (char c) { return c == 0; }));
+        BOOST_REQUIRE(std::equal(all.begin() + 2 * bs, all.end(), buf.begin()));
+
+        // Unaligned reads verify the blocks they overlap
+        auto part = f.dma_read_bulk<char>(3 * bs - 10, 20).get0();
+        BOOST_REQUIRE_EQUAL(sstring(part.get(), part.size()), sstring(10, 'a') + sstring(10, 'b'));
+
+        BOOST_REQUIRE_THROW(f.dma_write(bs + 512, buf.get(), bs).get(), std::system_error);
+    });
+}
+
+SEASTAR_TEST_CASE(test_checksummed_file_detects_corruption) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        constexpr size_t bs = 4096;
+        {
+            auto f = open_checksummed(t.get_path());
+            auto close_f = deferred_close(f);
+            auto buf = make_block(f, 4 * bs, 'x');
+            f.dma_write(0, buf.get(), buf.size()).get();
+            f.flush().get();
+        }
+
+        // Corrupt the third block behind the checksummed file's back
+        {
+            auto raw = open_file_dma((t.get_path() / "data").native(), open_flags::rw).get0();
+            auto close_raw = deferred_close(raw);
+            auto buf = make_block(raw, bs, 'x');
+            buf.get_write()[100] = 'y';
+            raw.dma_write(2 * bs, buf.get(), buf.size()).get();
+        }
+
+        auto f = open_checksummed(t.get_path());
+        auto close_f = deferred_close(f);
+        f.dma_read_bulk<char>(0, 2 * bs).get();
+        try {
+            f.dma_read_bulk<char>(0, 4 * bs).get();
+            BOOST_FAIL("corruption not detected");
+        } catch (checksum_mismatch_error& e) {
+            BOOST_REQUIRE_EQUAL(e.offset(), 2 * bs);
+        }
+
+        // Rewriting the block repairs it
+        auto buf = make_block(f, bs, 'z');
+        f.dma_write(2 * bs, buf.get(), buf.size()).get();
+        f.dma_read_bulk<char>(0, 4 * bs).get();
+    });
+}
+
+SEASTAR_TEST_CASE(test_checksummed_file_partial_last_block) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        constexpr size_t bs = 4096;
+        // Output streams pad their last write to a whole block and then
+        // truncate the padding away
+        sstring data(2 * bs + 1000, '\0');
+        std::iota(data.begin(), data.end(), 0);
+        {
+            auto f = open_checksummed(t.get_path());
+            auto out = make_file_output_stream(f).get0();
+            out.write(data).get();
+            out.close().get();
+        }
+
+        auto f = open_checksummed(t.get_path());
+        auto close_f = deferred_close(f);
+        BOOST_REQUIRE_EQUAL(f.size().get0(), data.size());
+        auto in = make_file_input_stream(f);
+        auto read = in.read_exactly(data.size() + 1).get0();
+        in.close().get();
+        BOOST_REQUIRE_EQUAL(sstring(read.get(), read.size()), data);
+
+        // Cutting a block with data past the new end re-checksums what is left
+        f.truncate(bs + 100).get();
+        auto head = f.dma_read_bulk<char>(0, 2 * bs).get0();
+        BOOST_REQUIRE_EQUAL(sstring(head.get(), head.size()), data.substr(0, bs + 100));
+
+        // Extending the file again exposes zeroes, which still verify
+        f.truncate(3 * bs).get();
+        auto all = f.dma_read_bulk<char>(0, 3 * bs).get0();
+        BOOST_REQUIRE_EQUAL(all.size(), 3 * bs);
+        BOOST_REQUIRE_EQUAL(sstring(all.get(), bs + 100), data.substr(0, bs + 100));
+        BOOST_REQUIRE(std::all_of(all.begin() + bs + 100, all.end(), [] (char c) { return c == 0; }));
+    });
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/compressed_fstream.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/util/tmp_file.hh>
+#include <seastar/util/closeable.hh>
+#include <random>
+
+using namespace seastar;
+
+// Mixes compressible text with incompressible noise, so that both
+// compressed and stored chunks appear
+static sstring make_data(size_t len) {
+    std::default_random_engine rng(17);
+    std::uniform_int_distribution<int> byte(0, 255);
+    auto data = uninitialized_string(len);
+    for (size_t i = 0; i < len; i++) {
+        bool noise = (i / 10000) % 3 == 2;
+        data[i] = noise ? char(byte(rng)) : "seastar "[i % 8];
+    }
+    return data;
+}
+
+static void write_compressed(const sstring& name, const sstring& data, size_t chunk_size) {
+    auto f = open_file_dma(name, open_flags::wo | open_flags::create | open_flags::truncate).get0();
+    compressed_file_output_stream_options opts;
+    opts.chunk_size = chunk_size;
+    auto out = make_compressed_file_output_stream(std::move(f), opts).get0();
+    // Odd-sized writes, so that they straddle chunks
+    for (size_t pos = 0; pos < data.size(); pos += 3001) {
+        out.write(data.data() + pos, std::min<size_t>(3001, data.size() - pos)).get();
+    }
+    out.close().get();
+}
+
+static sstring read_compressed(file f, uint64_t offset, size_t len) {
+    auto in = make_compressed_file_input_stream(f, offset);
+    auto close_in = deferred_close(in);
+    auto buf = in.read_exactly(len).get0();
+    return sstring(buf.get(), buf.size());
+}
+
+SEASTAR_TEST_CASE(test_compressed_fstream_roundtrip) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto name = (t.get_path() / "data.z").native();
+        auto data = make_data(1000000);
+        write_compressed(name, data, 16384);
+
+        auto f = open_file_dma(name, open_flags::ro).get0();
+        auto close_f = deferred_close(f);
+        BOOST_REQUIRE_LT(f.size().get0(), data.size());
+
+        BOOST_REQUIRE(read_compressed(f, 0, data.size() + 1) == data);
+        for (uint64_t offset : { 1, 16383, 16384, 500000, 999999, 1000000 }) {
+            BOOST_REQUIRE(read_compressed(f, offset, data.size()) == data.substr(offset));
+        }
+
+        auto in = make_compressed_file_input_stream(f, 10);
+        auto close_in = deferred_close(in);
+        BOOST_REQUIRE(sstring(in.read_exactly(5).get0().get(), 5) == data.substr(10, 5));
+        in.skip(100000).get();
+        BOOST_REQUIRE(sstring(in.read_exactly(20000).get0().get(), 20000) == data.substr(100015, 20000));
+        in.skip(3).get();
+        BOOST_REQUIRE(sstring(in.read_exactly(5).get0().get(), 5) == data.substr(120018, 5));
+    });
+}
+
+SEASTAR_TEST_CASE(test_compressed_fstream_empty_and_malformed) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto name = (t.get_path() / "empty.z").native();
+        write_compressed(name, "", 4096);
+        auto f = open_file_dma(name, open_flags::ro).get0();
+        auto close_f = deferred_close(f);
+        BOOST_REQUIRE(read_compressed(f, 0, 10).empty());
+
+        auto plain_name = (t.get_path() / "plain").native();
+        auto plain = open_file_dma(plain_name, open_flags::wo | open_flags::create).get0();
+        auto out = make_file_output_stream(std::move(plain)).get0();
+        out.write(make_data(100000)).get();
+        out.close().get();
+        auto pf = open_file_dma(plain_name, open_flags::ro).get0();
+        auto close_pf = deferred_close(pf);
+        BOOST_REQUIRE_THROW(read_compressed(pf, 0, 10), std::runtime_error);
+    });
+}
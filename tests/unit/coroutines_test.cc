@@ -21,6 +21,7 @@
 
 #include <seastar/core/future-util.hh>
 #include <seastar/testing/test_case.hh>
+#include <seastar/util/exceptions.hh>
 
 using namespace seastar;
 
@@ -170,4 +171,44 @@ SEASTAR_TEST_CASE(test_preemption) {
     BOOST_REQUIRE(save_x);
     co_return;
 }
+
+SEASTAR_TEST_CASE(test_as_future) {
+    auto f = co_await coroutine::as_future(failing_coroutine());
+    BOOST_REQUIRE(f.failed());
+    auto ex = f.get_exception();
+    BOOST_REQUIRE(try_catch<int>(ex) != nullptr);
+    BOOST_REQUIRE_EQUAL(*try_catch<int>(ex), 42);
+
+    auto g = co_await coroutine::as_future(simple_coroutine());
+    BOOST_REQUIRE(!g.failed());
+    BOOST_REQUIRE_EQUAL(g.get0(), 53);
+}
+
+namespace {
+
+future<int> exception_returning_coroutine(bool fail) {
+    co_await later();
+    if (fail) {
+        co_return coroutine::exception(std::make_exception_ptr(std::runtime_error("failed")));
+    }
+    co_return 1;
+}
+
+future<> exception_returning_void_coroutine(bool& reached_end) {
+    co_await later();
+    co_await coroutine::return_exception(std::make_exception_ptr(std::runtime_error("failed")));
+    reached_end = true;
+}
+
+}
+
+SEASTAR_TEST_CASE(test_return_exception) {
+    BOOST_REQUIRE_EQUAL(co_await exception_returning_coroutine(false), 1);
+    BOOST_REQUIRE_THROW(co_await exception_returning_coroutine(true), std::runtime_error);
+
+    bool reached_end = false;
+    auto f = co_await coroutine::as_future(exception_returning_void_coroutine(reached_end));
+    BOOST_REQUIRE(try_catch<std::runtime_error>(f.get_exception()) != nullptr);
+    BOOST_REQUIRE(!reached_end);
+}
 #endif
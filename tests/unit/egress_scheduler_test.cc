@@ -0,0 +1,119 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/when_all.hh>
+#include <seastar/core/with_scheduling_group.hh>
+#include <seastar/util/defer.hh>
+#include <seastar/core/reactor.hh>
+#include "net/egress_scheduler.hh"
+#include "loopback_socket.hh"
+#include <chrono>
+
+using namespace seastar;
+using namespace std::chrono_literals;
+
+SEASTAR_THREAD_TEST_CASE(test_egress_pacing) {
+    const uint64_t bandwidth = 16 << 20;
+    net::egress_scheduler sched(bandwidth);
+
+    // 4MB at 16MB/s takes a quarter of a second, less the initial burst
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 64; i++) {
+        sched.admit(64 << 10).get();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    BOOST_REQUIRE(elapsed >= 200ms);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_egress_sharing) {
+    auto sg1 = create_scheduling_group("egress1", 100).get0();
+    auto ksg1 = defer([&] { destroy_scheduling_group(sg1).get(); });
+    auto sg2 = create_scheduling_group("egress2", 300).get0();
+    auto ksg2 = defer([&] { destroy_scheduling_group(sg2).get(); });
+
+    // The burst is 64k, so 16 writes fit on the virtual link at once
+    net::egress_scheduler sched(16 << 20);
+    const unsigned writes = 400;
+    std::vector<future<>> admitted;
+    for (unsigned i = 0; i < writes; i++) {
+        admitted.push_back(sched.admit(4096, sg1));
+        admitted.push_back(sched.admit(4096, sg2));
+    }
+
+    // Both groups stay backlogged for these rounds
+    for (int i = 0; i < 25; i++) {
+        net::egress_scheduler_tester::complete_in_flight(sched);
+    }
+    auto bytes1 = sched.admitted_bytes(sg1);
+    auto bytes2 = sched.admitted_bytes(sg2);
+    BOOST_TEST_MESSAGE(format("{} vs {} bytes", bytes1, bytes2));
+    BOOST_REQUIRE_GT(bytes1, 0);
+    BOOST_REQUIRE_LT(bytes2, writes * 4096);
+    auto ratio = double(bytes2) / bytes1;
+    BOOST_REQUIRE(ratio > 2.8 && ratio < 3.2);
+
+    while (sched.admitted_bytes(sg1) + sched.admitted_bytes(sg2) < 2 * writes * 4096) {
+        net::egress_scheduler_tester::complete_in_flight(sched);
+    }
+    when_all_succeed(admitted.begin(), admitted.end()).get();
+}
+
+// Runs with --network-egress-bandwidth, so connected sockets are metered.
+// The flush is batched and reaches the socket from the flush poller; the
+// write must still be charged to the group that issued it.
+SEASTAR_THREAD_TEST_CASE(test_egress_socket_write_group) {
+    auto sched = engine().network_egress_scheduler();
+    BOOST_REQUIRE(sched);
+    auto sg = create_scheduling_group("egress_socket", 200).get0();
+    auto ksg = defer([&] { destroy_scheduling_group(sg).get(); });
+
+    loopback_connection_factory lcf;
+    loopback_socket_impl lsi(lcf);
+    auto ss = lcf.get_server_socket();
+    auto accepted = ss.accept();
+    auto client = lsi.connect(socket_address(ipv4_addr()), socket_address(ipv4_addr())).get0();
+    auto server = accepted.get0().connection;
+
+    auto main_bytes = sched->admitted_bytes(default_scheduling_group());
+    auto out = client.output();
+    with_scheduling_group(sg, [&out] {
+        return out.write(sstring(1000, 'x')).then([&out] {
+            return out.flush();
+        });
+    }).get();
+
+    auto in = server.input();
+    size_t received = 0;
+    while (received < 1000) {
+        auto buf = in.read().get0();
+        BOOST_REQUIRE(!buf.empty());
+        received += buf.size();
+    }
+    BOOST_REQUIRE_EQUAL(sched->admitted_bytes(sg), 1000u);
+    BOOST_REQUIRE_EQUAL(sched->admitted_bytes(default_scheduling_group()), main_bytes);
+
+    out.close().get();
+    in.close().get();
+    lcf.destroy_all_shards().get();
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/encrypted_file.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/util/tmp_file.hh>
+#include <seastar/util/closeable.hh>
+
+using namespace seastar;
+
+static std::vector<uint8_t> make_key(uint8_t seed) {
+    std::vector<uint8_t> key(64);
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = seed + i * 7;
+    }
+    return key;
+}
+
+SEASTAR_TEST_CASE(test_encrypted_file_roundtrip) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        constexpr size_t bs = 4096;
+        auto name = (t.get_path() / "data").native();
+        auto raw = open_file_dma(name, open_flags::rw | open_flags::create).get0();
+        auto f = make_encrypted_file(raw, make_key(1));
+        auto close_f = deferred_close(f);
+
+        // Identical plaintext blocks
+        auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), 4 * bs);
+        std::fill_n(buf.get_write(), buf.size(), 's');
+        BOOST_REQUIRE_EQUAL(f.dma_write(0, buf.get(), buf.size()).get0(), buf.size());
+        BOOST_REQUIRE_THROW(f.dma_write(512, buf.get(), bs).get(), std::system_error);
+
+        auto in = temporary_buffer<char>::aligned(f.memory_dma_alignment(), 4 * bs);
+        BOOST_REQUIRE_EQUAL(f.dma_read(0, in.get_write(), in.size()).get0(), in.size());
+        BOOST_REQUIRE(std::equal(in.begin(), in.end(), buf.begin()));
+
+        auto part = f.dma_read_bulk<char>(bs - 3, 6).get0();
+        BOOST_REQUIRE_EQUAL(sstring(part.get(), part.size()), "ssssss");
+
+        // On disk, nothing looks like the plaintext, and equal plaintext
+        // blocks encrypt differently
+        auto ct = raw.dma_read_bulk<char>(0, 4 * bs).get0();
+        BOOST_REQUIRE_EQUAL(ct.size(), 4 * bs);
+        BOOST_REQUIRE(std::count(ct.begin(), ct.end(), 's') < 100);
+        BOOST_REQUIRE(!std::equal(ct.begin(), ct.begin() + bs, ct.begin() + bs));
+
+        // A different key doesn't decrypt it
+        auto raw2 = open_file_dma(name, open_flags::ro).get0();
+        auto f2 = make_encrypted_file(raw2, make_key(2));
+        auto close_f2 = deferred_close(f2);
+        auto wrong = f2.dma_read_bulk<char>(0, bs).get0();
+        BOOST_REQUIRE(!std::equal(wrong.begin(), wrong.end(), buf.begin()));
+    });
+}
+
+SEASTAR_TEST_CASE(test_encrypted_file_bad_key) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto raw = open_file_dma((t.get_path() / "data").native(), open_flags::rw | open_flags::create).get0();
+        auto close_raw = deferred_close(raw);
+        BOOST_REQUIRE_THROW(make_encrypted_file(raw, std::vector<uint8_t>(16)), std::invalid_argument);
+        auto key = make_key(1);
+        std::copy_n(key.begin(), 32, key.begin() + 32);
+        BOOST_REQUIRE_THROW(make_encrypted_file(raw, std::move(key)), std::invalid_argument);
+    });
+}
+
+SEASTAR_TEST_CASE(test_encrypted_file_holes) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        constexpr size_t bs = 4096;
+        auto raw = open_file_dma((t.get_path() / "data").native(), open_flags::rw | open_flags::create).get0();
+        auto f = make_encrypted_file(raw, make_key(1));
+        auto close_f = deferred_close(f);
+
+        // Block 1 is never written
+        auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), bs);
+        std::fill_n(buf.get_write(), buf.size(), 's');
+        f.dma_write(0, buf.get(), bs).get();
+        f.dma_write(2 * bs, buf.get(), bs).get();
+        f.truncate(4 * bs).get();
+
+        auto in = f.dma_read_bulk<char>(0, 4 * bs).get0();
+        BOOST_REQUIRE_EQUAL(in.size(), 4 * bs);
+        BOOST_REQUIRE(std::all_of(in.begin(), in.begin() + bs, [] (char c) { return c == 's'; }));
+        BOOST_REQUIRE(std::all_of(in.begin() + bs, in.begin() + 2 * bs, [] (char c) { return c == 0; }));
+        BOOST_REQUIRE(std::all_of(in.begin() + 2 * bs, in.begin() + 3 * bs, [] (char c) { return c == 's'; }));
+        BOOST_REQUIRE(std::all_of(in.begin() + 3 * bs, in.end(), [] (char c) { return c == 0; }));
+    });
+}
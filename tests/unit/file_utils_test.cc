@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <set>
 
 #include <seastar/testing/test_case.hh>
 #include <seastar/testing/thread_test_case.hh>
@@ -289,3 +290,42 @@ SEASTAR_TEST_CASE(tmp_dir_do_with_thread_fail_remove_test) {
         set_default_tmpdir(saved_default_tmpdir.c_str());
     });
 }
+
+SEASTAR_TEST_CASE(test_scan_directory_tree) {
+    return tmp_dir::do_with_thread([] (tmp_dir& td) {
+        const fs::path& base = td.get_path();
+        std::set<fs::path> expected;
+        for (auto d : { "a", "a/b", "a/b/c", "d" }) {
+            touch_directory((base / d).native()).get();
+            expected.insert(base / d);
+            for (auto i = 0; i < 3; i++) {
+                auto name = base / d / format("file-{}", i).c_str();
+                touch_file(name.native()).get();
+                expected.insert(name);
+            }
+        }
+
+        std::set<fs::path> found;
+        auto opts = directory_scan_options{};
+        opts.stat_batch_size = 2;
+        scan_directory_tree(base, [&] (scanned_entry e) {
+            BOOST_REQUIRE(found.count(e.path.parent_path()) || e.path.parent_path() == base);
+            if (e.stat.type == directory_entry_type::regular) {
+                BOOST_REQUIRE_EQUAL(e.stat.size, 0u);
+            } else {
+                BOOST_REQUIRE(e.stat.type == directory_entry_type::directory);
+            }
+            found.insert(std::move(e.path));
+            return make_ready_future<>();
+        }, opts).get();
+        BOOST_REQUIRE(found == expected);
+
+        BOOST_REQUIRE_THROW(scan_directory_tree(base, [] (scanned_entry) {
+            return make_exception_future<>(expected_exception());
+        }).get(), expected_exception);
+
+        BOOST_REQUIRE_THROW(scan_directory_tree(base / "non-existing", [] (scanned_entry) {
+            return make_ready_future<>();
+        }).get(), std::system_error);
+    });
+}
@@ -26,6 +26,7 @@
 #include <seastar/core/thread.hh>
 #include <seastar/core/sleep.hh>
 #include <iostream>
+#include <numeric>
 
 using namespace seastar;
 
@@ -130,3 +131,41 @@ SEASTAR_TEST_CASE(foreign_ptr_move_assignment_test) {
     });
 }
 
+
+SEASTAR_TEST_CASE(foreign_ptr_batched_destroy_test) {
+    if (smp::count == 1) {
+        std::cerr << "Skipping multi-cpu foreign_ptr tests. Run with --smp=2 to test multi-cpu delete and reset.";
+        return make_ready_future<>();
+    }
+
+    static thread_local std::vector<unsigned> destroyed;
+    struct tracked {
+        unsigned idx;
+        explicit tracked(unsigned idx) : idx(idx) { }
+        ~tracked() { destroyed.push_back(idx); }
+    };
+    constexpr unsigned count = 10000;
+
+    return seastar::async([] {
+        auto ptrs = smp::submit_to(1, [] {
+            destroyed.clear();
+            std::vector<foreign_ptr<std::unique_ptr<tracked>>> ptrs;
+            for (unsigned i = 0; i < count; i++) {
+                ptrs.push_back(make_foreign(std::make_unique<tracked>(i)));
+            }
+            return ptrs;
+        }).get0();
+        ptrs.clear();
+
+        using namespace std::chrono_literals;
+        std::vector<unsigned> order;
+        while (order.size() < count) {
+            seastar::sleep(1ms).get();
+            order = smp::submit_to(1, [] { return destroyed; }).get0();
+        }
+        // Objects released by one shard are destroyed in the order they were released
+        std::vector<unsigned> expected(count);
+        std::iota(expected.begin(), expected.end(), 0);
+        BOOST_REQUIRE(order == expected);
+    });
+}
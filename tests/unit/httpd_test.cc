@@ -10,7 +10,9 @@
 #include <seastar/http/routes.hh>
 #include <seastar/http/exception.hh>
 #include <seastar/http/transformers.hh>
+#include <seastar/http/file_handler.hh>
 #include <seastar/core/do_with.hh>
+#include <seastar/core/fstream.hh>
 #include <seastar/core/loop.hh>
 #include <seastar/core/when_all.hh>
 #include <seastar/testing/test_case.hh>
@@ -20,6 +22,7 @@
 #include <seastar/core/thread.hh>
 #include <seastar/util/noncopyable_function.hh>
 #include <seastar/http/json_path.hh>
+#include <seastar/util/tmp_file.hh>
 #include <sstream>
 
 using namespace seastar;
@@ -244,6 +247,119 @@ SEASTAR_TEST_CASE(test_routes) {
     });
 }
 
+SEASTAR_TEST_CASE(test_route_stats) {
+    match_rule mr(nullptr);
+    mr.add_str("/file").add_param("path", true);
+    BOOST_REQUIRE_EQUAL(mr.pattern(), "/file/{path}");
+
+    auto route = std::make_unique<routes>();
+    route->put(operation_type::GET, "/exact", new handl());
+    route->enable_metrics("test_route_stats");
+    BOOST_REQUIRE(route->get_route_stats("GET", "/exact"));
+
+    // Two rules that render the same label share their statistics
+    auto rule = [] {
+        auto r = new match_rule(new handl());
+        r->add_str("/api").add_param("path", true);
+        return r;
+    };
+    auto c1 = route->add_cookie(rule(), operation_type::POST);
+    auto c2 = route->add_cookie(rule(), operation_type::POST);
+    auto stats = route->get_route_stats("POST", "/api/{path}");
+    BOOST_REQUIRE(stats);
+
+    auto req = std::make_unique<request>();
+    req->_method = "POST";
+    req->content_length = 100;
+    return route->handle("/api/abc", std::move(req), std::make_unique<reply>()).then([&route = *route, stats, c1, c2] (std::unique_ptr<reply> rep) {
+        BOOST_REQUIRE_EQUAL((int )rep->_status, (int )reply::status_type::ok);
+        BOOST_REQUIRE_EQUAL(stats->requests(), 1u);
+
+        // The statistics are dropped with the last rule using them
+        delete route.del_cookie(c1, operation_type::POST);
+        BOOST_REQUIRE_EQUAL(route.get_route_stats("POST", "/api/{path}"), stats);
+        delete route.del_cookie(c2, operation_type::POST);
+        BOOST_REQUIRE(!route.get_route_stats("POST", "/api/{path}"));
+        delete route.drop(operation_type::GET, "/exact");
+        BOOST_REQUIRE(!route.get_route_stats("GET", "/exact"));
+    }).finally([route = std::move(route)] {});
+}
+
+SEASTAR_TEST_CASE(test_parse_range) {
+    using byte_range = file_interaction_handler::byte_range;
+    auto parse = [] (const sstring& value) {
+        return file_interaction_handler::parse_range(value, 1000);
+    };
+    auto check = [] (const std::optional<std::vector<byte_range>>& ranges, std::vector<std::pair<uint64_t, uint64_t>> expected) {
+        BOOST_REQUIRE(ranges);
+        BOOST_REQUIRE_EQUAL(ranges->size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            BOOST_REQUIRE_EQUAL((*ranges)[i].first, expected[i].first);
+            BOOST_REQUIRE_EQUAL((*ranges)[i].last, expected[i].second);
+        }
+    };
+    check(parse("bytes=0-99"), {{0, 99}});
+    check(parse("bytes=900-"), {{900, 999}});
+    check(parse("bytes=-100"), {{900, 999}});
+    check(parse("bytes=-5000"), {{0, 999}});
+    check(parse("bytes=0-0, 500-2000"), {{0, 0}, {500, 999}});
+    check(parse("bytes=1000-"), {});
+    BOOST_REQUIRE(!parse("items=0-99"));
+    BOOST_REQUIRE(!parse("bytes=99-0"));
+    BOOST_REQUIRE(!parse("bytes=abc"));
+    BOOST_REQUIRE(!parse("bytes=0-1,2-3,4-5,6-7,8-9,10-11,12-13,14-15,16-17,18-19,20-21,22-23,24-25,26-27,28-29,30-31,32-33"));
+    return make_ready_future<>();
+}
+
+SEASTAR_THREAD_TEST_CASE(test_file_handler_conditional_and_range) {
+    tmp_dir::do_with_thread([] (tmp_dir& td) {
+        auto path = (td.get_path() / "file.txt").native();
+        auto f = open_file_dma(path, open_flags::wo | open_flags::create).get0();
+        auto out = make_file_output_stream(std::move(f)).get0();
+        out.write(sstring(1000, 'x')).get();
+        out.close().get();
+
+        file_handler fh(path, nullptr, false);
+        auto get = [&fh] (std::unordered_map<sstring, sstring> headers) {
+            auto req = std::make_unique<request>();
+            req->_method = "GET";
+            for (auto& h : headers) {
+                req->_headers[h.first] = h.second;
+            }
+            return fh.handle("", std::move(req), std::make_unique<reply>()).get0();
+        };
+
+        auto rep = get({});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::ok);
+        auto etag = rep->_headers["ETag"];
+        auto last_modified = rep->_headers["Last-Modified"];
+        BOOST_REQUIRE(!etag.empty());
+        BOOST_REQUIRE(!last_modified.empty());
+        BOOST_REQUIRE_EQUAL(rep->_headers["Accept-Ranges"], "bytes");
+
+        rep = get({{"If-None-Match", "\"other\", " + etag}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::not_modified);
+        rep = get({{"If-Modified-Since", last_modified}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::not_modified);
+        rep = get({{"If-None-Match", "\"other\""}, {"If-Modified-Since", last_modified}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::ok);
+
+        rep = get({{"Range", "bytes=100-199"}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::partial_content);
+        BOOST_REQUIRE_EQUAL(rep->_headers["Content-Range"], "bytes 100-199/1000");
+        rep = get({{"Range", "bytes=0-9,-10"}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::partial_content);
+        BOOST_REQUIRE(rep->_headers["Content-Type"].find("multipart/byteranges; boundary=") == 0);
+        rep = get({{"Range", "bytes=5000-"}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::range_not_satisfiable);
+        BOOST_REQUIRE_EQUAL(rep->_headers["Content-Range"], "bytes */1000");
+        rep = get({{"Range", "bytes=100-199"}, {"If-Range", "\"other\""}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::ok);
+        rep = get({{"Range", "bytes=100-199"}, {"If-Range", etag}});
+        BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::partial_content);
+    }).get();
+}
+
 SEASTAR_TEST_CASE(test_json_path) {
     shared_ptr<bool> res1 = make_shared<bool>(false);
     shared_ptr<bool> res2 = make_shared<bool>(false);
@@ -370,6 +486,64 @@ SEASTAR_TEST_CASE(test_transformer) {
     });
 }
 
+SEASTAR_THREAD_TEST_CASE(test_file_handler_range_body) {
+    tmp_dir::do_with_thread([] (tmp_dir& td) {
+        // Large enough for ranges to span several 128KB read chunks
+        constexpr size_t size = 300 * 1024;
+        std::string content(size, 0);
+        for (size_t i = 0; i < size; i++) {
+            content[i] = 'a' + (i * 7) % 26;
+        }
+        auto path = (td.get_path() / "file.txt").native();
+        auto f = open_file_dma(path, open_flags::wo | open_flags::create).get0();
+        auto out = make_file_output_stream(std::move(f)).get0();
+        out.write(content.data(), content.size()).get();
+        out.close().get();
+
+        file_handler fh(path, nullptr, false);
+        auto get_body = [&fh] (sstring range, std::unique_ptr<reply>& rep) {
+            auto req = std::make_unique<request>();
+            req->_method = "GET";
+            req->_headers["Range"] = range;
+            rep = fh.handle("", std::move(req), std::make_unique<reply>()).get0();
+            BOOST_REQUIRE_EQUAL((int)rep->_status, (int)reply::status_type::partial_content);
+            auto& body_writer = httpd::reply_tester::body_writer(*rep);
+            BOOST_REQUIRE(body_writer);
+            std::stringstream ss;
+            output_stream_options opts;
+            opts.trim_to_size = true;
+            body_writer(output_stream<char>(memory_data_sink(ss), 32000, opts)).get();
+            return ss.str();
+        };
+        auto slice = [&content] (size_t first, size_t last) {
+            return content.substr(first, last - first + 1);
+        };
+
+        std::unique_ptr<reply> rep;
+        BOOST_REQUIRE_EQUAL(get_body("bytes=100-199", rep), slice(100, 199));
+        BOOST_REQUIRE_EQUAL(rep->_headers["Content-Range"], format("bytes 100-199/{}", size));
+
+        // Unaligned at both ends, crossing the 128KB and 256KB boundaries
+        BOOST_REQUIRE_EQUAL(get_body("bytes=100001-270001", rep), slice(100001, 270001));
+        BOOST_REQUIRE_EQUAL(rep->_headers["Content-Range"], format("bytes 100001-270001/{}", size));
+
+        auto body = get_body("bytes=0-9,131070-131080,-10", rep);
+        static const sstring prefix = "multipart/byteranges; boundary=";
+        auto content_type = rep->_headers["Content-Type"];
+        BOOST_REQUIRE(content_type.find(prefix) == 0);
+        auto boundary = content_type.substr(prefix.size());
+        BOOST_REQUIRE(!boundary.empty());
+        std::string expected;
+        for (auto r : std::vector<std::pair<size_t, size_t>>{{0, 9}, {131070, 131080}, {size - 10, size - 1}}) {
+            expected += format("\r\n--{}\r\nContent-Type: text/plain\r\nContent-Range: bytes {}-{}/{}\r\n\r\n",
+                    boundary, r.first, r.second, size);
+            expected += slice(r.first, r.second);
+        }
+        expected += format("\r\n--{}--\r\n", boundary);
+        BOOST_REQUIRE_EQUAL(body, expected);
+    }).get();
+}
+
 struct http_consumer {
     std::map<sstring, std::string> _headers;
     std::string _body;
@@ -959,6 +1133,36 @@ future<> check_http_reply (std::vector<sstring>&& req_parts, std::vector<std::st
     });
 };
 
+SEASTAR_THREAD_TEST_CASE(test_arrival_latency) {
+    // Receive timestamps need a real socket, loopback ones don't carry them
+    http_server server("test");
+    server.set_receive_timestamps(true);
+    server._routes.put(GET, "/test", new handl());
+    listen_options lo;
+    lo.reuse_address = true;
+    auto& listeners = httpd::http_server_tester::listeners(server);
+    listeners.push_back(seastar::listen(ipv4_addr("127.0.0.1", 0), lo));
+    auto addr = listeners.back().local_address();
+    server.do_accepts(0).get();
+
+    connected_socket c_socket = seastar::connect(addr).get0();
+    input_stream<char> input(c_socket.input());
+    output_stream<char> output(c_socket.output());
+    for (int i = 0; i < 2; i++) {
+        output.write(sstring("GET /test HTTP/1.1\r\nHost: test\r\n\r\n")).get();
+        output.flush().get();
+        auto resp = input.read().get0();
+        BOOST_REQUIRE_NE(std::string(resp.get(), resp.size()).find("200 OK"), std::string::npos);
+    }
+    input.close().get();
+    output.close().get();
+    server.stop().get();
+
+    auto h = server.arrival_latency().get();
+    BOOST_REQUIRE_EQUAL(h.sample_count, 2);
+    BOOST_REQUIRE_EQUAL(h.buckets.back().count, 2);
+}
+
 SEASTAR_TEST_CASE(test_streamed_content) {
     return seastar::async([] {
         loopback_connection_factory lcf;
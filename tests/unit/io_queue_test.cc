@@ -218,3 +218,84 @@ SEASTAR_THREAD_TEST_CASE(test_io_cancellation) {
 
     when_all_succeed(finished.begin(), finished.end()).get();
 }
+
+SEASTAR_THREAD_TEST_CASE(test_io_cancellation_in_flight) {
+    io_queue_for_tests tio;
+    fake_file<3> file;
+    int val = 42;
+
+    auto intent = std::make_unique<io_intent>();
+    auto f0 = tio.queue.queue_request(default_priority_class(), 0, file.make_write_req(0, &val), intent.get());
+    auto f1 = tio.queue.queue_request(default_priority_class(), 0, file.make_write_req(1, &val), intent.get());
+    tio.queue.poll_io_queue();
+
+    // The first request reaches the "kernel", which doesn't know how to
+    // cancel it, the second one is still in the sink
+    io_completion* executing = nullptr;
+    tio.sink.drain([&executing] (internal::io_request& rq, io_completion* desc) -> bool {
+        if (executing != nullptr) {
+            return false;
+        }
+        executing = desc;
+        return true;
+    });
+    BOOST_REQUIRE(executing != nullptr);
+
+    // Moving the intent must keep the in-flight requests attached to it
+    io_intent moved(std::move(*intent));
+    intent.reset();
+    moved.cancel();
+
+    BOOST_REQUIRE(f1.available());
+    BOOST_REQUIRE_THROW(f1.get(), cancelled_error);
+    BOOST_REQUIRE(!f0.available());
+
+    size_t drained = tio.sink.drain([] (internal::io_request& rq, io_completion* desc) -> bool {
+        BOOST_FAIL("cancelled request drained");
+        return true;
+    });
+    BOOST_REQUIRE_EQUAL(drained, 0);
+
+    executing->complete_with(sizeof(int));
+    BOOST_REQUIRE_EQUAL(f0.get0(), sizeof(int));
+
+    // Destroying the intent cancels the in-flight requests too
+    auto f2 = std::optional<future<size_t>>();
+    {
+        io_intent scoped;
+        f2 = tio.queue.queue_request(default_priority_class(), 0, file.make_write_req(2, &val), &scoped);
+        tio.queue.poll_io_queue();
+    }
+    BOOST_REQUIRE_THROW(f2->get(), cancelled_error);
+    BOOST_REQUIRE_EQUAL(file.data[2], 0);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_discard_coalescing) {
+    io_queue_for_tests tio;
+    auto& pc = discard_priority_class();
+
+    // Adjacent discards queued together reach the disk as one request
+    auto f1 = tio.queue.queue_discard(pc, internal::io_request::make_discard(0, 4096, 4096));
+    auto f2 = tio.queue.queue_discard(pc, internal::io_request::make_discard(0, 8192, 4096));
+    auto f3 = tio.queue.queue_discard(pc, internal::io_request::make_discard(0, 0, 4096));
+    // ... but discards of other files don't merge with them
+    auto f4 = tio.queue.queue_discard(pc, internal::io_request::make_discard(1, 12288, 4096));
+
+    std::vector<std::pair<int, std::pair<uint64_t, size_t>>> seen;
+    tio.queue.poll_io_queue();
+    tio.sink.drain([&seen] (internal::io_request& rq, io_completion* desc) -> bool {
+        BOOST_REQUIRE(rq.is_discard());
+        seen.emplace_back(rq.fd(), std::make_pair(rq.pos(), rq.size()));
+        desc->complete_with(0);
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(seen.size(), 2);
+    std::sort(seen.begin(), seen.end());
+    BOOST_REQUIRE_EQUAL(seen[0].first, 0);
+    BOOST_REQUIRE_EQUAL(seen[0].second.first, 0);
+    BOOST_REQUIRE_EQUAL(seen[0].second.second, 3 * 4096);
+    BOOST_REQUIRE_EQUAL(seen[1].first, 1);
+
+    when_all_succeed(std::move(f1), std::move(f2), std::move(f3), std::move(f4)).discard_result().get();
+}
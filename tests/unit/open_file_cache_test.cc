@@ -0,0 +1,128 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/open_file_cache.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/util/tmp_file.hh>
+#include <seastar/util/closeable.hh>
+#include <unistd.h>
+
+using namespace seastar;
+using namespace std::chrono_literals;
+
+static void write_file(const sstring& name, char c) {
+    auto f = open_file_dma(name, open_flags::wo | open_flags::create | open_flags::truncate).get0();
+    auto close_f = deferred_close(f);
+    auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), f.disk_write_dma_alignment());
+    std::fill_n(buf.get_write(), buf.size(), c);
+    f.dma_write(0, buf.get(), buf.size()).get();
+}
+
+static char first_byte(file f) {
+    auto close_f = deferred_close(f);
+    return f.dma_read_bulk<char>(0, 1).get0()[0];
+}
+
+SEASTAR_TEST_CASE(test_open_file_cache_reuse_and_eviction) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        open_file_cache_config cfg;
+        cfg.max_open_files = 2;
+        open_file_cache cache(cfg);
+        auto close_cache = deferred_close(cache);
+        std::vector<sstring> names;
+        for (char c : { 'a', 'b', 'c' }) {
+            names.push_back((t.get_path() / sstring(1, c)).native());
+            write_file(names.back(), c);
+        }
+
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(names[0], open_flags::ro).get0()), 'a');
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(names[0], open_flags::ro).get0()), 'a');
+        BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 1);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().hits, 1);
+
+        // Concurrent users share the descriptor
+        auto f1 = cache.open(names[1], open_flags::ro).get0();
+        auto f2 = cache.open(names[1], open_flags::ro).get0();
+        BOOST_REQUIRE_EQUAL(cache.get_stats().open_files, 2);
+
+        // Going over budget evicts the idle 'a', not the busy 'b'
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(names[2], open_flags::ro).get0()), 'c');
+        BOOST_REQUIRE_EQUAL(cache.get_stats().evictions, 1);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().open_files, 2);
+        BOOST_REQUIRE_EQUAL(first_byte(f1), 'b');
+        BOOST_REQUIRE_EQUAL(first_byte(f2), 'b');
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(names[0], open_flags::ro).get0()), 'a');
+        BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 4);
+
+        BOOST_REQUIRE_THROW(cache.open((t.get_path() / "nonexistent").native(), open_flags::ro).get(), std::system_error);
+    });
+}
+
+SEASTAR_TEST_CASE(test_open_file_cache_side_effect_flags) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        open_file_cache cache;
+        auto close_cache = deferred_close(cache);
+        auto name = (t.get_path() / "f").native();
+        write_file(name, 'a');
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(name, open_flags::rw).get0()), 'a');
+
+        // Not served by the cached descriptor, so the flags take effect
+        BOOST_REQUIRE_THROW(cache.open(name, open_flags::rw | open_flags::create | open_flags::exclusive).get(), std::system_error);
+        auto f = cache.open(name, open_flags::rw | open_flags::truncate).get0();
+        BOOST_REQUIRE_EQUAL(f.size().get0(), 0);
+        f.close().get();
+        BOOST_REQUIRE_EQUAL(cache.get_stats().bypasses, 2);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 1);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().hits, 0);
+    });
+}
+
+SEASTAR_TEST_CASE(test_open_file_cache_invalidation) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        open_file_cache cache;
+        auto close_cache = deferred_close(cache);
+        auto name = (t.get_path() / "f").native();
+        auto other = (t.get_path() / "g").native();
+        write_file(name, 'a');
+        write_file(other, 'b');
+
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(name, open_flags::ro).get0()), 'a');
+        cache.rename_file(other, name).get();
+        BOOST_REQUIRE_EQUAL(first_byte(cache.open(name, open_flags::ro).get0()), 'b');
+
+        // Changes behind the cache's back are picked up through inotify
+        cache.watch_directory(t.get_path().native()).get();
+        write_file(other, 'c');
+        ::rename(other.c_str(), name.c_str());
+        auto deadline = lowres_clock::now() + 10s;
+        while (first_byte(cache.open(name, open_flags::ro).get0()) != 'c') {
+            BOOST_REQUIRE(lowres_clock::now() < deadline);
+            sleep(10ms).get();
+        }
+
+        cache.remove_file(name).get();
+        BOOST_REQUIRE_THROW(cache.open(name, open_flags::ro).get(), std::system_error);
+    });
+}
@@ -0,0 +1,133 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#include <seastar/core/with_request_context.hh>
+#include <seastar/core/execution_stage.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/util/later.hh>
+
+using namespace seastar;
+using namespace std::chrono_literals;
+
+#ifdef SEASTAR_REQUEST_CONTEXT
+
+SEASTAR_THREAD_TEST_CASE(test_continuations_inherit_request_context) {
+    auto ctx = new_request_context();
+    BOOST_REQUIRE(ctx);
+    BOOST_REQUIRE(!current_request_context());
+    auto f = with_request_context(ctx, [] {
+        return later().then([] {
+            return sleep(1ms);
+        }).then([] {
+            return current_request_context();
+        });
+    });
+    BOOST_REQUIRE(!current_request_context());
+    BOOST_REQUIRE(f.get0() == ctx);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_request_context_crosses_shards) {
+    auto ctx = new_request_context();
+    auto remote = with_request_context(ctx, [] {
+        return smp::submit_to((this_shard_id() + 1) % smp::count, [] {
+            return later().then([] {
+                return current_request_context();
+            });
+        });
+    }).get0();
+    BOOST_REQUIRE(remote == ctx);
+}
+
+#endif
+
+SEASTAR_THREAD_TEST_CASE(test_request_context_through_execution_stage) {
+    auto stage = make_execution_stage("request_context", [] {
+        return current_request_context();
+    });
+    auto ctx1 = new_request_context();
+    auto ctx2 = new_request_context();
+    auto f1 = with_request_context(ctx1, [&] { return stage(); });
+    auto f2 = with_request_context(ctx2, [&] { return stage(); });
+    BOOST_REQUIRE(f1.get0() == ctx1);
+    BOOST_REQUIRE(f2.get0() == ctx2);
+}
+
+#ifdef SEASTAR_REQUEST_CONTEXT
+
+SEASTAR_THREAD_TEST_CASE(test_spans) {
+    drain_spans();
+    // Untraced work records nothing
+    with_span("untraced", [] {}).get();
+    BOOST_REQUIRE(drain_spans().empty());
+
+    auto ctx = new_request_context();
+    with_request_context(ctx, [] {
+        return with_span("outer", [] {
+            auto outer = current_request_context();
+            return smp::submit_to((this_shard_id() + 1) % smp::count, [] {
+                return with_span("remote", [] {
+                    return sleep(1ms);
+                }).then([] {
+                    return drain_spans();
+                });
+            }).then([outer] (std::vector<span_record> remote) {
+                BOOST_REQUIRE_EQUAL(remote.size(), 1);
+                BOOST_REQUIRE_EQUAL(remote[0].name, "remote");
+                BOOST_REQUIRE_EQUAL(remote[0].trace_id, outer.trace_id);
+                BOOST_REQUIRE_EQUAL(remote[0].parent_span_id, outer.span_id);
+                BOOST_REQUIRE_EQUAL(remote[0].shard, (this_shard_id() + 1) % smp::count);
+                BOOST_REQUIRE(remote[0].end - remote[0].start >= 1ms);
+            });
+        });
+    }).get();
+    auto spans = drain_spans();
+    BOOST_REQUIRE_EQUAL(spans.size(), 1);
+    BOOST_REQUIRE_EQUAL(spans[0].name, "outer");
+    BOOST_REQUIRE_EQUAL(spans[0].trace_id, ctx.trace_id);
+    BOOST_REQUIRE_EQUAL(spans[0].parent_span_id, 0);
+    BOOST_REQUIRE_EQUAL(spans[0].shard, this_shard_id());
+}
+
+#endif
+
+SEASTAR_THREAD_TEST_CASE(test_span_buffer_capacity) {
+    drain_spans();
+    set_span_buffer_capacity(2);
+    auto dropped = dropped_spans();
+    auto ctx = new_request_context();
+    for (auto name : {"a", "b", "c"}) {
+        with_request_context(ctx, [name] {
+            return with_span(name, [] {});
+        }).get();
+    }
+    auto spans = drain_spans();
+    BOOST_REQUIRE_EQUAL(spans.size(), 2);
+    BOOST_REQUIRE_EQUAL(spans[0].name, "b");
+    BOOST_REQUIRE_EQUAL(spans[1].name, "c");
+    BOOST_REQUIRE_EQUAL(dropped_spans(), dropped + 1);
+    set_span_buffer_capacity(4096);
+}
@@ -0,0 +1,136 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (C) 2021 ScyllaDB
+ */
+
+
+#include <seastar/core/result.hh>
+#include <seastar/core/timed_out_error.hh>
+#include <seastar/testing/test_case.hh>
+#include <seastar/util/exceptions.hh>
+
+using namespace seastar;
+
+namespace {
+
+struct base_a {
+    virtual ~base_a() = default;
+    int a = 1;
+};
+
+struct base_b {
+    virtual ~base_b() = default;
+    int b = 2;
+};
+
+struct derived : base_a, base_b {
+};
+
+}
+
+// Runs the same checks against try_catch() and its portable fallback,
+// which other standard libraries than libstdc++ use
+struct default_try_catch {
+    template <typename Ex>
+    static Ex* match(const std::exception_ptr& eptr) noexcept {
+        return try_catch<Ex>(eptr);
+    }
+};
+
+struct rethrowing_try_catch {
+    template <typename Ex>
+    static Ex* match(const std::exception_ptr& eptr) noexcept {
+        return eptr ? internal::try_catch_rethrow<Ex>(eptr) : nullptr;
+    }
+};
+
+template <typename Impl>
+static void check_try_catch() {
+    auto ex = std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::timed_out)));
+    BOOST_REQUIRE(Impl::template match<std::system_error>(ex) != nullptr);
+    BOOST_REQUIRE(Impl::template match<std::runtime_error>(ex) != nullptr);
+    BOOST_REQUIRE(Impl::template match<std::exception>(ex) != nullptr);
+    BOOST_REQUIRE(Impl::template match<std::logic_error>(ex) == nullptr);
+    BOOST_REQUIRE(Impl::template match<std::system_error>(ex)->code() == std::errc::timed_out);
+    BOOST_REQUIRE(Impl::template match<std::exception>(std::exception_ptr()) == nullptr);
+
+    // Upcasts adjust the pointer like a catch clause would
+    auto d = std::make_exception_ptr(derived());
+    BOOST_REQUIRE_EQUAL(Impl::template match<base_a>(d)->a, 1);
+    BOOST_REQUIRE_EQUAL(Impl::template match<base_b>(d)->b, 2);
+    BOOST_REQUIRE(Impl::template match<std::exception>(d) == nullptr);
+
+    auto i = std::make_exception_ptr(17);
+    BOOST_REQUIRE_EQUAL(*Impl::template match<int>(i), 17);
+    BOOST_REQUIRE(Impl::template match<long>(i) == nullptr);
+}
+
+SEASTAR_TEST_CASE(test_try_catch) {
+    check_try_catch<default_try_catch>();
+    check_try_catch<rethrowing_try_catch>();
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_result) {
+    result<int, std::error_code> ok(3);
+    BOOST_REQUIRE(ok);
+    BOOST_REQUIRE_EQUAL(*ok, 3);
+    BOOST_REQUIRE_EQUAL(ok.value(), 3);
+
+    result<int, std::error_code> bad = make_failure(make_error_code(std::errc::no_such_file_or_directory));
+    BOOST_REQUIRE(!bad);
+    BOOST_REQUIRE(bad.error() == std::errc::no_such_file_or_directory);
+    BOOST_REQUIRE_THROW(bad.value(), std::system_error);
+
+    result<void, timed_out_error> v;
+    BOOST_REQUIRE(v);
+    v.value();
+    result<void, timed_out_error> vbad = make_failure(timed_out_error());
+    BOOST_REQUIRE(!vbad);
+    BOOST_REQUIRE_THROW(vbad.value(), timed_out_error);
+
+    // A value type constructible from the error type is still unambiguous
+    result<std::string, std::string> s = make_failure(std::string("error"));
+    BOOST_REQUIRE(!s);
+    BOOST_REQUIRE_EQUAL(s.error(), "error");
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_result_future_conversions) {
+    using res = result<int, std::error_code>;
+    auto f = to_future(res(1));
+    BOOST_REQUIRE_EQUAL(f.get0(), 1);
+    auto g = to_future(res(make_failure(make_error_code(std::errc::timed_out))));
+    BOOST_REQUIRE(g.failed());
+    BOOST_REQUIRE(try_catch<std::system_error>(g.get_exception()) != nullptr);
+
+    auto to_code = [] (timed_out_error&) { return make_error_code(std::errc::timed_out); };
+    auto r1 = catch_as_result<timed_out_error, std::error_code>(make_ready_future<int>(5), to_code).get0();
+    BOOST_REQUIRE(r1 && *r1 == 5);
+    auto r2 = catch_as_result<timed_out_error, std::error_code>(make_exception_future<int>(timed_out_error()), to_code).get0();
+    BOOST_REQUIRE(!r2 && r2.error() == std::errc::timed_out);
+    auto r3 = catch_as_result<timed_out_error, std::error_code>(make_exception_future<int>(std::bad_alloc()), to_code);
+    BOOST_REQUIRE_THROW(r3.get(), std::bad_alloc);
+
+    auto r4 = catch_as_result<timed_out_error, std::error_code>(make_exception_future<>(timed_out_error()), to_code).get0();
+    BOOST_REQUIRE(!r4);
+    BOOST_REQUIRE_THROW(to_future(std::move(r4)).get(), std::system_error);
+    return make_ready_future<>();
+}
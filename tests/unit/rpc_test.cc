@@ -32,6 +32,7 @@
 #include <seastar/core/sleep.hh>
 #include <seastar/core/distributed.hh>
 #include <seastar/core/loop.hh>
+#include <seastar/core/with_request_context.hh>
 #include <seastar/util/defer.hh>
 #include <seastar/util/log.hh>
 #include <seastar/util/closeable.hh>
@@ -600,6 +601,62 @@ SEASTAR_TEST_CASE(test_rpc_scheduling) {
     });
 }
 
+SEASTAR_THREAD_TEST_CASE(test_rpc_request_context) {
+    auto ctx = new_request_context();
+    ctx.span_id = 17;
+    for (auto send_context : {false, true}) {
+        for (auto send_timeout : {false, true}) {
+            rpc::client_options co;
+            co.send_request_context = send_context;
+            co.send_timeout_data = send_timeout;
+            rpc_test_env<>::do_with_thread(rpc_test_config(), co, [&] (rpc_test_env<>& env, test_rpc_proto::client& c1) {
+                env.register_handler(1, [] (int x) {
+                    return make_ready_future<uint64_t>(current_request_context().trace_id + x);
+                }).get();
+                env.register_handler(2, [] (int x) {
+                    return make_ready_future<uint64_t>(current_request_context().span_id + x);
+                }).get();
+                auto get_trace_id = env.proto().make_client<uint64_t (int)>(1);
+                auto get_span_id = env.proto().make_client<uint64_t (int)>(2);
+                auto expected = send_context ? ctx : request_context{};
+                BOOST_REQUIRE_EQUAL(with_request_context(ctx, [&] { return get_trace_id(c1, 1); }).get0(), expected.trace_id + 1);
+                BOOST_REQUIRE_EQUAL(with_request_context(ctx, [&] { return get_span_id(c1, 2); }).get0(), expected.span_id + 2);
+                // Calls made outside of a request carry no context
+                BOOST_REQUIRE_EQUAL(get_trace_id(c1, 3).get0(), 3);
+            }).get();
+        }
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE(test_rpc_arrival_latency) {
+    // Receive timestamps need a real socket, loopback ones don't carry them
+    rpc::server_options so;
+    so.receive_timestamps = true;
+    so.metrics_domain = "arrival_latency_test";
+    test_rpc_proto proto{serializer()};
+    proto.register_handler(1, [] (int x) { return x; });
+    listen_options lo;
+    lo.reuse_address = true;
+    auto ss = seastar::listen(ipv4_addr("127.0.0.1", 0), lo);
+    auto addr = ss.local_address();
+    test_rpc_proto::server server(proto, so, std::move(ss));
+
+    // Two servers can't export their metrics under the same domain
+    BOOST_REQUIRE_THROW(test_rpc_proto::server(proto, so, seastar::listen(ipv4_addr("127.0.0.1", 0), lo)), std::runtime_error);
+
+    test_rpc_proto::client cl(proto, addr);
+    auto call = proto.make_client<int (int)>(1);
+    BOOST_REQUIRE_EQUAL(call(cl, 2).get0(), 2);
+    BOOST_REQUIRE_EQUAL(call(cl, 3).get0(), 3);
+    cl.stop().get();
+    server.stop().get();
+    proto.unregister_handler(1).get();
+
+    auto h = server.arrival_latency().get();
+    BOOST_REQUIRE_EQUAL(h.sample_count, 2);
+    BOOST_REQUIRE_EQUAL(h.buckets.back().count, 2);
+}
+
 SEASTAR_THREAD_TEST_CASE(test_rpc_scheduling_connection_based) {
     auto sg1 = create_scheduling_group("sg1", 100).get0();
     auto sg1_kill = defer([&] { destroy_scheduling_group(sg1).get(); });
@@ -33,6 +33,7 @@
 #include <seastar/core/scheduling_specific.hh>
 #include <seastar/core/smp.hh>
 #include <seastar/core/with_scheduling_group.hh>
+#include <seastar/core/when_all.hh>
 #include <seastar/util/later.hh>
 
 using namespace std::chrono_literals;
@@ -249,3 +250,105 @@ SEASTAR_THREAD_TEST_CASE(later_preserves_sg) {
         });
     }).get();
 }
+
+SEASTAR_THREAD_TEST_CASE(sg_task_quota) {
+    scheduling_group sg_short = create_scheduling_group("sg_short_quota", 100).get0();
+    auto cleanup_short = defer([&] { destroy_scheduling_group(sg_short).get(); });
+    scheduling_group sg_long = create_scheduling_group("sg_long_quota", 100).get0();
+    auto cleanup_long = defer([&] { destroy_scheduling_group(sg_long).get(); });
+    auto default_quota = default_scheduling_group().task_quota();
+    BOOST_REQUIRE(sg_short.task_quota() == default_quota);
+    BOOST_REQUIRE(sg_long.task_quota() == default_quota);
+
+    sg_short.set_task_quota(100us);
+    sg_long.set_task_quota(10ms);
+    BOOST_REQUIRE(sg_short.task_quota() == 100us);
+    BOOST_REQUIRE(sg_long.task_quota() == 10ms);
+    BOOST_REQUIRE(default_scheduling_group().task_quota() == default_quota);
+
+    // Tasks of each group see their own group's quota
+    auto quota_in = [] (scheduling_group sg) {
+        return with_scheduling_group(sg, [] {
+            return current_scheduling_group().task_quota();
+        }).get0();
+    };
+    BOOST_REQUIRE(quota_in(sg_short) == 100us);
+    BOOST_REQUIRE(quota_in(sg_long) == 10ms);
+
+#ifndef SEASTAR_DEBUG
+    // And the reactor preempts each group after its own quota: a task that
+    // spins until need_preempt() is stopped early in the short group, but
+    // spins through the whole limit in the long one.
+    sg_short.set_task_quota(1ms);
+    sg_long.set_task_quota(1s);
+    auto spin_until_preempted = [] (scheduling_group sg) {
+        return with_scheduling_group(sg, [] {
+            auto start = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::steady_clock::duration(0);
+            while (!need_preempt() && elapsed < 50ms) {
+                elapsed = std::chrono::steady_clock::now() - start;
+            }
+            return elapsed;
+        }).get0();
+    };
+    BOOST_REQUIRE(spin_until_preempted(sg_short) < 50ms);
+    BOOST_REQUIRE(spin_until_preempted(sg_long) >= 50ms);
+    sg_short.set_task_quota(100us);
+    sg_long.set_task_quota(10ms);
+#endif
+
+    sg_short.set_task_quota(0ns);
+    BOOST_REQUIRE(sg_short.task_quota() == default_quota);
+    BOOST_REQUIRE(sg_long.task_quota() == 10ms);
+}
+
+SEASTAR_THREAD_TEST_CASE(sg_deadline) {
+    scheduling_group sg_bg = create_scheduling_group("sg_bg", 100).get0();
+    auto cleanup_bg = defer([&] { destroy_scheduling_group(sg_bg).get(); });
+    scheduling_group sg_fg = create_scheduling_group("sg_fg", 100).get0();
+    auto cleanup_fg = defer([&] { destroy_scheduling_group(sg_fg).get(); });
+
+    // Both groups become runnable together, the background one first;
+    // the one with a deadline runs first regardless.
+    auto run_both = [&] {
+        std::vector<scheduling_group> order;
+        auto record = [&order] {
+            order.push_back(current_scheduling_group());
+        };
+        auto bg = with_scheduling_group(sg_bg, record);
+        auto fg = with_scheduling_group(sg_fg, record);
+        when_all_succeed(std::move(bg), std::move(fg)).get();
+        return order;
+    };
+    auto deadline = std::chrono::steady_clock::now() + 1h;
+    {
+        scheduling_deadline d(sg_fg, deadline);
+        auto order = run_both();
+        BOOST_REQUIRE_EQUAL(order.size(), 2u);
+        BOOST_REQUIRE(order[0] == sg_fg);
+        BOOST_REQUIRE(order[1] == sg_bg);
+    }
+
+    // with_deadline() keeps the deadline registered until the call completes
+    promise<> done;
+    auto fg_deadline = with_deadline(sg_fg, deadline, [&done] () noexcept {
+        return done.get_future();
+    });
+    auto order = run_both();
+    done.set_value();
+    fg_deadline.get();
+    BOOST_REQUIRE(order[0] == sg_fg);
+
+    // A moved-from registration is empty and unregisters nothing
+    scheduling_deadline d1(sg_fg, deadline);
+    auto d2 = std::move(d1);
+    BOOST_REQUIRE(!d1);
+    BOOST_REQUIRE(d1.deadline() == scheduling_deadline::time_point::max());
+    BOOST_REQUIRE(d2);
+    BOOST_REQUIRE(d2.deadline() == deadline);
+    scheduling_deadline d3(sg_bg, deadline + 1s);
+    d3 = std::move(d2);
+    BOOST_REQUIRE(!d2);
+    BOOST_REQUIRE(d3.group() == sg_fg);
+    BOOST_REQUIRE(d3.deadline() == deadline);
+}
@@ -23,6 +23,9 @@
 #include <seastar/core/smp.hh>
 #include <seastar/core/app-template.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/when_all.hh>
+#include <boost/range/irange.hpp>
 
 using namespace seastar;
 
@@ -58,6 +61,56 @@ future<bool> test_smp_exception() {
     });
 }
 
+future<bool> test_smp_priority() {
+    // Queue a backlog of normal messages, then a high-priority one, which
+    // should overtake the backlog
+    constexpr unsigned backlog = 10000;
+    auto done = make_lw_shared<unsigned>(0);
+    auto normal = parallel_for_each(boost::irange(0u, backlog), [done] (unsigned) {
+        return smp::submit_to(1, [] {}).then([done] {
+            ++*done;
+        });
+    });
+    auto high = smp::submit_to(1, smp_submit_to_options(default_smp_service_group(), smp_no_timeout, smp_message_priority::high), [] {
+        return 3;
+    }).then([done] (int ret) {
+        return ret == 3 && *done < backlog;
+    });
+    return when_all_succeed(std::move(normal), std::move(high)).then_unpack([] (bool ok) {
+        return ok;
+    });
+}
+
+future<bool> test_smp_parallel_compute() {
+    constexpr uint64_t n = 1000000;
+    return smp::parallel_compute(0, n, 1000, [] (size_t begin, size_t end) {
+        uint64_t sum = 0;
+        for (auto i = begin; i < end; i++) {
+            sum += i * i;
+        }
+        return sum;
+    }, uint64_t(0), std::plus<uint64_t>()).then([] (uint64_t sum) {
+        return sum == (n - 1) * n * (2 * n - 1) / 6;
+    });
+}
+
+future<bool> test_smp_parallel_compute_exception() {
+    return smp::parallel_compute(0, 100, 1, [] (size_t begin, size_t) {
+        if (begin == 42) {
+            throw nasty_exception();
+        }
+    }).then_wrapped([] (future<> f) {
+        try {
+            f.get();
+            return false;
+        } catch (nasty_exception&) {
+            return true;
+        } catch (...) {
+            return false;
+        }
+    });
+}
+
 int tests, fails;
 
 future<>
@@ -73,6 +126,12 @@ int main(int ac, char** av) {
     return app_template().run_deprecated(ac, av, [] {
        return report("smp call", test_smp_call()).then([] {
            return report("smp exception", test_smp_exception());
+       }).then([] {
+           return report("smp priority", test_smp_priority());
+       }).then([] {
+           return report("smp parallel_compute", test_smp_parallel_compute());
+       }).then([] {
+           return report("smp parallel_compute exception", test_smp_parallel_compute_exception());
        }).then([] {
            fmt::print("\n{:d} tests / {:d} failures\n", tests, fails);
            engine().exit(fails ? 1 : 0);
@@ -31,6 +31,7 @@
 #include <seastar/core/thread.hh>
 
 #include <seastar/net/posix-stack.hh>
+#include <seastar/net/tcp_info_sampler.hh>
 
 using namespace seastar;
 
@@ -109,4 +110,84 @@ SEASTAR_TEST_CASE(socket_skip_test) {
         as.request_abort();
         client.get();
     });
-}
\ No newline at end of file
+}
+
+SEASTAR_TEST_CASE(socket_tcp_info_test) {
+    return seastar::async([&] {
+        listen_options lo;
+        lo.reuse_address = true;
+        server_socket ss = seastar::listen(ipv4_addr("127.0.0.1", 1234), lo);
+
+        auto f = connect(ipv4_addr("127.0.0.1", 1234));
+        accept_result accepted = ss.accept().get();
+        connected_socket socket = f.get0();
+
+        auto out = socket.output();
+        out.write("abc").get();
+        out.flush().get();
+        auto in = accepted.connection.input();
+        in.read_exactly(3).get();
+
+        auto ti = socket.get_tcp_info();
+        BOOST_REQUIRE(ti);
+        BOOST_REQUIRE_GT(ti->snd_mss, 0);
+        BOOST_REQUIRE_GT(ti->snd_cwnd, 0);
+
+        net::tcp_info_sampler sampler("test", net::tcp_info_sampler_config{std::chrono::milliseconds(10)});
+        auto reg = sampler.track(socket);
+        BOOST_REQUIRE_EQUAL(sampler.connections(), 1);
+        BOOST_REQUIRE(!reg.last_sample());
+        sleep(std::chrono::milliseconds(100)).get();
+        BOOST_REQUIRE(reg.last_sample());
+        unsigned nr = 0;
+        sampler.for_each_sample([&] (const connected_socket& s, const net::tcp_info_sample&) {
+            BOOST_REQUIRE_EQUAL(&s, &socket);
+            nr++;
+        });
+        BOOST_REQUIRE_EQUAL(nr, 1);
+
+        reg = {};
+        BOOST_REQUIRE_EQUAL(sampler.connections(), 0);
+
+        // Sampling one connection per period still gets round to all of them
+        net::tcp_info_sampler slow_sampler("test_slow", net::tcp_info_sampler_config{std::chrono::milliseconds(10), 1});
+        auto reg1 = slow_sampler.track(socket);
+        auto reg2 = slow_sampler.track(accepted.connection);
+        sleep(std::chrono::milliseconds(100)).get();
+        BOOST_REQUIRE(reg1.last_sample());
+        BOOST_REQUIRE(reg2.last_sample());
+        reg1 = {};
+        reg2 = {};
+        out.close().get();
+    });
+}
+
+SEASTAR_TEST_CASE(socket_receive_timestamps_test) {
+    return seastar::async([&] {
+        listen_options lo;
+        lo.reuse_address = true;
+        server_socket ss = seastar::listen(ipv4_addr("127.0.0.1", 1234), lo);
+
+        auto f = connect(ipv4_addr("127.0.0.1", 1234));
+        accept_result accepted = ss.accept().get();
+        connected_socket socket = f.get0();
+
+        connected_socket_input_stream_config csisc;
+        csisc.receive_timestamps = true;
+        auto in = accepted.connection.input(csisc);
+        BOOST_REQUIRE(!in.receive_timestamp());
+
+        auto before = std::chrono::system_clock::now();
+        auto out = socket.output();
+        out.write("abc").get();
+        out.flush().get();
+        in.read_exactly(3).get();
+        auto after = std::chrono::system_clock::now();
+
+        auto ts = in.receive_timestamp();
+        BOOST_REQUIRE(ts);
+        BOOST_REQUIRE(*ts >= before - std::chrono::seconds(1));
+        BOOST_REQUIRE(*ts <= after);
+        out.close().get();
+    });
+}